@@ -13,27 +13,23 @@
 #include <unordered_map>
 #include <random>
 #include <functional>
+#include <iomanip>
+#include <cstdint>
+#include <unistd.h>
+
+#include "bench_registry.h"
+#include "static_search.h"
+#include "timer.h"
 
 using namespace std;
 using namespace std::chrono;
 
-// Timer utility class
-class Timer {
-private:
-    high_resolution_clock::time_point start_time;
-    string name;
-
-public:
-    Timer(const string& timer_name) : name(timer_name) {
-        start_time = high_resolution_clock::now();
-    }
-
-    ~Timer() {
-        auto end_time = high_resolution_clock::now();
-        auto duration = duration_cast<milliseconds>(end_time - start_time);
-        cout << "   " << name << ": " << duration.count() / 1000.0 << "s" << endl;
-    }
-};
+// Short count for section labels: 1000000 -> "1M", 500000 -> "500k"
+string count_label(long n) {
+    if (n >= 1000000 && n % 1000000 == 0) return to_string(n / 1000000) + "M";
+    if (n >= 1000 && n % 1000 == 0) return to_string(n / 1000) + "k";
+    return to_string(n);
+}
 
 // Recursive Fibonacci - intentionally inefficient
 long long fibonacci_recursive(int n) {
@@ -160,7 +156,7 @@ void sorting_comparison(int size) {
     // Bubble sort (small dataset)
     if (size <= 10000) {
         vector<int> data = original;
-        Timer timer("   Bubble sort");
+        Timer timer("   Bubble sort", Work().with_items(size));
         
         for (int i = 0; i < size - 1; ++i) {
             for (int j = 0; j < size - i - 1; ++j) {
@@ -174,7 +170,7 @@ void sorting_comparison(int size) {
     // Quick sort
     {
         vector<int> data = original;
-        Timer timer("   Quick sort");
+        Timer timer("   Quick sort", Work().with_items(size));
         
         function<void(int, int)> quicksort = [&](int low, int high) {
             if (low < high) {
@@ -202,29 +198,28 @@ void sorting_comparison(int size) {
     // STL sort
     {
         vector<int> data = original;
-        Timer timer("   STL sort");
+        Timer timer("   STL sort", Work().with_items(size));
         sort(data.begin(), data.end());
     }
     
     // Heap sort
     {
         vector<int> data = original;
-        Timer timer("   Heap sort");
+        Timer timer("   Heap sort", Work().with_items(size));
         make_heap(data.begin(), data.end());
         sort_heap(data.begin(), data.end());
     }
 }
 
 // Hash table operations
-void hash_table_operations() {
+void hash_table_operations(int num_elements = 1000000) {
     cout << "\n8. Hash Table Operations:" << endl;
     
     unordered_map<int, string> hash_map;
-    const int num_elements = 1000000;
     
     // Insertion
     {
-        Timer timer("   Insertion (1M elements)");
+        Timer timer("   Insertion (" + count_label(num_elements) + " elements)", Work().with_items(num_elements));
         for (int i = 0; i < num_elements; ++i) {
             hash_map[i] = "Value_" + to_string(i);
         }
@@ -232,7 +227,7 @@ void hash_table_operations() {
     
     // Lookup
     {
-        Timer timer("   Lookup (1M queries)");
+        Timer timer("   Lookup (" + count_label(num_elements) + " queries)", Work().with_items(num_elements));
         int found = 0;
         for (int i = 0; i < num_elements; ++i) {
             if (hash_map.find(i) != hash_map.end()) {
@@ -244,113 +239,241 @@ void hash_table_operations() {
     
     // Deletion
     {
-        Timer timer("   Deletion (500k elements)");
+        Timer timer("   Deletion (" + count_label(num_elements / 2) + " elements)", Work().with_items(num_elements / 2));
         for (int i = 0; i < num_elements / 2; ++i) {
             hash_map.erase(i);
         }
     }
 }
 
-int main() {
-    cout << "Starting CPU-intensive operations for profiling..." << endl;
-    cout << "============================================================" << endl;
+// Lookups into sorted keys: std::lower_bound vs Eytzinger layout vs S-tree
+void search_comparison(size_t max_keys) {
+    cout << "\n9. Static Search Trees (M lookups/s, " << count_label(1 << 20) << " random queries):" << endl;
     
-    // Test 1: Fibonacci comparison
+    const size_t queries_count = 1 << 20;
+    mt19937 gen(42);
+    uniform_int_distribution<int32_t> any_key(INT32_MIN, INT32_MAX);
+    vector<int32_t> queries(queries_count);
+    for (auto& q : queries) {
+        q = any_key(gen);
+    }
+    vector<int32_t> expected(queries_count), found(queries_count);
+    vector<size_t> expected_rank(queries_count), found_rank(queries_count);
+    
+    cout << setw(8) << "Keys" << setw(14) << "lower_bound" << setw(12) << "Eytzinger"
+         << setw(12) << "Eytz batch" << setw(10) << "S-tree" << setw(14) << "S-tree batch" << endl;
+    cout << string(70, '-') << endl;
+    cout << fixed << setprecision(1);
+    
+    const double available = static_cast<double>(sysconf(_SC_AVPHYS_PAGES)) * sysconf(_SC_PAGESIZE);
+    for (size_t n = max<size_t>(1, min<size_t>(1000, max_keys)); n <= max_keys; n *= 10) {
+        // Keys plus one index at a time (the S-tree adds ~1/16 for internal nodes)
+        double needed = 2.2 * n * sizeof(int32_t);
+        if (needed > 0.8 * available) {
+            cout << setw(8) << count_label(n) << "   skipped: needs " << needed / 1e9
+                 << " GB, " << available / 1e9 << " GB available" << endl;
+            break;
+        }
+        
+        // Distinct sorted keys spread over the whole int32 range
+        vector<int32_t> keys(n);
+        const double step = 4294967295.0 / n;
+        for (size_t i = 0; i < n; ++i) {
+            keys[i] = static_cast<int32_t>(INT32_MIN + static_cast<int64_t>(i * step));
+        }
+        
+        double std_ms = best_of(3, [&]() {
+            for (size_t i = 0; i < queries_count; ++i) {
+                auto it = lower_bound(keys.begin(), keys.end(), queries[i]);
+                expected_rank[i] = it - keys.begin();
+                expected[i] = it == keys.end() ? INT32_MAX : *it;
+            }
+        });
+        
+        // Results are cleared before every variant so each one is checked on its own output
+        auto reset = [&]() {
+            fill(found.begin(), found.end(), INT32_MIN);
+            fill(found_rank.begin(), found_rank.end(), SIZE_MAX);
+        };
+        size_t mismatches = 0;
+        double eytz_ms, eytz_batch_ms, stree_ms, stree_batch_ms;
+        {
+            EytzingerIndex<int32_t> eytzinger(keys);
+            reset();
+            eytz_ms = best_of(3, [&]() {
+                for (size_t i = 0; i < queries_count; ++i) {
+                    found[i] = eytzinger.lower_bound(queries[i]);
+                }
+            });
+            mismatches += found != expected;
+            reset();
+            eytz_batch_ms = best_of(3, [&]() { eytzinger.lower_bound_batch(queries.data(), queries_count, found.data()); });
+            mismatches += found != expected;
+        }
+        {
+            STree stree(keys);
+            reset();
+            stree_ms = best_of(3, [&]() {
+                for (size_t i = 0; i < queries_count; ++i) {
+                    found_rank[i] = stree.rank(queries[i]);
+                }
+            });
+            mismatches += found_rank != expected_rank;
+            reset();
+            stree_batch_ms = best_of(3, [&]() { stree.rank_batch(queries.data(), queries_count, found_rank.data()); });
+            mismatches += found_rank != expected_rank;
+        }
+        
+        auto rate = [&](double ms) { return queries_count / (ms * 1e3); };
+        cout << setw(8) << count_label(n) << setw(14) << rate(std_ms) << setw(12) << rate(eytz_ms)
+             << setw(12) << rate(eytz_batch_ms) << setw(10) << rate(stree_ms)
+             << setw(14) << rate(stree_batch_ms);
+        if (mismatches) {
+            cout << "   MISMATCH";
+        }
+        cout << endl;
+    }
+    cout << defaultfloat << setprecision(6);
+}
+
+// Test 1: Fibonacci comparison
+void fibonacci_test(int n) {
     cout << "\n1. Fibonacci Calculation:" << endl;
     {
-        Timer timer("Recursive (n=40)");
-        long long fib_rec = fibonacci_recursive(40);
+        // fib(n) makes 2 * fib(n + 1) - 1 calls
+        Timer timer("Recursive (n=" + to_string(n) + ")", Work().with_items(2.0 * fibonacci_iterative(n + 1) - 1));
+        long long fib_rec = fibonacci_recursive(n);
         cout << "     Result: " << fib_rec << endl;
     }
     
     {
-        Timer timer("Iterative (n=90)");
+        Timer timer("Iterative (n=90)", Work().with_items(89));
         long long fib_iter = fibonacci_iterative(90);
         cout << "     Result: " << fib_iter << endl;
     }
-    
-    // Test 2: Prime number generation
+}
+
+// Test 2: Prime number generation
+void prime_test(int limit) {
     cout << "\n2. Prime Number Generation:" << endl;
-    {
-        Timer timer("Sieve of Eratosthenes (up to 10M)");
-        vector<int> primes = sieve_of_eratosthenes(10000000);
-        cout << "     Found " << primes.size() << " primes" << endl;
-    }
-    
-    // Test 3: Matrix multiplication
+    Timer timer("Sieve of Eratosthenes (up to " + count_label(limit) + ")", Work().with_items(limit));
+    vector<int> primes = sieve_of_eratosthenes(limit);
+    cout << "     Found " << primes.size() << " primes" << endl;
+}
+
+// Test 3: Matrix multiplication
+void matrix_test(int size) {
     cout << "\n3. Matrix Multiplication:" << endl;
-    {
-        int size = 500;
-        vector<vector<double>> a(size, vector<double>(size));
-        vector<vector<double>> b(size, vector<double>(size));
-        
-        // Initialize matrices
-        for (int i = 0; i < size; ++i) {
-            for (int j = 0; j < size; ++j) {
-                a[i][j] = i * j;
-                b[i][j] = i + j;
-            }
+    vector<vector<double>> a(size, vector<double>(size));
+    vector<vector<double>> b(size, vector<double>(size));
+    
+    // Initialize matrices
+    for (int i = 0; i < size; ++i) {
+        for (int j = 0; j < size; ++j) {
+            a[i][j] = i * j;
+            b[i][j] = i + j;
         }
-        
-        Timer timer("500x500 matrix multiplication");
-        auto result = matrix_multiply_naive(a, b);
-        cout << "     Result[0][0]: " << result[0][0] << endl;
     }
     
-    // Test 4: Mathematical computations
+    Timer timer(to_string(size) + "x" + to_string(size) + " matrix multiplication",
+                Work().with_flops(2.0 * size * size * size));
+    auto result = matrix_multiply_naive(a, b);
+    cout << "     Result[0][0]: " << result[0][0] << endl;
+}
+
+// Test 4: Mathematical computations
+void math_test(int iterations) {
     cout << "\n4. Mathematical Computations:" << endl;
-    {
-        Timer timer("Complex calculations (100k iterations)");
-        double result = compute_intensive_loop(100000);
-        cout << "     Result: " << result << endl;
-    }
-    
-    // Test 5: String operations
+    Timer timer("Complex calculations (" + count_label(iterations) + " iterations)", Work().with_items(iterations));
+    double result = compute_intensive_loop(iterations);
+    cout << "     Result: " << result << endl;
+}
+
+// Test 5: String operations
+void string_test(int count) {
     cout << "\n5. String Operations:" << endl;
-    {
-        Timer timer("String manipulation (10k strings)");
-        int result_length = string_operations(10000);
-        cout << "     Result length: " << result_length << endl;
+    Timer timer("String manipulation (" + count_label(count) + " strings)", Work().with_items(count));
+    int result_length = string_operations(count);
+    cout << "     Result length: " << result_length << endl;
+}
+
+// Test 6: Dynamic programming example
+void lcs_test(int length) {
+    cout << "\n6. Dynamic Programming (Longest Common Subsequence):" << endl;
+    string s1 = string(length, 'A');
+    string s2 = string(length, 'B');
+    // Insert some common characters
+    for (int i = 0; i < length / 10; ++i) {
+        s1[i * 10] = 'X';
+        s2[i * 10] = 'X';
     }
     
-    // Test 6: Dynamic programming example
-    cout << "\n6. Dynamic Programming (Longest Common Subsequence):" << endl;
-    {
-        string s1 = string(1000, 'A');
-        string s2 = string(1000, 'B');
-        // Insert some common characters
-        for (int i = 0; i < 100; ++i) {
-            s1[i * 10] = 'X';
-            s2[i * 10] = 'X';
-        }
-        
-        Timer timer("LCS of 1000-char strings");
-        
-        int m = s1.length();
-        int n = s2.length();
-        vector<vector<int>> dp(m + 1, vector<int>(n + 1, 0));
-        
-        for (int i = 1; i <= m; ++i) {
-            for (int j = 1; j <= n; ++j) {
-                if (s1[i-1] == s2[j-1]) {
-                    dp[i][j] = dp[i-1][j-1] + 1;
-                } else {
-                    dp[i][j] = max(dp[i-1][j], dp[i][j-1]);
-                }
+    int m = s1.length();
+    int n = s2.length();
+    Timer timer("LCS of " + to_string(length) + "-char strings", Work().with_items(double(m) * n));
+    
+    vector<vector<int>> dp(m + 1, vector<int>(n + 1, 0));
+    
+    for (int i = 1; i <= m; ++i) {
+        for (int j = 1; j <= n; ++j) {
+            if (s1[i-1] == s2[j-1]) {
+                dp[i][j] = dp[i-1][j-1] + 1;
+            } else {
+                dp[i][j] = max(dp[i-1][j], dp[i][j-1]);
             }
         }
-        
-        cout << "     LCS length: " << dp[m][n] << endl;
     }
     
+    cout << "     LCS length: " << dp[m][n] << endl;
+}
+
+// Sections available to bench_driver
+static BenchRegistrar reg_fibonacci("basic/fibonacci", "n of the recursive fib(n)", 40, false,
+    [](const BenchContext& ctx) { fibonacci_test(static_cast<int>(ctx.size)); });
+static BenchRegistrar reg_sieve("basic/sieve", "sieve limit", 10000000, false,
+    [](const BenchContext& ctx) { prime_test(static_cast<int>(ctx.size)); });
+static BenchRegistrar reg_matmul("basic/matmul", "matrix dimension", 500, false,
+    [](const BenchContext& ctx) { matrix_test(static_cast<int>(ctx.size)); });
+static BenchRegistrar reg_math("basic/math", "loop iterations", 100000, false,
+    [](const BenchContext& ctx) { math_test(static_cast<int>(ctx.size)); });
+static BenchRegistrar reg_strings("basic/strings", "number of strings", 10000, false,
+    [](const BenchContext& ctx) { string_test(static_cast<int>(ctx.size)); });
+static BenchRegistrar reg_lcs("basic/lcs", "string length", 1000, false,
+    [](const BenchContext& ctx) { lcs_test(static_cast<int>(ctx.size)); });
+static BenchRegistrar reg_sorting("basic/sorting", "elements to sort", 100000, false,
+    [](const BenchContext& ctx) { sorting_comparison(static_cast<int>(ctx.size)); });
+static BenchRegistrar reg_hash("basic/hash-table", "elements inserted", 1000000, false,
+    [](const BenchContext& ctx) { hash_table_operations(static_cast<int>(ctx.size)); });
+static BenchRegistrar reg_search("basic/search", "largest key count (from 1k up by 10x)", 1000000000, false,
+    [](const BenchContext& ctx) { search_comparison(ctx.size); });
+
+#ifndef NSYS_BENCH_DRIVER
+int main() {
+    cout << "Starting CPU-intensive operations for profiling..." << endl;
+    cout << "============================================================" << endl;
+    
+    // Measure peaks up front so the measurement never lands inside a timed section
+    MachinePeaks::get();
+    
+    fibonacci_test(40);
+    prime_test(10000000);
+    matrix_test(500);
+    math_test(100000);
+    string_test(10000);
+    lcs_test(1000);
+    
     // Test 7: Sorting comparison
     sorting_comparison(100000);
     
     // Test 8: Hash table operations
     hash_table_operations();
     
+    // Test 9: Static search trees over sorted keys
+    search_comparison(1000000000);
+    
     cout << "\n============================================================" << endl;
     cout << "CPU profiling examples complete!" << endl;
     
     return 0;
-}
\ No newline at end of file
+}
+#endif
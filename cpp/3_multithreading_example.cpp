@@ -16,27 +16,15 @@
 #include <algorithm>
 #include <random>
 #include <functional>
+#include <memory>
+
+#include "bench_registry.h"
+#include "sched_accounting.h"
+#include "timer.h"
 
 using namespace std;
 using namespace std::chrono;
 
-class Timer {
-private:
-    high_resolution_clock::time_point start_time;
-    string name;
-
-public:
-    Timer(const string& timer_name) : name(timer_name) {
-        start_time = high_resolution_clock::now();
-    }
-
-    ~Timer() {
-        auto end_time = high_resolution_clock::now();
-        auto duration = duration_cast<milliseconds>(end_time - start_time);
-        cout << "   " << name << ": " << duration.count() / 1000.0 << "s" << endl;
-    }
-};
-
 // CPU-intensive task
 long long cpu_bound_task(int n) {
     long long total = 0;
@@ -56,9 +44,14 @@ private:
     atomic<bool> stop;
 
 public:
-    ThreadPool(size_t num_threads) : stop(false) {
+    // Workers report to sched, when given, until the pool is destroyed
+    ThreadPool(size_t num_threads, SchedSection* sched = nullptr) : stop(false) {
         for (size_t i = 0; i < num_threads; ++i) {
-            workers.emplace_back([this] {
+            workers.emplace_back([this, sched, i] {
+                unique_ptr<ThreadSchedScope> sched_scope;
+                if (sched) {
+                    sched_scope = make_unique<ThreadSchedScope>(*sched, "pool_" + to_string(i));
+                }
                 while (true) {
                     function<void()> task;
                     
@@ -102,12 +95,10 @@ public:
 };
 
 // 1. Basic threading example
-void basic_threading_example() {
+void basic_threading_example(int num_threads = thread::hardware_concurrency(),
+                             int work_per_thread = 10000000) {
     cout << "\n1. Basic Threading Example:" << endl;
     
-    const int num_threads = thread::hardware_concurrency();
-    const int work_per_thread = 10000000;
-    
     // Sequential execution
     {
         Timer timer("Sequential execution");
@@ -120,12 +111,14 @@ void basic_threading_example() {
     
     // Parallel execution
     {
+        SchedSection sched("Parallel execution");
         Timer timer("Parallel execution (" + to_string(num_threads) + " threads)");
         vector<thread> threads;
         vector<long long> results(num_threads);
         
         for (int i = 0; i < num_threads; ++i) {
-            threads.emplace_back([i, &results, work_per_thread]() {
+            threads.emplace_back([i, &results, work_per_thread, &sched]() {
+                ThreadSchedScope sched_scope(sched, "worker_" + to_string(i));
                 results[i] = cpu_bound_task(work_per_thread);
             });
         }
@@ -140,21 +133,20 @@ void basic_threading_example() {
 }
 
 // 2. Mutex contention example
-void mutex_contention_example() {
+void mutex_contention_example(int num_threads = 8, int iterations = 1000000) {
     cout << "\n2. Mutex Contention Example:" << endl;
     
-    const int num_threads = 8;
-    const int iterations = 1000000;
-    
     // High contention (single mutex)
     {
+        SchedSection sched("Single mutex");
         Timer timer("High contention (single mutex)");
         mutex mtx;
         long long shared_counter = 0;
         vector<thread> threads;
         
         for (int i = 0; i < num_threads; ++i) {
-            threads.emplace_back([&mtx, &shared_counter, iterations]() {
+            threads.emplace_back([&mtx, &shared_counter, iterations, &sched, i]() {
+                ThreadSchedScope sched_scope(sched, "worker_" + to_string(i));
                 for (int j = 0; j < iterations; ++j) {
                     lock_guard<mutex> lock(mtx);
                     shared_counter++;
@@ -171,6 +163,7 @@ void mutex_contention_example() {
     
     // Low contention (multiple mutexes)
     {
+        SchedSection sched("Striped locks");
         Timer timer("Low contention (striped locks)");
         const int num_stripes = 64;
         vector<mutex> mutexes(num_stripes);
@@ -178,7 +171,8 @@ void mutex_contention_example() {
         vector<thread> threads;
         
         for (int i = 0; i < num_threads; ++i) {
-            threads.emplace_back([&mutexes, &counters, iterations, num_stripes, i]() {
+            threads.emplace_back([&mutexes, &counters, iterations, num_stripes, i, &sched]() {
+                ThreadSchedScope sched_scope(sched, "worker_" + to_string(i));
                 for (int j = 0; j < iterations; ++j) {
                     int stripe = (i + j) % num_stripes;
                     lock_guard<mutex> lock(mutexes[stripe]);
@@ -197,12 +191,14 @@ void mutex_contention_example() {
     
     // Lock-free (atomic)
     {
+        SchedSection sched("Atomic counter");
         Timer timer("Lock-free (atomic)");
         atomic<long long> atomic_counter(0);
         vector<thread> threads;
         
         for (int i = 0; i < num_threads; ++i) {
-            threads.emplace_back([&atomic_counter, iterations]() {
+            threads.emplace_back([&atomic_counter, iterations, &sched, i]() {
+                ThreadSchedScope sched_scope(sched, "worker_" + to_string(i));
                 for (int j = 0; j < iterations; ++j) {
                     atomic_counter.fetch_add(1, memory_order_relaxed);
                 }
@@ -218,13 +214,12 @@ void mutex_contention_example() {
 }
 
 // 3. Producer-consumer pattern
-void producer_consumer_example() {
+void producer_consumer_example(int num_consumers = 4, int items_per_producer = 10000) {
     cout << "\n3. Producer-Consumer Pattern:" << endl;
     
     const int num_producers = 2;
-    const int num_consumers = 4;
-    const int items_per_producer = 10000;
     
+    SchedSection sched("Producer-consumer");
     Timer timer("Producer-consumer execution");
     
     queue<int> work_queue;
@@ -237,6 +232,7 @@ void producer_consumer_example() {
     
     // Producer function
     auto producer = [&](int id) {
+        ThreadSchedScope sched_scope(sched, "producer_" + to_string(id));
         for (int i = 0; i < items_per_producer; ++i) {
             unique_lock<mutex> lock(queue_mutex);
             cv_producer.wait(lock, [&] { 
@@ -253,6 +249,7 @@ void producer_consumer_example() {
     
     // Consumer function
     auto consumer = [&](int id) {
+        ThreadSchedScope sched_scope(sched, "consumer_" + to_string(id));
         while (true) {
             unique_lock<mutex> lock(queue_mutex);
             cv_consumer.wait(lock, [&] { 
@@ -304,15 +301,13 @@ void producer_consumer_example() {
 }
 
 // 4. Thread pool example
-void thread_pool_example() {
+void thread_pool_example(int pool_size = thread::hardware_concurrency(), int num_tasks = 1000) {
     cout << "\n4. Thread Pool Example:" << endl;
     
-    const int pool_size = thread::hardware_concurrency();
-    const int num_tasks = 1000;
-    
     {
+        SchedSection sched("Thread pool");
         Timer timer("Thread pool execution");
-        ThreadPool pool(pool_size);
+        ThreadPool pool(pool_size, &sched);
         vector<future<long long>> futures;
         
         for (int i = 0; i < num_tasks; ++i) {
@@ -335,14 +330,12 @@ void thread_pool_example() {
 }
 
 // 5. False sharing demonstration
-void false_sharing_example() {
+void false_sharing_example(int num_threads = 4, int iterations = 100000000) {
     cout << "\n5. False Sharing Example:" << endl;
     
-    const int num_threads = 4;
-    const int iterations = 100000000;
-    
     // With false sharing
     {
+        SchedSection sched("False sharing");
         Timer timer("With false sharing");
         struct Counter {
             long long value;
@@ -352,7 +345,8 @@ void false_sharing_example() {
         vector<thread> threads;
         
         for (int i = 0; i < num_threads; ++i) {
-            threads.emplace_back([&counters, i, iterations]() {
+            threads.emplace_back([&counters, i, iterations, &sched]() {
+                ThreadSchedScope sched_scope(sched, "worker_" + to_string(i));
                 for (int j = 0; j < iterations; ++j) {
                     counters[i].value++;
                 }
@@ -366,6 +360,7 @@ void false_sharing_example() {
     
     // Without false sharing (padded)
     {
+        SchedSection sched("Padded counters");
         Timer timer("Without false sharing (padded)");
         struct PaddedCounter {
             alignas(64) long long value;  // Cache line size padding
@@ -375,7 +370,8 @@ void false_sharing_example() {
         vector<thread> threads;
         
         for (int i = 0; i < num_threads; ++i) {
-            threads.emplace_back([&counters, i, iterations]() {
+            threads.emplace_back([&counters, i, iterations, &sched]() {
+                ThreadSchedScope sched_scope(sched, "worker_" + to_string(i));
                 for (int j = 0; j < iterations; ++j) {
                     counters[i].value++;
                 }
@@ -389,12 +385,10 @@ void false_sharing_example() {
 }
 
 // 6. Work stealing example (simplified)
-void work_stealing_example() {
+void work_stealing_example(int num_threads = 4, int total_work = 1000000) {
     cout << "\n6. Work Stealing Pattern:" << endl;
     
-    const int num_threads = 4;
-    const int total_work = 1000000;
-    
+    SchedSection sched("Work stealing");
     Timer timer("Work stealing execution");
     
     // Per-thread work queues
@@ -409,6 +403,7 @@ void work_stealing_example() {
     
     // Worker function with work stealing
     auto worker = [&](int id) {
+        ThreadSchedScope sched_scope(sched, "worker_" + to_string(id));
         random_device rd;
         mt19937 gen(rd());
         uniform_int_distribution<> dis(0, num_threads - 1);
@@ -463,13 +458,12 @@ void work_stealing_example() {
 }
 
 // 7. Async/future example
-void async_future_example() {
+void async_future_example(int num_tasks = 100) {
     cout << "\n7. Async/Future Example:" << endl;
     
-    const int num_tasks = 100;
-    
     // Using async with deferred policy
     {
+        SchedSection sched("Deferred policy");
         Timer timer("Async with deferred policy");
         vector<future<long long>> futures;
         
@@ -488,11 +482,13 @@ void async_future_example() {
     
     // Using async with async policy
     {
+        SchedSection sched("Async policy");
         Timer timer("Async with async policy");
         vector<future<long long>> futures;
         
         for (int i = 0; i < num_tasks; ++i) {
-            futures.push_back(async(launch::async, [i]() {
+            futures.push_back(async(launch::async, [i, &sched]() {
+                ThreadSchedScope sched_scope(sched, "task");
                 return cpu_bound_task(10000);
             }));
         }
@@ -505,6 +501,31 @@ void async_future_example() {
     }
 }
 
+// Sections available to bench_driver
+static BenchRegistrar reg_basic("threading/basic", "loop iterations per thread", 10000000, true,
+    [](const BenchContext& ctx) { basic_threading_example(bench_threads(ctx), static_cast<int>(ctx.size)); });
+static BenchRegistrar reg_mutex("threading/mutex", "lock acquisitions per thread", 1000000, true,
+    [](const BenchContext& ctx) {
+        mutex_contention_example(ctx.threads > 0 ? ctx.threads : 8, static_cast<int>(ctx.size));
+    });
+static BenchRegistrar reg_producer_consumer("threading/producer-consumer", "items per producer (2 producers)",
+    10000, true, [](const BenchContext& ctx) {
+        producer_consumer_example(ctx.threads > 0 ? ctx.threads : 4, static_cast<int>(ctx.size));
+    });
+static BenchRegistrar reg_pool("threading/thread-pool", "tasks", 1000, true,
+    [](const BenchContext& ctx) { thread_pool_example(bench_threads(ctx), static_cast<int>(ctx.size)); });
+static BenchRegistrar reg_false_sharing("threading/false-sharing", "increments per thread", 100000000, true,
+    [](const BenchContext& ctx) {
+        false_sharing_example(ctx.threads > 0 ? ctx.threads : 4, static_cast<int>(ctx.size));
+    });
+static BenchRegistrar reg_work_stealing("threading/work-stealing", "work items", 1000000, true,
+    [](const BenchContext& ctx) {
+        work_stealing_example(ctx.threads > 0 ? ctx.threads : 4, static_cast<int>(ctx.size));
+    });
+static BenchRegistrar reg_async("threading/async", "tasks", 100, false,
+    [](const BenchContext& ctx) { async_future_example(static_cast<int>(ctx.size)); });
+
+#ifndef NSYS_BENCH_DRIVER
 int main() {
     cout << "Multithreading Profiling Examples" << endl;
     cout << "Hardware concurrency: " << thread::hardware_concurrency() << " threads" << endl;
@@ -526,6 +547,8 @@ int main() {
     cout << "- Look for lock contention and synchronization overhead" << endl;
     cout << "- Compare CPU utilization across different threading patterns" << endl;
     cout << "- Check for false sharing effects in performance" << endl;
+    cout << "- Compare runnable vs blocked time in the scheduler accounting tables" << endl;
     
     return 0;
-}
\ No newline at end of file
+}
+#endif
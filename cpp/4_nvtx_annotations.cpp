@@ -13,6 +13,16 @@
 #include <cmath>
 #include <string>
 #include <functional>
+#include <iomanip>
+#include <random>
+#include <atomic>
+#include <memory>
+#include <sstream>
+#include <cstdlib>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
 
 // NVTX header - will be conditionally included
 #ifdef USE_NVTX
@@ -42,16 +52,29 @@ namespace {
 }
 #endif
 
+#include "autotune.h"
+#include "bench_registry.h"
+#include "cpu_dispatch.h"
+#include "pipeline.h"
+#include "running_stats.h"
+#include "timer.h"
+
 using namespace std;
 using namespace std::chrono;
 
 // Helper class for NVTX ranges with RAII
+// A range may carry Work metadata: it is attached as the NVTX payload and the
+// range reports its duration and derived rates when it closes.
 class NVTXRange {
 private:
     bool active;
+    string name;
+    Work work;
+    high_resolution_clock::time_point start_time;
     
 public:
-    NVTXRange(const string& name, uint32_t color = 0xFF00FF00) : active(true) {
+    NVTXRange(const string& range_name, uint32_t color = 0xFF00FF00, const Work& range_work = Work())
+        : active(true), name(range_name), work(range_work) {
 #ifdef USE_NVTX
         nvtxEventAttributes_t eventAttrib = {0};
         eventAttrib.version = NVTX_VERSION;
@@ -60,15 +83,28 @@ public:
         eventAttrib.color = color;
         eventAttrib.messageType = NVTX_MESSAGE_TYPE_ASCII;
         eventAttrib.message.ascii = name.c_str();
+        if (!work.empty()) {
+            // Payload shows up next to the range in the timeline: bytes, else items, else FLOPs
+            eventAttrib.payloadType = NVTX_PAYLOAD_TYPE_UNSIGNED_INT64;
+            eventAttrib.payload.ullValue = static_cast<uint64_t>(
+                work.bytes() > 0 ? work.bytes() : (work.items > 0 ? work.items : work.flops));
+        }
         nvtxRangePushEx(&eventAttrib);
 #else
+        (void)color;
         nvtxRangePushA(name.c_str());
 #endif
+        start_time = high_resolution_clock::now();
     }
     
     ~NVTXRange() {
         if (active) {
             nvtxRangePop();
+            if (!work.empty()) {
+                double seconds = duration<double>(high_resolution_clock::now() - start_time).count();
+                cout << "   [" << name << "] " << fixed << setprecision(3) << seconds << "s\n"
+                     << format_throughput(work, seconds) << defaultfloat << endl;
+            }
         }
     }
     
@@ -77,29 +113,13 @@ public:
     NVTXRange& operator=(const NVTXRange&) = delete;
     
     // Enable move
-    NVTXRange(NVTXRange&& other) : active(other.active) {
+    NVTXRange(NVTXRange&& other)
+        : active(other.active), name(move(other.name)), work(other.work),
+          start_time(other.start_time) {
         other.active = false;
     }
 };
 
-// Timer utility with NVTX integration
-class Timer {
-private:
-    high_resolution_clock::time_point start_time;
-    string name;
-
-public:
-    Timer(const string& timer_name) : name(timer_name) {
-        start_time = high_resolution_clock::now();
-    }
-
-    ~Timer() {
-        auto end_time = high_resolution_clock::now();
-        auto duration = duration_cast<milliseconds>(end_time - start_time);
-        cout << "   " << name << ": " << duration.count() / 1000.0 << "s" << endl;
-    }
-};
-
 // Color definitions for NVTX
 namespace Colors {
     const uint32_t RED = 0xFFFF0000;
@@ -112,23 +132,248 @@ namespace Colors {
     const uint32_t WHITE = 0xFFFFFFFF;
 }
 
-// Data preprocessing with NVTX annotations
-vector<double> preprocess_data(size_t size) {
-    NVTXRange range("DataPreprocessing", Colors::RED);
+// Annotation granularity for hot inner ranges. FULL pushes one NVTX range per
+// call, AGGREGATED only accumulates count/total/min/max and emits a summary at
+// the enclosing AggregateScope, OFF records nothing. NSYS_NVTX_DETAIL=full|aggregate|off
+// selects the initial mode (default: aggregate).
+enum class AnnotationMode { FULL, AGGREGATED, OFF };
+
+struct AnnotationConfig {
+    static AnnotationMode& mode() {
+        static AnnotationMode current = from_env();
+        return current;
+    }
+    static void set(AnnotationMode m) { mode() = m; }
+    static const char* name(AnnotationMode m) {
+        return m == AnnotationMode::FULL ? "full" : (m == AnnotationMode::AGGREGATED ? "aggregated" : "off");
+    }
+
+private:
+    static AnnotationMode from_env() {
+        const char* env = getenv("NSYS_NVTX_DETAIL");
+        string value = env ? env : "aggregate";
+        if (value == "full") return AnnotationMode::FULL;
+        if (value == "off") return AnnotationMode::OFF;
+        return AnnotationMode::AGGREGATED;
+    }
+};
+
+// Per-thread accumulated statistics for one aggregated range name
+struct RangeAggregate {
+    const char* name;
+    size_t count = 0;
+    double total_s = 0;
+    double min_s = 1e30;
+    double max_s = 0;
+};
+
+// Keyed by the name pointer (string literals), so lookup is a short linear scan
+vector<RangeAggregate>& thread_range_aggregates() {
+    thread_local vector<RangeAggregate> aggregates;
+    return aggregates;
+}
+
+// Repeated inner range: a real NVTX range in FULL mode (suffixed with `index`
+// when given), a thread-local counter update in AGGREGATED mode
+class AggregateRange {
+private:
+    const char* name;
+    AnnotationMode mode;
+    high_resolution_clock::time_point start_time;
+
+public:
+    AggregateRange(const char* range_name, uint32_t color = Colors::BLUE, long index = -1)
+        : name(range_name), mode(AnnotationConfig::mode()) {
+        if (mode == AnnotationMode::FULL) {
+            string label = index >= 0 ? string(name) + "_" + to_string(index) : string(name);
+#ifdef USE_NVTX
+            nvtxEventAttributes_t eventAttrib = {0};
+            eventAttrib.version = NVTX_VERSION;
+            eventAttrib.size = NVTX_EVENT_ATTRIB_STRUCT_SIZE;
+            eventAttrib.colorType = NVTX_COLOR_ARGB;
+            eventAttrib.color = color;
+            eventAttrib.messageType = NVTX_MESSAGE_TYPE_ASCII;
+            eventAttrib.message.ascii = label.c_str();
+            nvtxRangePushEx(&eventAttrib);
+#else
+            (void)color;
+            nvtxRangePushA(label.c_str());
+#endif
+        } else if (mode == AnnotationMode::AGGREGATED) {
+            (void)color;
+            start_time = high_resolution_clock::now();
+        }
+    }
+
+    ~AggregateRange() {
+        if (mode == AnnotationMode::FULL) {
+            nvtxRangePop();
+        } else if (mode == AnnotationMode::AGGREGATED) {
+            double seconds = duration<double>(high_resolution_clock::now() - start_time).count();
+            auto& aggregates = thread_range_aggregates();
+            auto it = find_if(aggregates.begin(), aggregates.end(),
+                              [this](const RangeAggregate& a) { return a.name == name; });
+            if (it == aggregates.end()) {
+                aggregates.push_back(RangeAggregate{name});
+                it = aggregates.end() - 1;
+            }
+            it->count++;
+            it->total_s += seconds;
+            it->min_s = min(it->min_s, seconds);
+            it->max_s = max(it->max_s, seconds);
+        }
+    }
+
+    AggregateRange(const AggregateRange&) = delete;
+    AggregateRange& operator=(const AggregateRange&) = delete;
+};
+
+// Enclosing scope for aggregated ranges: an ordinary NVTX range that, on exit,
+// emits one summary marker per inner range name recorded on this thread while
+// it was open. Nested scopes keep their counters separate.
+class AggregateScope {
+private:
+    NVTXRange range;
+    vector<RangeAggregate> outer;
+    bool verbose;
+
+public:
+    AggregateScope(const string& scope_name, uint32_t color = Colors::PURPLE, bool print_summary = true)
+        : range(scope_name, color), verbose(print_summary) {
+        outer.swap(thread_range_aggregates());
+    }
+
+    ~AggregateScope() {
+        auto& aggregates = thread_range_aggregates();
+        for (const auto& a : aggregates) {
+            ostringstream summary;
+            summary << fixed << setprecision(3) << a.name << " x" << a.count
+                    << " total=" << a.total_s * 1e3 << "ms min=" << a.min_s * 1e3
+                    << "ms max=" << a.max_s * 1e3 << "ms";
+            nvtxMarkA(summary.str().c_str());
+            if (verbose) {
+                cout << "     [" << summary.str() << "]" << endl;
+            }
+        }
+        aggregates.swap(outer);
+    }
+
+    AggregateScope(const AggregateScope&) = delete;
+    AggregateScope& operator=(const AggregateScope&) = delete;
+};
+
+// Preprocessed features in structure-of-arrays form: one column per feature.
+// Columns are default-initialized so preallocation does not cost a zeroing pass.
+struct FeatureColumns {
+    size_t count;
+    unique_ptr<double[]> value;
+    unique_ptr<double[]> square;
+    unique_ptr<double[]> magnitude;
     
-    // Data loading phase
-    vector<double> data;
+    explicit FeatureColumns(size_t n = 0)
+        : count(n), value(new double[n]), square(new double[n]), magnitude(new double[n]) {}
+    size_t size() const { return count; }
+};
+
+// Fused normalize + feature extraction for one chunk, written straight into SoA columns
+void normalize_extract(const double* in, size_t n, double mean, double inv_std,
+                       double* value, double* square, double* magnitude) {
+    for (size_t i = 0; i < n; ++i) {
+        double v = (in[i] - mean) * inv_std;
+        value[i] = v;
+        square[i] = v * v;
+        magnitude[i] = abs(v);
+    }
+}
+
+// Runs fn(begin, end) over num_threads contiguous slices of [0, n); slice 0 on the caller
+void parallel_slices(size_t n, int num_threads, const function<void(size_t, size_t)>& fn) {
+    vector<thread> workers;
+    for (int t = 1; t < num_threads; ++t) {
+        workers.emplace_back(fn, n * t / num_threads, n * (t + 1) / num_threads);
+    }
+    fn(0, n / num_threads);
+    for (auto& w : workers) {
+        w.join();
+    }
+}
+
+// Fused normalize/extract sweep over in-memory data into preallocated SoA output
+FeatureColumns extract_features(const vector<double>& data, const RunningStats& stats, int num_threads) {
+    NVTXRange fused_range("NormalizeExtractFeatures", Colors::BLUE);
+    const size_t size = data.size();
+    FeatureColumns features(size);
+    double mean = stats.mean;
+    double inv_std = 1.0 / (stats.stddev() + 1e-8);
+    parallel_slices(size, num_threads, [&](size_t begin, size_t end) {
+        normalize_extract(&data[begin], end - begin, mean, inv_std,
+                          &features.value[begin], &features.square[begin],
+                          &features.magnitude[begin]);
+    });
+    return features;
+}
+
+// In-memory preprocessing: one parallel statistics sweep, then one fused
+// normalize/extract sweep into preallocated SoA output
+FeatureColumns preprocess_fused(const vector<double>& data, int num_threads) {
+    RunningStats stats;
     {
-        NVTXRange load_range("LoadData", Colors::YELLOW);
-        data.resize(size);
-        for (size_t i = 0; i < size; ++i) {
-            data[i] = static_cast<double>(rand()) / RAND_MAX;
+        NVTXRange stats_range("ComputeStats", Colors::GREEN);
+        stats = compute_stats_parallel(data.data(), data.size(), num_threads);
+    }
+    return extract_features(data, stats, num_threads);
+}
+
+// Source of input chunks for one pass: fills buffer, returns values read (0 at end)
+using ChunkReader = function<size_t(double* buffer, size_t capacity)>;
+// Receives each chunk of features in SoA form with its offset in the stream
+using FeatureSink = function<void(size_t offset, const double* value, const double* square,
+                                  const double* magnitude, size_t n)>;
+
+// Streaming preprocessing for inputs larger than memory. Pass 1 streams every
+// chunk through parallel statistics and merges them; pass 2 re-opens the source
+// and normalizes/extracts each chunk in one fused sweep. Memory use is
+// O(chunk_size) regardless of input length.
+RunningStats preprocess_stream(const function<ChunkReader()>& open_pass, const FeatureSink& sink,
+                               size_t chunk_size, int num_threads) {
+    vector<double> chunk(chunk_size);
+    FeatureColumns out(chunk_size);
+    
+    RunningStats stats;
+    {
+        NVTXRange stats_range("StreamStats", Colors::GREEN);
+        ChunkReader read = open_pass();
+        while (size_t n = read(chunk.data(), chunk_size)) {
+            stats.merge(compute_stats_parallel(chunk.data(), n, num_threads));
+        }
+    }
+    
+    {
+        NVTXRange fused_range("StreamNormalizeExtract", Colors::BLUE);
+        double mean = stats.mean;
+        double inv_std = 1.0 / (stats.stddev() + 1e-8);
+        ChunkReader read = open_pass();
+        size_t offset = 0;
+        while (size_t n = read(chunk.data(), chunk_size)) {
+            parallel_slices(n, num_threads, [&](size_t begin, size_t end) {
+                normalize_extract(&chunk[begin], end - begin, mean, inv_std,
+                                  &out.value[begin], &out.square[begin], &out.magnitude[begin]);
+            });
+            sink(offset, out.value.get(), out.square.get(), out.magnitude.get(), n);
+            offset += n;
         }
-        this_thread::sleep_for(milliseconds(100)); // Simulate I/O
     }
+    return stats;
+}
+
+// Original three-pass normalization followed by interleaved feature extraction
+// (kept as the baseline for the preprocessing benchmark)
+vector<double> preprocess_multipass(vector<double>& data) {
+    size_t size = data.size();
     
     // Normalization phase
     {
+        // Three passes: mean, variance, then an in-place normalize
         NVTXRange norm_range("Normalize", Colors::GREEN);
         double mean = accumulate(data.begin(), data.end(), 0.0) / size;
         double sq_sum = 0;
@@ -158,69 +403,637 @@ vector<double> preprocess_data(size_t size) {
     }
 }
 
-// Model training simulation with nested NVTX ranges
-vector<double> train_model(const vector<double>& data, int epochs = 10) {
-    NVTXRange range("ModelTraining", Colors::PURPLE);
-    Timer timer("Model training");
+// Data preprocessing with NVTX annotations. Loading runs on a bounded
+// pipeline: while chunk k+1 is being loaded (simulated I/O), chunk k's
+// statistics are computed and it is appended, so the sleeps overlap with
+// compute. pipeline_depth 0 runs the same stages sequentially.
+FeatureColumns preprocess_data(size_t size, size_t pipeline_depth = 2,
+                               PipelineStats* load_stats = nullptr) {
+    NVTXRange range("DataPreprocessing", Colors::RED);
+    const size_t num_chunks = 8;
+    const auto io_latency = milliseconds(100) / num_chunks;  // same total simulated I/O as before
     
-    size_t n_features = data.size();
-    vector<double> weights(n_features);
-    for (auto& w : weights) {
-        w = static_cast<double>(rand()) / RAND_MAX;
+    struct Chunk {
+        size_t index = 0;
+        vector<double> values;
+        RunningStats stats;
+    };
+    
+    // Data loading phase: load -> chunk statistics -> append
+    vector<double> data(size);
+    RunningStats stats;
+    {
+        NVTXRange load_range("LoadData", Colors::YELLOW,
+                              Work().with_items(size).with_bytes(size * sizeof(double),
+                                                                 2 * size * sizeof(double)));
+        size_t next_chunk = 0;
+        PipelineStats pipeline = run_pipeline<Chunk, Chunk>(pipeline_depth,
+            [&](Chunk& chunk) {
+                if (next_chunk == num_chunks) {
+                    return false;
+                }
+                NVTXRange chunk_range("LoadChunk_" + to_string(next_chunk), Colors::YELLOW);
+                size_t begin = size * next_chunk / num_chunks;
+                size_t end = size * (next_chunk + 1) / num_chunks;
+                chunk.index = next_chunk++;
+                chunk.values.resize(end - begin);
+                for (auto& val : chunk.values) {
+                    val = static_cast<double>(rand()) / RAND_MAX;
+                }
+                this_thread::sleep_for(io_latency); // Simulate I/O
+                return true;
+            },
+            [](Chunk& chunk) {
+                NVTXRange stats_range("ChunkStats_" + to_string(chunk.index), Colors::GREEN);
+                chunk.stats = compute_stats(chunk.values.data(), chunk.values.size());
+                return move(chunk);
+            },
+            [&](Chunk& chunk) {
+                size_t begin = size * chunk.index / num_chunks;
+                copy(chunk.values.begin(), chunk.values.end(), data.begin() + begin);
+                stats.merge(chunk.stats);
+            });
+        if (load_stats) {
+            *load_stats = pipeline;
+        }
     }
     
-    double learning_rate = 0.01;
+    // Fused normalize/extract sweep with the statistics gathered while loading
+    NVTXRange process_range("NormalizeAndExtract", Colors::GREEN,
+                            Work().with_items(size)
+                                  .with_bytes(size * sizeof(double), 3 * size * sizeof(double))
+                                  .with_flops(6.0 * size));
+    return extract_features(data, stats, max(1u, thread::hardware_concurrency()));
+}
+
+// Multi-pass vs fused vs out-of-core streaming preprocessing
+void preprocessing_benchmark(size_t size = 8 * 1024 * 1024,
+                             int threads = max(1u, thread::hardware_concurrency())) {
+    NVTXRange range("PreprocessingBenchmark", Colors::CYAN);
+    const double bytes = size * sizeof(double);
+    
+    vector<double> data(size);
+    mt19937_64 gen(3);
+    uniform_real_distribution<double> dist(0.0, 1.0);
+    for (auto& v : data) {
+        v = dist(gen);
+    }
+    
+    cout << "\n   Preprocessing " << size / (1024 * 1024) << "M values:" << endl;
+    
+    // Baseline: 4 reads + 4 writes of the data (mean, variance, normalize, features)
+    vector<double> multipass;
+    {
+        vector<double> copy = data;
+        cout << "     Passes over memory: 8 (4 read + 4 write)" << endl;
+        Timer timer("Multi-pass (original)",
+                    Work().with_items(size).with_bytes(4 * bytes, 4 * bytes));
+        multipass = preprocess_multipass(copy);
+    }
     
-    for (int epoch = 0; epoch < epochs; ++epoch) {
-        NVTXRange epoch_range("Epoch_" + to_string(epoch), Colors::ORANGE);
+    // Fused in memory: stats read + fused read + 3 column writes
+    FeatureColumns fused;
+    {
+        cout << "     Passes over memory: 5 (2 read + 3 write)" << endl;
+        Timer timer("Fused SoA (" + to_string(threads) + " threads)",
+                    Work().with_items(size).with_bytes(2 * bytes, 3 * bytes));
+        fused = preprocess_fused(data, threads);
+    }
+    
+    // Every feature of every element; the two paths accumulate the statistics
+    // in a different order, so allow rounding differences
+    double max_diff = 0;
+    for (size_t i = 0; i < size; ++i) {
+        max_diff = max({max_diff, abs(multipass[3 * i] - fused.value[i]),
+                        abs(multipass[3 * i + 1] - fused.square[i]),
+                        abs(multipass[3 * i + 2] - fused.magnitude[i])});
+    }
+    cout << "     Results match: " << (max_diff < 1e-9 ? "yes" : "no") << " (max difference "
+         << scientific << setprecision(2) << max_diff << defaultfloat << setprecision(6) << ")" << endl;
+    
+    // Out-of-core: a generated stream 4x the in-memory size, processed in 1M-value
+    // chunks so resident memory stays at a few chunk buffers
+    {
+        const size_t stream_size = 4 * size;
+        const size_t chunk_size = 1024 * 1024;
+        auto open_pass = [stream_size]() -> ChunkReader {
+            auto position = make_shared<size_t>(0);
+            return [position, stream_size](double* buffer, size_t capacity) {
+                size_t n = min(capacity, stream_size - *position);
+                for (size_t i = 0; i < n; ++i) {
+                    // splitmix64 of the stream position: reproducible across both passes
+                    uint64_t z = (*position + i) * 0x9E3779B97F4A7C15ULL;
+                    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+                    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+                    buffer[i] = static_cast<double>((z ^ (z >> 31)) >> 11) * 0x1.0p-53;
+                }
+                *position += n;
+                return n;
+            };
+        };
         
-        // Forward pass
-        double loss = 0;
+        double sum = 0;
+        cout << "     Stream: " << stream_size * sizeof(double) / (1024 * 1024) << " MB input, "
+             << 4 * chunk_size * sizeof(double) / (1024 * 1024) << " MB resident" << endl;
+        Timer timer("Streaming out-of-core (" + to_string(threads) + " threads)",
+                    Work().with_items(stream_size)
+                          .with_bytes(2.0 * stream_size * sizeof(double),
+                                      3.0 * stream_size * sizeof(double)));
+        RunningStats stats = preprocess_stream(open_pass,
+            [&sum](size_t, const double* value, const double*, const double*, size_t n) {
+                sum += value[n - 1];
+            }, chunk_size, threads);
+        cout << "     Stream mean: " << stats.mean << ", stddev: " << stats.stddev() << endl;
+    }
+}
+
+// Dense regression dataset: row-major samples x features plus one target per sample
+struct FeatureMatrix {
+    size_t rows = 0;
+    size_t cols = 0;
+    vector<double> x;
+    vector<double> y;
+    
+    const double* row(size_t i) const { return &x[i * cols]; }
+};
+
+// Synthetic linear-regression data: y = x . w_true + noise
+FeatureMatrix make_regression_dataset(size_t samples, size_t features, unsigned seed = 42) {
+    NVTXRange range("MakeDataset", Colors::YELLOW);
+    mt19937 gen(seed);
+    normal_distribution<double> feature_dist(0.0, 1.0);
+    normal_distribution<double> noise_dist(0.0, 0.01);
+    
+    vector<double> true_weights(features);
+    for (auto& w : true_weights) {
+        w = feature_dist(gen);
+    }
+    
+    FeatureMatrix m;
+    m.rows = samples;
+    m.cols = features;
+    m.x.resize(samples * features);
+    m.y.resize(samples);
+    for (size_t i = 0; i < samples; ++i) {
+        double target = 0;
+        for (size_t j = 0; j < features; ++j) {
+            double v = feature_dist(gen);
+            m.x[i * features + j] = v;
+            target += v * true_weights[j];
+        }
+        m.y[i] = target + noise_dist(gen);
+    }
+    return m;
+}
+
+// Fused forward/backward for one sample: pred = x . w, grad += (pred - y) * x.
+// Returns the residual; the row is still in L1 for the second pass.
+double sgd_accumulate_scalar(const double* x, const double* w, double y, double* grad, size_t n) {
+    double pred = 0;
+    for (size_t j = 0; j < n; ++j) {
+        pred += x[j] * w[j];
+    }
+    double err = pred - y;
+    for (size_t j = 0; j < n; ++j) {
+        grad[j] += err * x[j];
+    }
+    return err;
+}
+
+#if defined(__x86_64__)
+__attribute__((target("avx2,fma")))
+double sgd_accumulate_avx2(const double* x, const double* w, double y, double* grad, size_t n) {
+    __m256d acc0 = _mm256_setzero_pd();
+    __m256d acc1 = _mm256_setzero_pd();
+    size_t j = 0;
+    for (; j + 8 <= n; j += 8) {
+        acc0 = _mm256_fmadd_pd(_mm256_loadu_pd(x + j), _mm256_loadu_pd(w + j), acc0);
+        acc1 = _mm256_fmadd_pd(_mm256_loadu_pd(x + j + 4), _mm256_loadu_pd(w + j + 4), acc1);
+    }
+    for (; j + 4 <= n; j += 4) {
+        acc0 = _mm256_fmadd_pd(_mm256_loadu_pd(x + j), _mm256_loadu_pd(w + j), acc0);
+    }
+    acc0 = _mm256_add_pd(acc0, acc1);
+    __m128d half = _mm_add_pd(_mm256_castpd256_pd128(acc0), _mm256_extractf128_pd(acc0, 1));
+    double pred = _mm_cvtsd_f64(_mm_add_sd(half, _mm_unpackhi_pd(half, half)));
+    for (; j < n; ++j) {
+        pred += x[j] * w[j];
+    }
+    
+    double err = pred - y;
+    __m256d e = _mm256_set1_pd(err);
+    j = 0;
+    for (; j + 4 <= n; j += 4) {
+        _mm256_storeu_pd(grad + j, _mm256_fmadd_pd(e, _mm256_loadu_pd(x + j),
+                                                   _mm256_loadu_pd(grad + j)));
+    }
+    for (; j < n; ++j) {
+        grad[j] += err * x[j];
+    }
+    return err;
+}
+#endif
+
+// Accumulates the gradient of a block of rows into grad; returns the summed squared error
+double sgd_block_gradient(const FeatureMatrix& data, const size_t* rows, size_t count,
+                          const double* w, double* grad) {
+    static const bool use_avx2 = isa_supported(IsaLevel::AVX2);
+    double loss = 0;
+    for (size_t r = 0; r < count; ++r) {
+        size_t i = rows[r];
+        double err;
+#if defined(__x86_64__)
+        if (use_avx2) {
+            err = sgd_accumulate_avx2(data.row(i), w, data.y[i], grad, data.cols);
+        } else
+#endif
         {
-            NVTXRange forward_range("Forward", Colors::CYAN);
-            for (size_t i = 0; i < n_features; ++i) {
-                loss += data[i] * weights[i];
+            err = sgd_accumulate_scalar(data.row(i), w, data.y[i], grad, data.cols);
+        }
+        loss += err * err;
+    }
+    return loss;
+}
+
+// Reusable barrier for the persistent training threads (spins, then yields)
+class SpinBarrier {
+private:
+    const int count;
+    atomic<int> waiting;
+    atomic<int> generation;
+    
+public:
+    explicit SpinBarrier(int n) : count(n), waiting(0), generation(0) {}
+    
+    void arrive_and_wait() {
+        int gen = generation.load(memory_order_acquire);
+        if (waiting.fetch_add(1, memory_order_acq_rel) == count - 1) {
+            waiting.store(0, memory_order_relaxed);
+            generation.fetch_add(1, memory_order_release);
+            return;
+        }
+        for (int spins = 0; generation.load(memory_order_acquire) == gen; ++spins) {
+            if (spins > 64) {
+                this_thread::yield();
             }
-            loss = loss * loss; // Squared loss
         }
+    }
+};
+
+struct SGDConfig {
+    int epochs = 10;
+    size_t batch_size = 256;
+    int num_threads = 1;
+    double learning_rate = 0.05;
+    bool hogwild = false;     // lock-free asynchronous updates instead of synchronous steps
+    bool annotate = true;     // per-epoch NVTX ranges and marks
+};
+
+struct SGDResult {
+    vector<double> weights;
+    double seconds = 0;
+    double final_loss = 0;    // mean squared error over the last epoch
+};
+
+// Synchronous data-parallel mini-batch SGD: every step splits the batch across
+// threads, reduces the per-thread gradients with a pairwise tree and updates
+// disjoint slices of the weights in parallel.
+SGDResult sgd_synchronous(const FeatureMatrix& data, const SGDConfig& config) {
+    const size_t n = data.rows, d = data.cols;
+    const int threads = max(1, config.num_threads);
+    const size_t batch = max<size_t>(1, config.batch_size);
+    const size_t stride = (d + 7) / 8 * 8;  // keep each thread's buffer on its own cache lines
+    
+    SGDResult result;
+    result.weights.assign(d, 0.0);
+    vector<double> grads(threads * stride);
+    vector<double> losses(threads * 8);
+    vector<size_t> order(n);
+    iota(order.begin(), order.end(), 0);
+    mt19937 gen(7);
+    double epoch_loss = 0;
+    
+    SpinBarrier barrier(threads);
+    auto body = [&](int t) {
+        double* my_grad = &grads[t * stride];
+        size_t w_begin = d * t / threads, w_end = d * (t + 1) / threads;
         
-        // Backward pass
-        {
-            NVTXRange backward_range("Backward", Colors::PURPLE);
-            for (size_t i = 0; i < n_features; ++i) {
-                double gradient = 2 * loss * data[i];
-                weights[i] -= learning_rate * gradient;
+        for (int epoch = 0; epoch < config.epochs; ++epoch) {
+            if (t == 0) {
+                shuffle(order.begin(), order.end(), gen);
+                epoch_loss = 0;
+            }
+            barrier.arrive_and_wait();
+            unique_ptr<NVTXRange> epoch_range;
+            if (t == 0 && config.annotate) {
+                epoch_range = make_unique<NVTXRange>("Epoch_" + to_string(epoch), Colors::ORANGE);
+            }
+            
+            for (size_t start = 0; start < n; start += batch) {
+                size_t count = min(batch, n - start);
+                size_t lo = start + count * t / threads, hi = start + count * (t + 1) / threads;
+                fill(my_grad, my_grad + d, 0.0);
+                losses[t * 8] = sgd_block_gradient(data, &order[lo], hi - lo,
+                                                   result.weights.data(), my_grad);
+                barrier.arrive_and_wait();
+                
+                // Tree reduction: log2(threads) rounds of pairwise adds
+                for (int step = 1; step < threads; step *= 2) {
+                    if (t % (2 * step) == 0 && t + step < threads) {
+                        const double* other = &grads[(t + step) * stride];
+                        for (size_t j = 0; j < d; ++j) {
+                            my_grad[j] += other[j];
+                        }
+                        losses[t * 8] += losses[(t + step) * 8];
+                    }
+                    barrier.arrive_and_wait();
+                }
+                
+                const double scale = config.learning_rate / count;
+                for (size_t j = w_begin; j < w_end; ++j) {
+                    result.weights[j] -= scale * grads[j];
+                }
+                if (t == 0) {
+                    epoch_loss += losses[0];
+                }
+                barrier.arrive_and_wait();
+            }
+            
+            if (t == 0 && config.annotate) {
+                epoch_range.reset();
+                nvtxMarkA(("Epoch " + to_string(epoch) + " completed").c_str());
             }
         }
+    };
+    
+    auto start = high_resolution_clock::now();
+    vector<thread> workers;
+    for (int t = 1; t < threads; ++t) {
+        workers.emplace_back(body, t);
+    }
+    body(0);
+    for (auto& w : workers) {
+        w.join();
+    }
+    result.seconds = duration<double>(high_resolution_clock::now() - start).count();
+    result.final_loss = epoch_loss / n;
+    return result;
+}
+
+// Hogwild-style SGD: each thread runs mini-batches over its own shard and
+// applies updates to the shared weights without locks. Relaxed atomics make
+// the races well-defined; lost updates are tolerated by design.
+SGDResult sgd_hogwild(const FeatureMatrix& data, const SGDConfig& config) {
+    const size_t n = data.rows, d = data.cols;
+    const int threads = max(1, config.num_threads);
+    const size_t batch = max<size_t>(1, config.batch_size);
+    
+    vector<atomic<double>> shared(d);
+    for (auto& w : shared) {
+        w.store(0.0, memory_order_relaxed);
+    }
+    vector<size_t> order(n);
+    iota(order.begin(), order.end(), 0);
+    mt19937 gen(7);
+    vector<double> losses(threads * 8);
+    
+    SpinBarrier barrier(threads);
+    auto body = [&](int t) {
+        vector<double> local_w(d), grad(d);
+        size_t shard_begin = n * t / threads, shard_end = n * (t + 1) / threads;
         
-        // Mark epoch completion
-        nvtxMarkA(("Epoch " + to_string(epoch) + " completed").c_str());
+        for (int epoch = 0; epoch < config.epochs; ++epoch) {
+            if (t == 0) {
+                shuffle(order.begin(), order.end(), gen);
+            }
+            barrier.arrive_and_wait();
+            unique_ptr<NVTXRange> epoch_range;
+            if (t == 0 && config.annotate) {
+                epoch_range = make_unique<NVTXRange>("Epoch_" + to_string(epoch), Colors::ORANGE);
+            }
+            
+            double loss = 0;
+            for (size_t start = shard_begin; start < shard_end; start += batch) {
+                size_t count = min(batch, shard_end - start);
+                for (size_t j = 0; j < d; ++j) {
+                    local_w[j] = shared[j].load(memory_order_relaxed);
+                }
+                fill(grad.begin(), grad.end(), 0.0);
+                loss += sgd_block_gradient(data, &order[start], count, local_w.data(), grad.data());
+                
+                const double scale = config.learning_rate / count;
+                for (size_t j = 0; j < d; ++j) {
+                    double w = shared[j].load(memory_order_relaxed);
+                    shared[j].store(w - scale * grad[j], memory_order_relaxed);
+                }
+            }
+            losses[t * 8] = loss;
+            barrier.arrive_and_wait();
+            
+            if (t == 0 && config.annotate) {
+                epoch_range.reset();
+                nvtxMarkA(("Epoch " + to_string(epoch) + " completed").c_str());
+            }
+        }
+    };
+    
+    SGDResult result;
+    auto start = high_resolution_clock::now();
+    vector<thread> workers;
+    for (int t = 1; t < threads; ++t) {
+        workers.emplace_back(body, t);
+    }
+    body(0);
+    for (auto& w : workers) {
+        w.join();
     }
+    result.seconds = duration<double>(high_resolution_clock::now() - start).count();
     
-    return weights;
+    double loss = 0;
+    for (int t = 0; t < threads; ++t) {
+        loss += losses[t * 8];
+    }
+    result.final_loss = loss / n;
+    result.weights.resize(d);
+    for (size_t j = 0; j < d; ++j) {
+        result.weights[j] = shared[j].load(memory_order_relaxed);
+    }
+    return result;
 }
 
-// Complex workflow with multiple NVTX domains
-void complex_workflow() {
-    cout << "\n5. Complex Workflow with NVTX Domains:" << endl;
+// Model training with nested NVTX ranges: mini-batch SGD over a feature matrix
+vector<double> train_model(const FeatureMatrix& data, const SGDConfig& config = SGDConfig()) {
+    NVTXRange range("ModelTraining", Colors::PURPLE);
     
-    // Phase 1: Data preparation
+    // Per epoch each sample row is read once by the fused kernel: 4 FLOPs per
+    // feature (dot product FMA + gradient FMA)
+    SGDResult result;
     {
-        NVTXRange range("DataPreparation", Colors::RED);
-        
-        vector<vector<double>> datasets;
-        for (int i = 0; i < 3; ++i) {
-            NVTXRange dataset_range("LoadDataset_" + to_string(i), Colors::YELLOW);
-            
-            vector<double> data(10000);
-            for (auto& val : data) {
+        Timer timer("Model training (" + string(config.hogwild ? "hogwild" : "synchronous") +
+                    ", batch " + to_string(config.batch_size) + ", " +
+                    to_string(config.num_threads) + " threads)",
+                    Work().with_items(double(config.epochs) * data.rows)
+                          .with_bytes(double(config.epochs) * data.rows * (data.cols + 1) * sizeof(double))
+                          .with_flops(4.0 * config.epochs * data.rows * data.cols));
+        result = config.hogwild ? sgd_hogwild(data, config) : sgd_synchronous(data, config);
+    }
+    cout << "     Final MSE: " << scientific << setprecision(3) << result.final_loss
+         << defaultfloat << endl;
+    
+    return result.weights;
+}
+
+// Samples/sec of the SGD engine across thread counts, batch sizes and update modes
+void sgd_scaling_benchmark(const FeatureMatrix& data) {
+    NVTXRange range("SGDScaling", Colors::CYAN);
+    cout << "\n   Mini-batch SGD scaling (" << data.rows << " samples x " << data.cols
+         << " features, 3 epochs):" << endl;
+    cout << "     " << left << setw(13) << "mode" << right << setw(8) << "threads"
+         << setw(8) << "batch" << setw(14) << "samples/s" << setw(12) << "final MSE" << endl;
+    
+    vector<int> thread_counts = {1, 2, 4};
+    int hw = static_cast<int>(thread::hardware_concurrency());
+    if (hw > 4) {
+        thread_counts.push_back(hw);
+    }
+    
+    for (bool hogwild : {false, true}) {
+        for (int threads : thread_counts) {
+            for (size_t batch : {32, 256, 1024}) {
+                SGDConfig config;
+                config.epochs = 3;
+                config.batch_size = batch;
+                config.num_threads = threads;
+                config.hogwild = hogwild;
+                config.annotate = false;
+                SGDResult r = hogwild ? sgd_hogwild(data, config) : sgd_synchronous(data, config);
+                cout << "     " << left << setw(13) << (hogwild ? "hogwild" : "synchronous") << right
+                     << setw(8) << threads << setw(8) << batch
+                     << setw(14) << fixed << setprecision(0) << config.epochs * data.rows / r.seconds
+                     << setw(12) << scientific << setprecision(2) << r.final_loss
+                     << defaultfloat << endl;
+            }
+        }
+    }
+}
+
+// Loads datasets (simulated I/O) and normalizes each one. On the pipeline the
+// 50ms load of dataset i+1 overlaps the normalization of dataset i;
+// pipeline_depth 0 is the original load-then-process sequence.
+vector<vector<double>> prepare_datasets(int count, size_t pipeline_depth,
+                                        PipelineStats* stats = nullptr,
+                                        size_t dataset_size = 10000) {
+    NVTXRange range("DataPreparation", Colors::RED);
+    
+    struct Dataset {
+        int index = 0;
+        vector<double> values;
+    };
+    
+    vector<vector<double>> datasets;
+    int next = 0;
+    PipelineStats pipeline = run_pipeline<Dataset, Dataset>(pipeline_depth,
+        [&](Dataset& dataset) {
+            if (next == count) {
+                return false;
+            }
+            NVTXRange dataset_range("LoadDataset_" + to_string(next), Colors::YELLOW);
+            dataset.index = next++;
+            dataset.values.resize(dataset_size);
+            for (auto& val : dataset.values) {
                 val = static_cast<double>(rand()) / RAND_MAX;
             }
-            datasets.push_back(data);
-            
             this_thread::sleep_for(milliseconds(50));
+            return true;
+        },
+        [](Dataset& dataset) {
+            NVTXRange normalize_range("NormalizeDataset_" + to_string(dataset.index), Colors::GREEN);
+            RunningStats s = compute_stats(dataset.values.data(), dataset.values.size());
+            double inv_std = 1.0 / (s.stddev() + 1e-8);
+            for (auto& val : dataset.values) {
+                val = (val - s.mean) * inv_std;
+            }
+            return move(dataset);
+        },
+        [&](Dataset& dataset) {
+            datasets.push_back(move(dataset.values));
+        });
+    
+    if (stats) {
+        *stats = pipeline;
+    }
+    return datasets;
+}
+
+// Sequential vs pipelined end-to-end time for the loading phases, plus a
+// balanced I/O/compute workload swept over queue depths
+void pipeline_overlap_benchmark() {
+    NVTXRange range("PipelineOverlap", Colors::CYAN);
+    cout << "\n   Overlapped I/O-compute pipeline:" << endl;
+    
+    auto report = [](const string& name, const PipelineStats& sequential, const PipelineStats& pipelined) {
+        cout << "     " << name << ": sequential " << fixed << setprecision(3) << sequential.wall_s
+             << "s, pipelined (depth " << pipelined.depth << ") " << pipelined.wall_s << "s, speedup "
+             << setprecision(2) << sequential.wall_s / pipelined.wall_s << "x" << defaultfloat << endl;
+        pipelined.print();
+    };
+    
+    // The rewritten phases at a size where compute is visible next to the sleeps
+    {
+        PipelineStats sequential, pipelined;
+        preprocess_data(4'000'000, 0, &sequential);
+        preprocess_data(4'000'000, 2, &pipelined);
+        report("preprocess_data LoadData (4M values)", sequential, pipelined);
+    }
+    {
+        PipelineStats sequential, pipelined;
+        prepare_datasets(6, 0, &sequential, 2'000'000);
+        prepare_datasets(6, 2, &pipelined, 2'000'000);
+        report("complex_workflow LoadDataset_i (6 x 2M values)", sequential, pipelined);
+    }
+    
+    // Balanced stages: ~10ms simulated I/O and ~10ms of compute per chunk
+    const size_t chunk_values = 1 << 20;
+    const int num_chunks = 16;
+    for (size_t depth : {0, 1, 2, 4}) {
+        int next = 0;
+        double checksum = 0;
+        PipelineStats stats = run_pipeline<vector<double>, RunningStats>(depth,
+            [&](vector<double>& chunk) {
+                if (next++ == num_chunks) {
+                    return false;
+                }
+                chunk.assign(chunk_values, next * 0.5);
+                this_thread::sleep_for(milliseconds(10));
+                return true;
+            },
+            [](vector<double>& chunk) {
+                RunningStats s;
+                for (int pass = 0; pass < 8; ++pass) {
+                    s = compute_stats(chunk.data(), chunk.size());
+                }
+                return s;
+            },
+            [&](RunningStats& s) { checksum += s.mean; });
+        cout << "     Balanced stages, depth " << depth << ": " << fixed << setprecision(3)
+             << stats.wall_s << "s" << defaultfloat << endl;
+        if (depth == 2) {
+            stats.print();
         }
     }
+}
+
+// Complex workflow with multiple NVTX domains
+void complex_workflow() {
+    cout << "\n5. Complex Workflow with NVTX Domains:" << endl;
+    
+    // Phase 1: Data preparation
+    {
+        PipelineStats stats;
+        auto datasets = prepare_datasets(3, 2, &stats);
+        cout << "   Prepared " << datasets.size() << " datasets in " << fixed << setprecision(3)
+             << stats.wall_s << "s (pipelined)" << defaultfloat << endl;
+    }
     
     // Phase 2: Parallel processing simulation
     {
@@ -260,10 +1073,9 @@ void complex_workflow() {
 }
 
 // Algorithm comparison with NVTX annotations
-void benchmark_algorithms() {
+void benchmark_algorithms(size_t size = 100000) {
     cout << "\n6. Algorithm Comparison with NVTX Annotations:" << endl;
     
-    const size_t size = 100000;
     vector<int> data(size);
     for (size_t i = 0; i < size; ++i) {
         data[i] = rand() % 1000000;
@@ -273,7 +1085,7 @@ void benchmark_algorithms() {
     if (size <= 1000) {
         vector<int> bubble_data = data;
         NVTXRange range("BubbleSort", Colors::RED);
-        Timer timer("Bubble sort");
+        Timer timer("Bubble sort", Work().with_items(size));
         
         for (size_t i = 0; i < size - 1; ++i) {
             if (i % 100 == 0) {
@@ -293,7 +1105,7 @@ void benchmark_algorithms() {
     {
         vector<int> quick_data = data;
         NVTXRange range("QuickSort", Colors::GREEN);
-        Timer timer("Quick sort");
+        Timer timer("Quick sort", Work().with_items(size));
         
         std::function<void(int, int)> quicksort = [&](int low, int high) {
             if (low < high) {
@@ -322,17 +1134,44 @@ void benchmark_algorithms() {
     {
         vector<int> stl_data = data;
         NVTXRange range("STLSort", Colors::BLUE);
-        Timer timer("STL sort");
+        Timer timer("STL sort", Work().with_items(size));
         sort(stl_data.begin(), stl_data.end());
     }
 }
 
+// Tiled multiply annotated at tile granularity (one range per I, J and K tile)
+void tiled_multiply_annotated(const vector<vector<double>>& a, const vector<vector<double>>& b,
+                              vector<vector<double>>& c, size_t size, size_t tile_size) {
+    for (size_t i0 = 0; i0 < size; i0 += tile_size) {
+        AggregateRange tile_i_range("Tile_I", Colors::RED, i0 / tile_size);
+        
+        for (size_t j0 = 0; j0 < size; j0 += tile_size) {
+            AggregateRange tile_j_range("Tile_J", Colors::GREEN, j0 / tile_size);
+            
+            for (size_t k0 = 0; k0 < size; k0 += tile_size) {
+                AggregateRange tile_k_range("Tile_K", Colors::BLUE, k0 / tile_size);
+                
+                // Compute tile
+                size_t i_max = min(i0 + tile_size, size);
+                size_t j_max = min(j0 + tile_size, size);
+                size_t k_max = min(k0 + tile_size, size);
+                
+                for (size_t i = i0; i < i_max; ++i) {
+                    for (size_t j = j0; j < j_max; ++j) {
+                        for (size_t k = k0; k < k_max; ++k) {
+                            c[i][j] += a[i][k] * b[k][j];
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
 // Matrix operations with detailed NVTX profiling
-void matrix_operations_with_nvtx() {
+void matrix_operations_with_nvtx(size_t size = 500) {
     cout << "\n7. Matrix Operations with Detailed NVTX Profiling:" << endl;
     
-    const size_t size = 500;
-    
     // Initialize matrices
     vector<vector<double>> a(size, vector<double>(size));
     vector<vector<double>> b(size, vector<double>(size));
@@ -347,42 +1186,72 @@ void matrix_operations_with_nvtx() {
         }
     }
     
-    // Matrix multiplication with detailed profiling
+    // Tile from the autotuner; annotations are off while it searches so the
+    // trial multiplies do not show up as tile ranges
+    AnnotationMode configured = AnnotationConfig::mode();
+    AnnotationConfig::set(AnnotationMode::OFF);
+    const size_t tile_size = autotune("nvtx.tiled_multiply.tile", size, 64, {16, 32, 64, 128, 256}, [&](long tile) {
+        vector<vector<double>> c(size, vector<double>(size, 0));
+        tiled_multiply_annotated(a, b, c, size, tile);
+    });
+    AnnotationConfig::set(configured);
+    cout << "   Tile size: " << tile_size << endl;
+    
+    // Matrix multiplication with tile annotations in the configured mode
     {
-        NVTXRange range("MatrixMultiplication", Colors::PURPLE);
-        Timer timer("Matrix multiplication");
-        
+        AnnotationMode mode = AnnotationConfig::mode();
+        AggregateScope scope("MatrixMultiplication", Colors::PURPLE);
+        Timer timer(string("Matrix multiplication (") + AnnotationConfig::name(mode) + " annotations)",
+                    Work().with_flops(2.0 * size * size * size));
         vector<vector<double>> c(size, vector<double>(size, 0));
-        
-        // Tile-based multiplication for better cache usage
-        const size_t tile_size = 64;
-        for (size_t i0 = 0; i0 < size; i0 += tile_size) {
-            NVTXRange tile_i_range("Tile_I_" + to_string(i0/tile_size), Colors::RED);
-            
-            for (size_t j0 = 0; j0 < size; j0 += tile_size) {
-                NVTXRange tile_j_range("Tile_J_" + to_string(j0/tile_size), Colors::GREEN);
-                
-                for (size_t k0 = 0; k0 < size; k0 += tile_size) {
-                    NVTXRange tile_k_range("Tile_K_" + to_string(k0/tile_size), Colors::BLUE);
-                    
-                    // Compute tile
-                    size_t i_max = min(i0 + tile_size, size);
-                    size_t j_max = min(j0 + tile_size, size);
-                    size_t k_max = min(k0 + tile_size, size);
-                    
-                    for (size_t i = i0; i < i_max; ++i) {
-                        for (size_t j = j0; j < j_max; ++j) {
-                            for (size_t k = k0; k < k_max; ++k) {
-                                c[i][j] += a[i][k] * b[k][j];
-                            }
-                        }
-                    }
-                }
-            }
+        tiled_multiply_annotated(a, b, c, size, tile_size);
+    }
+    
+    // Annotation overhead: same multiply with every tile range, aggregated, and none
+    size_t tiles = (size + tile_size - 1) / tile_size;
+    cout << "   Annotation overhead (" << tiles + tiles * tiles + tiles * tiles * tiles
+         << " tile ranges per multiply):" << endl;
+    const int repetitions = 3;
+    for (AnnotationMode mode : {AnnotationMode::FULL, AnnotationMode::AGGREGATED, AnnotationMode::OFF}) {
+        AnnotationConfig::set(mode);
+        double best = 1e30;
+        for (int rep = 0; rep < repetitions; ++rep) {
+            vector<vector<double>> c(size, vector<double>(size, 0));
+            AggregateScope scope(string("Multiply_") + AnnotationConfig::name(mode), Colors::PURPLE, false);
+            auto start = high_resolution_clock::now();
+            tiled_multiply_annotated(a, b, c, size, tile_size);
+            best = min(best, duration<double>(high_resolution_clock::now() - start).count());
         }
+        cout << "     " << left << setw(12) << AnnotationConfig::name(mode) << right
+             << fixed << setprecision(4) << best << "s (best of " << repetitions << ")"
+             << defaultfloat << endl;
     }
+    AnnotationConfig::set(configured);
 }
 
+// Sections available to bench_driver
+static BenchRegistrar reg_preprocess("nvtx/preprocess", "values preprocessed", 8 * 1024 * 1024, true,
+    [](const BenchContext& ctx) { preprocessing_benchmark(ctx.size, bench_threads(ctx)); });
+static BenchRegistrar reg_pipeline("nvtx/pipeline", "unused (fixed workload)", 0, false,
+    [](const BenchContext&) { pipeline_overlap_benchmark(); });
+static BenchRegistrar reg_sgd("nvtx/sgd", "training samples (64 features, 5 epochs)", 32768, true,
+    [](const BenchContext& ctx) {
+        FeatureMatrix dataset = make_regression_dataset(ctx.size, 64);
+        SGDConfig config;
+        config.epochs = 5;
+        config.num_threads = bench_threads(ctx);
+        train_model(dataset, config);
+    });
+static BenchRegistrar reg_sgd_scaling("nvtx/sgd-scaling", "training samples (64 features)", 32768, false,
+    [](const BenchContext& ctx) { sgd_scaling_benchmark(make_regression_dataset(ctx.size, 64)); });
+static BenchRegistrar reg_workflow("nvtx/workflow", "unused (fixed workload)", 0, false,
+    [](const BenchContext&) { complex_workflow(); });
+static BenchRegistrar reg_sorting("nvtx/sorting", "elements to sort", 100000, false,
+    [](const BenchContext& ctx) { benchmark_algorithms(ctx.size); });
+static BenchRegistrar reg_tiles("nvtx/tiled-matmul", "matrix dimension", 500, false,
+    [](const BenchContext& ctx) { matrix_operations_with_nvtx(ctx.size); });
+
+#ifndef NSYS_BENCH_DRIVER
 int main() {
     cout << "NVTX Annotations Profiling Examples (C++)" << endl;
 #ifdef USE_NVTX
@@ -392,15 +1261,25 @@ int main() {
 #endif
     cout << "============================================================" << endl;
     
+    // Measure peaks up front so the measurement never lands inside a timed section
+    MachinePeaks::get();
+    
     // Example 1: Basic function annotation
     cout << "\n1. Basic Function Annotations:" << endl;
     auto preprocessed_data = preprocess_data(10000);
-    cout << "   Preprocessed data size: " << preprocessed_data.size() << endl;
+    cout << "   Preprocessed data size: " << preprocessed_data.size() << " samples x 3 features" << endl;
+    preprocessing_benchmark();
+    pipeline_overlap_benchmark();
     
     // Example 2: Nested annotations in training
     cout << "\n2. Model Training with Nested Annotations:" << endl;
-    auto weights = train_model(preprocessed_data, 5);
+    FeatureMatrix dataset = make_regression_dataset(32768, 64);
+    SGDConfig config;
+    config.epochs = 5;
+    config.num_threads = max(1u, thread::hardware_concurrency());
+    auto weights = train_model(dataset, config);
     cout << "   Model weights size: " << weights.size() << endl;
+    sgd_scaling_benchmark(dataset);
     
     // Example 3: Scoped NVTX ranges
     cout << "\n3. Scoped NVTX Ranges Example:" << endl;
@@ -448,6 +1327,8 @@ int main() {
     cout << "- Use 'nsys profile --trace=nvtx' to capture NVTX markers" << endl;
     cout << "- NVTX ranges will appear as colored blocks in the timeline" << endl;
     cout << "- Use different colors to organize your profiling data" << endl;
+    cout << "- NSYS_NVTX_DETAIL=full|aggregate|off sets tile-range granularity (default: aggregate)" << endl;
     
     return 0;
-}
\ No newline at end of file
+}
+#endif
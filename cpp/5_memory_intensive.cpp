@@ -8,38 +8,30 @@
 #include <array>
 #include <chrono>
 #include <algorithm>
+#include <iomanip>
+#include <cmath>
 #include <numeric>
 #include <random>
 #include <memory>
 #include <cstring>
 #include <thread>
 #include <atomic>
+#include <cstdint>
+#include <string>
+#include <unistd.h>
+
+#include "bench_registry.h"
+#include "parallel_primitives.h"
+#include "reductions.h"
+#include "timer.h"
 
 using namespace std;
 using namespace std::chrono;
 
-class Timer {
-private:
-    high_resolution_clock::time_point start_time;
-    string name;
-
-public:
-    Timer(const string& timer_name) : name(timer_name) {
-        start_time = high_resolution_clock::now();
-    }
-
-    ~Timer() {
-        auto end_time = high_resolution_clock::now();
-        auto duration = duration_cast<milliseconds>(end_time - start_time);
-        cout << "   " << name << ": " << duration.count() / 1000.0 << "s" << endl;
-    }
-};
-
 // 1. Sequential vs Random Memory Access
-void memory_access_patterns() {
+void memory_access_patterns(size_t size = 100'000'000) {
     cout << "\n1. Memory Access Patterns:" << endl;
     
-    const size_t size = 100'000'000; // 100M elements
     vector<int> data(size);
     
     // Initialize with random values
@@ -52,11 +44,8 @@ void memory_access_patterns() {
     
     // Sequential access
     {
-        Timer timer("Sequential access");
-        long long sum = 0;
-        for (size_t i = 0; i < size; ++i) {
-            sum += data[i];
-        }
+        Timer timer("Sequential access", Work().with_items(size).with_bytes(size * sizeof(int)));
+        long long sum = reduce_sum(data.data(), size);
         cout << "     Sum: " << sum << endl;
     }
     
@@ -66,33 +55,29 @@ void memory_access_patterns() {
     shuffle(random_indices.begin(), random_indices.end(), gen);
     
     {
-        Timer timer("Random access");
-        long long sum = 0;
-        for (size_t i = 0; i < size; ++i) {
-            sum += data[random_indices[i]];
-        }
+        Timer timer("Random access",
+                    Work().with_items(size).with_bytes(size * (sizeof(int) + sizeof(size_t))));
+        long long sum = reduce_sum_indexed(data.data(), random_indices.data(), size);
         cout << "     Sum: " << sum << endl;
     }
     
     // Strided access (cache-unfriendly)
     {
-        Timer timer("Strided access (stride=64)");
+        Timer timer("Strided access (stride=64)",
+                    Work().with_items(size).with_bytes(size * sizeof(int)));
         long long sum = 0;
         const size_t stride = 64;
-        for (size_t j = 0; j < stride; ++j) {
-            for (size_t i = j; i < size; i += stride) {
-                sum += data[i];
-            }
+        for (size_t j = 0; j < stride && j < size; ++j) {
+            sum += reduce_sum_strided(data.data() + j, (size - j + stride - 1) / stride, stride);
         }
         cout << "     Sum: " << sum << endl;
     }
 }
 
 // 2. Cache Line Effects
-void cache_line_effects() {
+void cache_line_effects(size_t num_elements = 10'000'000) {
     cout << "\n2. Cache Line Effects:" << endl;
     
-    const size_t num_elements = 10'000'000;
     const size_t cache_line_size = 64; // Typical cache line size
     
     // Structure that fits in one cache line
@@ -110,7 +95,9 @@ void cache_line_effects() {
     {
         vector<CacheLinePadded> padded_data(num_elements);
         
-        Timer timer("With cache line padding");
+        Timer timer("With cache line padding",
+                    Work().with_items(num_elements)
+                          .with_bytes(num_elements * sizeof(long long), num_elements * sizeof(long long)));
         for (size_t i = 0; i < num_elements; ++i) {
             padded_data[i].value = i;
         }
@@ -126,7 +113,9 @@ void cache_line_effects() {
     {
         vector<NoPadding> unpadded_data(num_elements);
         
-        Timer timer("Without padding");
+        Timer timer("Without padding",
+                    Work().with_items(num_elements)
+                          .with_bytes(num_elements * sizeof(long long), num_elements * sizeof(long long)));
         for (size_t i = 0; i < num_elements; ++i) {
             unpadded_data[i].value = i;
         }
@@ -140,15 +129,15 @@ void cache_line_effects() {
 }
 
 // 3. Memory Allocation Patterns
-void memory_allocation_patterns() {
+void memory_allocation_patterns(size_t num_allocations = 100'000) {
     cout << "\n3. Memory Allocation Patterns:" << endl;
     
-    const size_t num_allocations = 100'000;
     const size_t allocation_size = 1024; // 1KB each
     
     // Many small allocations
     {
-        Timer timer("Many small allocations (new/delete)");
+        Timer timer("Many small allocations (new/delete)",
+                    Work().with_items(num_allocations).with_bytes(0, num_allocations * allocation_size));
         vector<char*> pointers;
         pointers.reserve(num_allocations);
         
@@ -164,7 +153,8 @@ void memory_allocation_patterns() {
     
     // Pool allocator simulation
     {
-        Timer timer("Pool allocator (pre-allocated)");
+        Timer timer("Pool allocator (pre-allocated)",
+                    Work().with_items(num_allocations).with_bytes(0, num_allocations * allocation_size));
         
         // Pre-allocate large buffer
         vector<char> pool(num_allocations * allocation_size);
@@ -181,7 +171,8 @@ void memory_allocation_patterns() {
     
     // Smart pointer allocations
     {
-        Timer timer("Smart pointer allocations");
+        Timer timer("Smart pointer allocations",
+                    Work().with_items(num_allocations).with_bytes(0, num_allocations * allocation_size));
         vector<unique_ptr<char[]>> pointers;
         pointers.reserve(num_allocations);
         
@@ -195,11 +186,9 @@ void memory_allocation_patterns() {
 }
 
 // 4. Memory Bandwidth Test
-void memory_bandwidth_test() {
+void memory_bandwidth_test(size_t size = 1024 * 1024 * 100) {
     cout << "\n4. Memory Bandwidth Test:" << endl;
     
-    const size_t size = 1024 * 1024 * 100; // 100MB
-    
     // Allocate aligned memory for better performance
     alignas(64) vector<char> src(size);
     alignas(64) vector<char> dst(size);
@@ -209,23 +198,24 @@ void memory_bandwidth_test() {
         src[i] = static_cast<char>(i % 256);
     }
     
-    // Test different copy methods
+    // Test different copy methods (each reads and writes the full buffer)
+    const Work copy_work = Work().with_bytes(size, size);
     
     // memcpy
     {
-        Timer timer("memcpy");
+        Timer timer("memcpy", copy_work);
         memcpy(dst.data(), src.data(), size);
     }
     
     // std::copy
     {
-        Timer timer("std::copy");
+        Timer timer("std::copy", copy_work);
         copy(src.begin(), src.end(), dst.begin());
     }
     
     // Manual copy (byte by byte)
     {
-        Timer timer("Manual copy (byte)");
+        Timer timer("Manual copy (byte)", copy_work);
         for (size_t i = 0; i < size; ++i) {
             dst[i] = src[i];
         }
@@ -233,7 +223,7 @@ void memory_bandwidth_test() {
     
     // Manual copy (8 bytes at a time)
     {
-        Timer timer("Manual copy (8-byte chunks)");
+        Timer timer("Manual copy (8-byte chunks)", copy_work);
         const size_t chunk_size = sizeof(uint64_t);
         const size_t num_chunks = size / chunk_size;
         
@@ -252,11 +242,9 @@ void memory_bandwidth_test() {
 }
 
 // 5. Data Structure Layout Effects
-void data_structure_layout() {
+void data_structure_layout(size_t num_elements = 10'000'000) {
     cout << "\n5. Data Structure Layout Effects:" << endl;
     
-    const size_t num_elements = 10'000'000;
-    
     // Array of Structures (AoS)
     struct Particle_AoS {
         float x, y, z;
@@ -278,6 +266,12 @@ void data_structure_layout() {
             mass(n), charge(n) {}
     };
     
+    // Position update: reads position and velocity, writes position (3 mul + 3 add)
+    const Work update_work = Work().with_items(num_elements)
+                                   .with_bytes(num_elements * 6 * sizeof(float),
+                                               num_elements * 3 * sizeof(float))
+                                   .with_flops(num_elements * 6.0);
+    
     // Test AoS
     {
         vector<Particle_AoS> particles_aos(num_elements);
@@ -291,7 +285,7 @@ void data_structure_layout() {
             };
         }
         
-        Timer timer("Array of Structures (position update)");
+        Timer timer("Array of Structures (position update)", update_work);
         for (auto& p : particles_aos) {
             p.x += p.vx * 0.01f;
             p.y += p.vy * 0.01f;
@@ -315,7 +309,7 @@ void data_structure_layout() {
             particles_soa.charge[i] = float(i % 2 ? 1.0 : -1.0);
         }
         
-        Timer timer("Structure of Arrays (position update)");
+        Timer timer("Structure of Arrays (position update)", update_work);
         for (size_t i = 0; i < num_elements; ++i) {
             particles_soa.x[i] += particles_soa.vx[i] * 0.01f;
             particles_soa.y[i] += particles_soa.vy[i] * 0.01f;
@@ -325,17 +319,16 @@ void data_structure_layout() {
 }
 
 // 6. Memory Fragmentation Test
-void memory_fragmentation_test() {
+void memory_fragmentation_test(size_t num_iterations = 10000) {
     cout << "\n6. Memory Fragmentation Test:" << endl;
     
-    const size_t num_iterations = 10000;
     random_device rd;
     mt19937 gen(rd());
     uniform_int_distribution<> size_dis(100, 10000);
     
     // Fragmentation-inducing pattern
     {
-        Timer timer("Fragmentation-inducing allocation pattern");
+        Timer timer("Fragmentation-inducing allocation pattern", Work().with_items(num_iterations));
         vector<unique_ptr<char[]>> allocations;
         
         for (size_t i = 0; i < num_iterations; ++i) {
@@ -354,7 +347,7 @@ void memory_fragmentation_test() {
     
     // Better allocation pattern
     {
-        Timer timer("Size-pooled allocation pattern");
+        Timer timer("Size-pooled allocation pattern", Work().with_items(num_iterations));
         
         // Pools for different size classes
         vector<vector<unique_ptr<char[]>>> pools(10);
@@ -374,12 +367,9 @@ void memory_fragmentation_test() {
 }
 
 // 7. NUMA Effects Simulation
-void numa_effects_simulation() {
+void numa_effects_simulation(size_t size = 50'000'000, int num_threads = thread::hardware_concurrency()) {
     cout << "\n7. NUMA Effects Simulation:" << endl;
     
-    const size_t size = 50'000'000; // 50M elements
-    const int num_threads = thread::hardware_concurrency();
-    
     vector<int> shared_data(size);
     
     // Initialize data
@@ -389,7 +379,9 @@ void numa_effects_simulation() {
     
     // All threads access same memory region
     {
-        Timer timer("All threads same region");
+        Timer timer("All threads same region",
+                    Work().with_items(double(size) * num_threads)
+                          .with_bytes(double(size) * num_threads * sizeof(int)));
         vector<thread> threads;
         atomic<long long> total_sum(0);
         
@@ -412,7 +404,8 @@ void numa_effects_simulation() {
     
     // Each thread accesses different region
     {
-        Timer timer("Each thread different region");
+        Timer timer("Each thread different region",
+                    Work().with_items(size).with_bytes(size * sizeof(int)));
         vector<thread> threads;
         atomic<long long> total_sum(0);
         
@@ -439,10 +432,215 @@ void numa_effects_simulation() {
     }
 }
 
+// 8. Reductions: one accumulator vs independent SIMD accumulators
+void reduction_comparison(size_t size = 50'000'000, int num_threads = thread::hardware_concurrency()) {
+    cout << "\n8. Reductions (float):" << endl;
+    
+    vector<float> data(size);
+    mt19937 gen(42);
+    uniform_real_distribution<float> dis(0.0f, 1.0f);
+    for (auto& val : data) {
+        val = dis(gen);
+    }
+    long double exact = 0;
+    for (float v : data) {
+        exact += v;
+    }
+    const Work work = Work().with_items(size).with_flops(size, true).with_bytes(size * sizeof(float));
+    auto report = [&](double sum) {
+        cout << "     Sum: " << sum << " (relative error " << scientific << setprecision(1)
+             << fabs(double((sum - exact) / exact)) << defaultfloat << setprecision(6) << ")" << endl;
+    };
+    
+    {
+        Timer timer("Single accumulator", work);
+        float sum = 0;
+        for (size_t i = 0; i < size; ++i) {
+            sum += data[i];
+        }
+        report(sum);
+    }
+    {
+        Timer timer("Multi-accumulator SIMD", work);
+        report(reduce_sum(data.data(), size));
+    }
+    {
+        Timer timer("Pairwise", work);
+        report(reduce_sum_pairwise(data.data(), size));
+    }
+    {
+        Timer timer("Parallel pairwise, " + to_string(num_threads) + " threads", work);
+        report(reduce_sum_parallel(data.data(), size, num_threads));
+    }
+    {
+        Timer timer("Norm2 (overflow-safe)",
+                    Work().with_items(size).with_flops(2.0 * size, true).with_bytes(size * sizeof(float)));
+        cout << "     Norm: " << reduce_norm2(data.data(), size) << endl;
+    }
+    {
+        Timer timer("Argmax", Work().with_items(size).with_bytes(2.0 * size * sizeof(float)));
+        size_t index = reduce_argmax(data.data(), size);
+        cout << "     Max: " << data[index] << " at " << index << endl;
+    }
+}
+
+// 9. Scans, partition, compaction and histogram vs the std algorithms and plain loops
+void primitives_comparison(size_t max_size = 1'000'000'000, int num_threads = thread::hardware_concurrency()) {
+    cout << "\n9. Parallel Primitives (uint32, M elements/s, parallel = " << num_threads << " threads):" << endl;
+    
+    auto keep = [](uint32_t x) { return x < 512; };
+    auto bin = [](uint32_t x) { return x >> 2; };
+    const size_t bins = 256;
+    
+    // The int32 and float scans take their own AVX2 lane paths; integer-valued
+    // floats keep every prefix sum exact, so both compare bit for bit
+    auto scans_match = [&](auto value) {
+        using T = decltype(value);
+        const size_t count = 100'003;
+        vector<T> in(count), expected_inc(count), expected_exc(count), got(count);
+        mt19937 gen(7);
+        for (auto& v : in) {
+            v = static_cast<T>(static_cast<int>(gen() % 17) - 8);
+        }
+        inclusive_scan(in.begin(), in.end(), expected_inc.begin());
+        exclusive_scan(in.begin(), in.end(), expected_exc.begin(), T(0));
+        bool match = true;
+        auto check = [&](auto scan, const vector<T>& expected) {
+            fill(got.begin(), got.end(), T(-1));
+            scan();
+            match = match && got == expected;
+        };
+        check([&]() { scan_inclusive(in.data(), got.data(), count); }, expected_inc);
+        check([&]() { scan_exclusive(in.data(), got.data(), count); }, expected_exc);
+        check([&]() { scan_inclusive_parallel(in.data(), got.data(), count, num_threads); }, expected_inc);
+        check([&]() { scan_exclusive_parallel(in.data(), got.data(), count, num_threads); }, expected_exc);
+        return match;
+    };
+    cout << "   int32 / float scans vs std::inclusive_scan and exclusive_scan: "
+         << (scans_match(int32_t()) ? "match" : "MISMATCH") << " / "
+         << (scans_match(float()) ? "match" : "MISMATCH") << endl;
+    
+    cout << setw(8) << "Size" << setw(19) << "Operation" << setw(12) << "Baseline"
+         << setw(12) << "Sequential" << setw(12) << "Parallel" << endl;
+    cout << string(63, '-') << endl;
+    
+    const double available = static_cast<double>(sysconf(_SC_AVPHYS_PAGES)) * sysconf(_SC_PAGESIZE);
+    for (size_t n = max<size_t>(1, min<size_t>(1'000'000, max_size)); n <= max_size; n *= 10) {
+        const string label = n % 1'000'000 == 0 ? to_string(n / 1'000'000) + "M" : to_string(n);
+        // Input, expected, out and spare, plus the push_back baseline's copy:
+        // about n / 2 kept, so capacity up to n and 1.5n while it regrows
+        const double needed = 5.5 * n * sizeof(uint32_t);
+        if (needed > 0.8 * available) {
+            cout << setw(8) << label << "   skipped: needs " << fixed << setprecision(1) << needed / 1e9
+                 << " GB, " << available / 1e9 << " GB available" << defaultfloat << setprecision(6) << endl;
+            break;
+        }
+        
+        vector<uint32_t> data(n), expected(n), out(n), spare(n);
+        mt19937 gen(42);
+        for (auto& v : data) {
+            v = gen() & 1023;
+        }
+        
+        auto row = [&](const string& op, double base_ms, double seq_ms, double par_ms, bool ok) {
+            auto rate = [&](double ms) { return n / (ms * 1e3); };
+            cout << setw(8) << label << setw(19) << op << fixed << setprecision(1) << setw(12) << rate(base_ms)
+                 << setw(12) << rate(seq_ms) << setw(12) << rate(par_ms) << defaultfloat << setprecision(6)
+                 << (ok ? "" : "   MISMATCH") << endl;
+        };
+        
+        // Every run starts from a poisoned output, so a kernel that writes
+        // nothing cannot pass on the previous run's result
+        auto poison = [&]() { fill(out.begin(), out.end(), 0xdeadbeefu); };
+        
+        double base = best_of(3, [&]() { inclusive_scan(data.begin(), data.end(), expected.begin()); });
+        poison();
+        double seq = best_of(3, [&]() { scan_inclusive(data.data(), out.data(), n); });
+        bool ok = out == expected;
+        poison();
+        double par = best_of(3, [&]() { scan_inclusive_parallel(data.data(), out.data(), n, num_threads); });
+        row("inclusive scan", base, seq, par, ok && out == expected);
+        
+        base = best_of(3, [&]() { exclusive_scan(data.begin(), data.end(), expected.begin(), 0u); });
+        poison();
+        seq = best_of(3, [&]() { scan_exclusive(data.data(), out.data(), n); });
+        ok = out == expected;
+        poison();
+        par = best_of(3, [&]() { scan_exclusive_parallel(data.data(), out.data(), n, num_threads); });
+        row("exclusive scan", base, seq, par, ok && out == expected);
+        
+        // std::partition_copy is stable; its two outputs laid end to end are the expected result
+        size_t kept = 0;
+        base = best_of(3, [&]() {
+            kept = partition_copy(data.begin(), data.end(), expected.begin(), spare.begin(), keep).first - expected.begin();
+        });
+        copy(spare.begin(), spare.begin() + (n - kept), expected.begin() + kept);
+        poison();
+        seq = best_of(3, [&]() { partition_stable(data.data(), n, out.data(), keep); });
+        ok = out == expected;
+        poison();
+        par = best_of(3, [&]() { partition_stable_parallel(data.data(), n, out.data(), keep, num_threads); });
+        row("stable partition", base, seq, par, ok && out == expected);
+        
+        // Compaction baseline: the push_back collection loop (as in the sieve)
+        vector<uint32_t> collected;
+        base = best_of(3, [&]() {
+            collected = vector<uint32_t>();
+            for (size_t i = 0; i < n; ++i) {
+                if (keep(data[i])) {
+                    collected.push_back(data[i]);
+                }
+            }
+        });
+        poison();
+        seq = best_of(3, [&]() { kept = compact(data.data(), n, out.data(), keep); });
+        ok = kept == collected.size() && equal(collected.begin(), collected.end(), out.begin());
+        poison();
+        par = best_of(3, [&]() { kept = compact_parallel(data.data(), n, out.data(), keep, num_threads); });
+        ok = ok && kept == collected.size() && equal(collected.begin(), collected.end(), out.begin());
+        row("compaction", base, seq, par, ok);
+        
+        vector<size_t> naive, counts, parallel_counts;
+        base = best_of(3, [&]() {
+            naive.assign(bins, 0);
+            for (size_t i = 0; i < n; ++i) {
+                naive[bin(data[i])]++;
+            }
+        });
+        seq = best_of(3, [&]() { counts = histogram(data.data(), n, bins, bin); });
+        par = best_of(3, [&]() { parallel_counts = histogram_parallel(data.data(), n, bins, bin, num_threads); });
+        row("histogram (256)", base, seq, par, counts == naive && parallel_counts == naive);
+    }
+}
+
+// Sections available to bench_driver
+static BenchRegistrar reg_access("memory/access-patterns", "ints in the array", 100'000'000, false,
+    [](const BenchContext& ctx) { memory_access_patterns(ctx.size); });
+static BenchRegistrar reg_cache_line("memory/cache-line", "counters", 10'000'000, false,
+    [](const BenchContext& ctx) { cache_line_effects(ctx.size); });
+static BenchRegistrar reg_allocation("memory/allocation", "1KB allocations", 100'000, false,
+    [](const BenchContext& ctx) { memory_allocation_patterns(ctx.size); });
+static BenchRegistrar reg_bandwidth("memory/bandwidth", "bytes copied", 1024 * 1024 * 100, false,
+    [](const BenchContext& ctx) { memory_bandwidth_test(ctx.size); });
+static BenchRegistrar reg_layout("memory/layout", "particles", 10'000'000, false,
+    [](const BenchContext& ctx) { data_structure_layout(ctx.size); });
+static BenchRegistrar reg_fragmentation("memory/fragmentation", "allocation rounds", 10000, false,
+    [](const BenchContext& ctx) { memory_fragmentation_test(ctx.size); });
+static BenchRegistrar reg_numa("memory/numa", "ints in the shared array", 50'000'000, true,
+    [](const BenchContext& ctx) { numa_effects_simulation(ctx.size, bench_threads(ctx)); });
+static BenchRegistrar reg_reductions("memory/reductions", "floats reduced", 50'000'000, true,
+    [](const BenchContext& ctx) { reduction_comparison(ctx.size, bench_threads(ctx)); });
+static BenchRegistrar reg_primitives("memory/primitives", "largest element count (from 1M up by 10x)", 1'000'000'000, true,
+    [](const BenchContext& ctx) { primitives_comparison(ctx.size, bench_threads(ctx)); });
+
+#ifndef NSYS_BENCH_DRIVER
 int main() {
     cout << "Memory Intensive Operations Profiling Examples" << endl;
     cout << "============================================================" << endl;
     
+    // Measure peaks up front so the measurement never lands inside a timed section
+    MachinePeaks::get();
+    
     // Run all memory tests
     memory_access_patterns();
     cache_line_effects();
@@ -451,6 +649,8 @@ int main() {
     data_structure_layout();
     memory_fragmentation_test();
     numa_effects_simulation();
+    reduction_comparison();
+    primitives_comparison();
     
     cout << "\n============================================================" << endl;
     cout << "Memory profiling examples complete!" << endl;
@@ -461,4 +661,5 @@ int main() {
     cout << "- Compare different data layouts for cache efficiency" << endl;
     
     return 0;
-}
\ No newline at end of file
+}
+#endif
@@ -0,0 +1,221 @@
+/*
+ * Autotuning
+ * Kernel parameters (tile sizes, recursion cutoffs, block factors) are
+ * searched on first use for the running CPU and problem-size bucket, and the
+ * winners are kept in a cache file so later runs start tuned. Entries are
+ * keyed by CPU model and dispatch ISA level (NSYS_ISA changes which kernels
+ * run, so it gets its own entries); one file can serve several machines.
+ *
+ *   NSYS_TUNE_CACHE=path   cache file (default ~/.cache/nsys_examples_tuning.txt)
+ *   NSYS_TUNE=off          use the built-in defaults, no search
+ *   NSYS_TUNE=retune       ignore cached entries and search again
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+#include "cpu_dispatch.h"
+
+// Marketing name of the CPU, e.g. "Intel(R) Xeon(R) Platinum 8375C CPU @ 2.90GHz"
+inline std::string cpu_model_name() {
+    std::string name;
+#if defined(__x86_64__) || defined(__i386__)
+    unsigned regs[12] = {};
+    if (__get_cpuid(0x80000000, &regs[0], &regs[1], &regs[2], &regs[3]) && regs[0] >= 0x80000004) {
+        for (unsigned leaf = 0; leaf < 3; ++leaf) {
+            unsigned* r = regs + 4 * leaf;
+            __get_cpuid(0x80000002 + leaf, &r[0], &r[1], &r[2], &r[3]);
+        }
+        name.assign(reinterpret_cast<const char*>(regs), sizeof(regs));
+        name = name.c_str();
+    }
+#endif
+    if (name.empty()) {
+        std::ifstream in("/proc/cpuinfo");
+        std::string line;
+        while (std::getline(in, line)) {
+            if (line.compare(0, 10, "model name") == 0 && line.find(':') != std::string::npos) {
+                name = line.substr(line.find(':') + 1);
+                break;
+            }
+        }
+    }
+    size_t first = name.find_first_not_of(' '), last = name.find_last_not_of(' ');
+    return first == std::string::npos ? "unknown cpu" : name.substr(first, last - first + 1);
+}
+
+// Problem sizes share tuned values within a power-of-two bucket
+inline size_t tune_bucket(size_t size) {
+    size_t bucket = 1;
+    while (bucket < size) {
+        bucket <<= 1;
+    }
+    return bucket;
+}
+
+class TuningCache {
+    std::string path;
+    std::string machine;
+    std::map<std::string, long> entries;    // "machine\tparameter\tbucket" -> value
+    std::mutex mutex;
+
+    static std::string default_path() {
+        if (const char* env = std::getenv("NSYS_TUNE_CACHE")) {
+            return env;
+        }
+        if (const char* home = std::getenv("HOME")) {
+            return std::string(home) + "/.cache/nsys_examples_tuning.txt";
+        }
+        return "nsys_examples_tuning.txt";
+    }
+
+    std::string key(const std::string& parameter, size_t bucket) const {
+        return machine + "\t" + parameter + "\t" + std::to_string(bucket);
+    }
+
+    // Lines are "machine<TAB>parameter<TAB>bucket<TAB>value"; '#' starts a comment
+    void load() {
+        std::ifstream in(path);
+        std::string line;
+        while (std::getline(in, line)) {
+            size_t tab = line.rfind('\t');
+            if (line.empty() || line[0] == '#' || tab == std::string::npos) {
+                continue;
+            }
+            entries[line.substr(0, tab)] = std::atol(line.c_str() + tab + 1);
+        }
+    }
+
+    // Rewritten whole through a temporary file, so a crash never leaves it half-written
+    void save() {
+        std::string tmp = path + ".tmp";
+        {
+            std::ofstream out(tmp);
+            if (!out) {
+                std::cerr << "Cannot write tuning cache " << path << "\n";
+                return;
+            }
+            out << "# machine\tparameter\tsize bucket\tvalue (written by the nsys examples autotuner)\n";
+            for (const auto& e : entries) {
+                out << e.first << "\t" << e.second << "\n";
+            }
+        }
+        if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+            std::remove(tmp.c_str());
+        }
+    }
+
+    TuningCache() : path(default_path()), machine(cpu_model_name() + " [" + isa_name(dispatch_isa_level()) + "]") {
+        size_t slash = path.rfind('/');
+        if (slash != std::string::npos && slash > 0) {
+            mkdir(path.substr(0, slash).c_str(), 0755);     // e.g. a missing ~/.cache; EEXIST is fine
+        }
+        load();
+    }
+
+public:
+    static TuningCache& get() {
+        static TuningCache cache;
+        return cache;
+    }
+
+    const std::string& file() const { return path; }
+    const std::string& machine_key() const { return machine; }
+
+    bool lookup(const std::string& parameter, size_t bucket, long& value) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = entries.find(key(parameter, bucket));
+        if (it == entries.end()) {
+            return false;
+        }
+        value = it->second;
+        return true;
+    }
+
+    void store(const std::string& parameter, size_t bucket, long value) {
+        std::lock_guard<std::mutex> lock(mutex);
+        entries[key(parameter, bucket)] = value;
+        save();
+    }
+};
+
+enum class TuneMode { OFF, CACHED, RETUNE };
+
+inline TuneMode tune_mode() {
+    static const TuneMode mode = []() {
+        const char* env = std::getenv("NSYS_TUNE");
+        if (!env) {
+            return TuneMode::CACHED;
+        }
+        std::string v(env);
+        if (v == "off" || v == "0") {
+            return TuneMode::OFF;
+        }
+        if (v == "retune") {
+            return TuneMode::RETUNE;
+        }
+        std::cerr << "Ignoring unknown NSYS_TUNE=" << v << "\n";
+        return TuneMode::CACHED;
+    }();
+    return mode;
+}
+
+// Value of `parameter` for problems of `size`: the cached winner, or the
+// fastest candidate by best-of-`reps` wall time of run(candidate), which is
+// then cached. A cached value that is not one of the candidates (an edited or
+// corrupt entry) is searched again and overwritten. Searches are reported on
+// stdout, since they take a while.
+template<typename Run>
+long autotune(const std::string& parameter, size_t size, long default_value,
+              const std::vector<long>& candidates, Run run, int reps = 2) {
+    if (tune_mode() == TuneMode::OFF || candidates.empty()) {
+        return default_value;
+    }
+    TuningCache& cache = TuningCache::get();
+    const size_t bucket = tune_bucket(size);
+    long value = default_value;
+    if (tune_mode() == TuneMode::CACHED && cache.lookup(parameter, bucket, value) &&
+        std::find(candidates.begin(), candidates.end(), value) != candidates.end()) {
+        return value;
+    }
+    value = default_value;
+
+    std::ostringstream report;
+    report << "     [Autotuning " << parameter << " for size " << size << ":";
+    double best = 1e300;
+    for (long candidate : candidates) {
+        double fastest = 1e300;
+        for (int rep = 0; rep < reps; ++rep) {
+            auto start = std::chrono::steady_clock::now();
+            run(candidate);
+            fastest = std::min(fastest, std::chrono::duration<double, std::milli>(
+                                            std::chrono::steady_clock::now() - start).count());
+        }
+        report << " " << candidate << "=" << static_cast<long>(fastest * 100) / 100.0 << "ms";
+        if (fastest < best) {
+            best = fastest;
+            value = candidate;
+        }
+    }
+    report << " -> " << value << "]\n";
+    std::cout << report.str();
+    cache.store(parameter, bucket, value);
+    return value;
+}
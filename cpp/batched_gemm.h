@@ -0,0 +1,226 @@
+/*
+ * Batched Small-Matrix Multiply
+ * C[b] = A[b] * B[b] for many small matrices. Runtime-sized kernels spend most
+ * of their time on loop control and tails at 4x4..32x32, so there are two
+ * batched paths:
+ *   - gemm_batched<M, N, K>: sizes are template parameters, so every loop has
+ *     a constant trip count, the k loop is unrolled and a row of C stays in
+ *     registers; matrices are stored one after another (AoS).
+ *   - gemm_batched_interleaved: any runtime size, SoA "interleaved batch"
+ *     layout in which element (i, j) of W consecutive matrices is contiguous,
+ *     so one vector instruction advances W independent products.
+ * Both use AVX2+FMA when the CPU allows it and scalar code otherwise.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <type_traits>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#include "cpu_dispatch.h"
+
+namespace batched_detail {
+
+// C (M x N) = A (M x K) * B (K x N), all row-major and contiguous. Only the
+// row of C is fully unrolled (it lives in registers); the k loop is unrolled
+// by 8 and the row loop stays rolled, which keeps 32x32x32 from expanding
+// into 32K FMAs per instantiation.
+template<size_t M, size_t N, size_t K, typename T>
+inline __attribute__((always_inline)) void small_gemm(const T* a, const T* b, T* c) {
+    for (size_t i = 0; i < M; ++i) {
+        T acc[N] = {};
+#pragma GCC unroll 8
+        for (size_t p = 0; p < K; ++p) {
+            const T aip = a[i * K + p];
+#pragma GCC unroll 32
+            for (size_t j = 0; j < N; ++j) {
+                acc[j] += aip * b[p * N + j];
+            }
+        }
+#pragma GCC unroll 32
+        for (size_t j = 0; j < N; ++j) {
+            c[i * N + j] = acc[j];
+        }
+    }
+}
+
+template<size_t M, size_t N, size_t K, typename T>
+void gemm_batched_scalar(const T* a, const T* b, T* c, size_t batch) {
+    for (size_t m = 0; m < batch; ++m) {
+        small_gemm<M, N, K>(a + m * M * K, b + m * K * N, c + m * M * N);
+    }
+}
+
+#if defined(__x86_64__)
+// Same source as the scalar variant; the target attribute lets the fixed-size
+// loops become AVX2 vectors with FMA
+template<size_t M, size_t N, size_t K, typename T>
+__attribute__((target("avx2,fma")))
+void gemm_batched_avx2(const T* a, const T* b, T* c, size_t batch) {
+    for (size_t m = 0; m < batch; ++m) {
+        small_gemm<M, N, K>(a + m * M * K, b + m * K * N, c + m * M * N);
+    }
+}
+
+// One AVX2 register of lanes: one lane per matrix in the interleaved layout
+template<typename T> struct Lanes;
+
+template<> struct Lanes<float> {
+    using V = __m256;
+    static const size_t W = 8;
+    __attribute__((target("avx2,fma"))) static V zero() { return _mm256_setzero_ps(); }
+    __attribute__((target("avx2,fma"))) static V broadcast(float x) { return _mm256_set1_ps(x); }
+    __attribute__((target("avx2,fma"))) static V load(const float* p) { return _mm256_loadu_ps(p); }
+    __attribute__((target("avx2,fma"))) static void store(float* p, V v) { _mm256_storeu_ps(p, v); }
+    __attribute__((target("avx2,fma"))) static V fmadd(V a, V b, V c) { return _mm256_fmadd_ps(a, b, c); }
+};
+
+template<> struct Lanes<double> {
+    using V = __m256d;
+    static const size_t W = 4;
+    __attribute__((target("avx2,fma"))) static V zero() { return _mm256_setzero_pd(); }
+    __attribute__((target("avx2,fma"))) static V broadcast(double x) { return _mm256_set1_pd(x); }
+    __attribute__((target("avx2,fma"))) static V load(const double* p) { return _mm256_loadu_pd(p); }
+    __attribute__((target("avx2,fma"))) static void store(double* p, V v) { _mm256_storeu_pd(p, v); }
+    __attribute__((target("avx2,fma"))) static V fmadd(V a, V b, V c) { return _mm256_fmadd_pd(a, b, c); }
+};
+
+// Register-blocked over 4 columns of C: 4 accumulators per (group, i)
+template<typename T>
+__attribute__((target("avx2,fma")))
+void interleaved_avx2(const T* a, const T* b, T* c, size_t m, size_t n, size_t k, size_t groups) {
+    using L = Lanes<T>;
+    const size_t W = L::W;
+    for (size_t g = 0; g < groups; ++g) {
+        const T* ag = a + g * m * k * W;
+        const T* bg = b + g * k * n * W;
+        T* cg = c + g * m * n * W;
+        for (size_t i = 0; i < m; ++i) {
+            size_t j = 0;
+            for (; j + 4 <= n; j += 4) {
+                auto c0 = L::zero(), c1 = L::zero(), c2 = L::zero(), c3 = L::zero();
+                for (size_t p = 0; p < k; ++p) {
+                    auto av = L::load(ag + (i * k + p) * W);
+                    const T* bp = bg + (p * n + j) * W;
+                    c0 = L::fmadd(av, L::load(bp), c0);
+                    c1 = L::fmadd(av, L::load(bp + W), c1);
+                    c2 = L::fmadd(av, L::load(bp + 2 * W), c2);
+                    c3 = L::fmadd(av, L::load(bp + 3 * W), c3);
+                }
+                T* cp = cg + (i * n + j) * W;
+                L::store(cp, c0);
+                L::store(cp + W, c1);
+                L::store(cp + 2 * W, c2);
+                L::store(cp + 3 * W, c3);
+            }
+            for (; j < n; ++j) {
+                auto acc = L::zero();
+                for (size_t p = 0; p < k; ++p) {
+                    acc = L::fmadd(L::load(ag + (i * k + p) * W), L::load(bg + (p * n + j) * W), acc);
+                }
+                L::store(cg + (i * n + j) * W, acc);
+            }
+        }
+    }
+}
+#endif
+
+template<typename T>
+void interleaved_scalar(const T* a, const T* b, T* c, size_t m, size_t n, size_t k, size_t groups, size_t w) {
+    for (size_t g = 0; g < groups; ++g) {
+        const T* ag = a + g * m * k * w;
+        const T* bg = b + g * k * n * w;
+        T* cg = c + g * m * n * w;
+        for (size_t i = 0; i < m; ++i) {
+            for (size_t j = 0; j < n; ++j) {
+                T* cp = cg + (i * n + j) * w;
+                std::fill(cp, cp + w, T(0));
+                for (size_t p = 0; p < k; ++p) {
+                    const T* ap = ag + (i * k + p) * w;
+                    const T* bp = bg + (p * n + j) * w;
+                    for (size_t l = 0; l < w; ++l) {
+                        cp[l] += ap[l] * bp[l];
+                    }
+                }
+            }
+        }
+    }
+}
+
+} // namespace batched_detail
+
+// C[b] = A[b] * B[b] for b < batch; A is batch x (M x K), B batch x (K x N),
+// C batch x (M x N), each matrix row-major and stored back to back
+template<size_t M, size_t N, size_t K, typename T>
+void gemm_batched(const T* a, const T* b, T* c, size_t batch) {
+#if defined(__x86_64__)
+    if (isa_supported(IsaLevel::AVX2)) {
+        batched_detail::gemm_batched_avx2<M, N, K>(a, b, c, batch);
+        return;
+    }
+#endif
+    batched_detail::gemm_batched_scalar<M, N, K>(a, b, c, batch);
+}
+
+// Matrices per interleaved group: one AVX2 register of T
+template<typename T>
+constexpr size_t interleave_width() {
+    return 32 / sizeof(T);
+}
+
+// Interleaved layout of `batch` rows x cols matrices: groups of
+// interleave_width<T>() matrices, element (i, j) of a group's matrices
+// contiguous. The last group is zero-padded.
+template<typename T>
+size_t interleaved_size(size_t rows, size_t cols, size_t batch) {
+    const size_t w = interleave_width<T>();
+    return (batch + w - 1) / w * w * rows * cols;
+}
+
+template<typename T>
+void interleave(const T* src, T* dst, size_t rows, size_t cols, size_t batch) {
+    const size_t w = interleave_width<T>();
+    const size_t elems = rows * cols;
+    std::fill(dst, dst + interleaved_size<T>(rows, cols, batch), T(0));
+    for (size_t m = 0; m < batch; ++m) {
+        T* group = dst + (m / w) * elems * w + m % w;
+        const T* mat = src + m * elems;
+        for (size_t e = 0; e < elems; ++e) {
+            group[e * w] = mat[e];
+        }
+    }
+}
+
+template<typename T>
+void deinterleave(const T* src, T* dst, size_t rows, size_t cols, size_t batch) {
+    const size_t w = interleave_width<T>();
+    const size_t elems = rows * cols;
+    for (size_t m = 0; m < batch; ++m) {
+        const T* group = src + (m / w) * elems * w + m % w;
+        T* mat = dst + m * elems;
+        for (size_t e = 0; e < elems; ++e) {
+            mat[e] = group[e * w];
+        }
+    }
+}
+
+// Runtime-size batched multiply on interleaved operands (see interleave)
+template<typename T>
+void gemm_batched_interleaved(const T* a, const T* b, T* c, size_t m, size_t n, size_t k, size_t batch) {
+    const size_t w = interleave_width<T>();
+    const size_t groups = (batch + w - 1) / w;
+#if defined(__x86_64__)
+    if constexpr (std::is_same<T, float>::value || std::is_same<T, double>::value) {
+        if (isa_supported(IsaLevel::AVX2)) {
+            batched_detail::interleaved_avx2(a, b, c, m, n, k, groups);
+            return;
+        }
+    }
+#endif
+    batched_detail::interleaved_scalar(a, b, c, m, n, k, groups, w);
+}
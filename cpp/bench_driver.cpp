@@ -0,0 +1,239 @@
+/*
+ * Benchmark Driver
+ * Runs the sections registered by the numbered examples (linked into this
+ * binary) selected by regex, at chosen sizes, thread counts and repetition
+ * counts, optionally pinned to a CPU set, and summarizes the wall times.
+ *
+ *   bench_driver --list
+ *   bench_driver --filter 'matrix/(gemm|simd)' --size 256,1024 --repetitions 3
+ *   bench_driver --filter threading --threads 1,2,4,8 --pin 0-3
+ */
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <regex>
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+
+#include <sched.h>
+
+#include "bench_registry.h"
+#include "timer.h"
+
+using namespace std;
+using namespace std::chrono;
+
+struct DriverOptions {
+    string filter = ".*";
+    vector<size_t> sizes;       // empty: each benchmark's default
+    vector<int> threads;        // empty: each benchmark's default
+    int repetitions = 1;
+    string pin;                 // CPU list, e.g. "0-3,6"
+    bool list = false;
+};
+
+struct RunSummary {
+    string name;
+    size_t size;
+    int threads;
+    vector<double> seconds;
+};
+
+void print_usage(const char* argv0) {
+    cout << "Usage: " << argv0 << " [options] [filter]\n"
+         << "  --list                 List registered benchmarks and exit\n"
+         << "  --filter REGEX         Run benchmarks whose name matches REGEX (default: all)\n"
+         << "  --size N[,N...]        Problem sizes to sweep; k/M/G (x1000) and Ki/Mi/Gi (x1024) suffixes\n"
+         << "  --threads N[,N...]     Thread counts to sweep (threaded benchmarks only)\n"
+         << "  --repetitions N        Runs per configuration (default: 1)\n"
+         << "  --pin CPUS             Pin the process to a CPU list, e.g. 0-3,6\n";
+}
+
+// Parses "512", "64k", "8Mi", ...
+size_t parse_size(const string& text) {
+    size_t pos = 0;
+    double value = stod(text, &pos);
+    string suffix = text.substr(pos);
+    double scale = 1;
+    if (suffix == "k" || suffix == "K") scale = 1e3;
+    else if (suffix == "M") scale = 1e6;
+    else if (suffix == "G") scale = 1e9;
+    else if (suffix == "Ki") scale = 1024.0;
+    else if (suffix == "Mi") scale = 1024.0 * 1024;
+    else if (suffix == "Gi") scale = 1024.0 * 1024 * 1024;
+    else if (!suffix.empty()) throw invalid_argument("bad size suffix: " + text);
+    return static_cast<size_t>(value * scale);
+}
+
+vector<string> split(const string& text, char sep) {
+    vector<string> parts;
+    stringstream in(text);
+    string part;
+    while (getline(in, part, sep)) {
+        if (!part.empty()) {
+            parts.push_back(part);
+        }
+    }
+    return parts;
+}
+
+// Restricts the process (and every thread created afterwards) to a CPU list
+bool pin_to_cpus(const string& list) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (const string& range : split(list, ',')) {
+        size_t dash = range.find('-');
+        int first = stoi(range.substr(0, dash));
+        int last = dash == string::npos ? first : stoi(range.substr(dash + 1));
+        for (int cpu = first; cpu <= last; ++cpu) {
+            CPU_SET(cpu, &set);
+        }
+    }
+    if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+        cerr << "Cannot pin to CPUs " << list << ": " << strerror(errno) << endl;
+        return false;
+    }
+    return true;
+}
+
+void parse_args(int argc, char** argv, DriverOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        auto value = [&](const string& flag) -> string {
+            if (i + 1 >= argc) {
+                throw invalid_argument(flag + " needs a value");
+            }
+            return argv[++i];
+        };
+        if (arg == "--help" || arg == "-h") {
+            print_usage(argv[0]);
+            exit(0);
+        } else if (arg == "--list") {
+            options.list = true;
+        } else if (arg == "--filter") {
+            options.filter = value(arg);
+        } else if (arg == "--size") {
+            for (const string& s : split(value(arg), ',')) {
+                options.sizes.push_back(parse_size(s));
+            }
+        } else if (arg == "--threads") {
+            for (const string& t : split(value(arg), ',')) {
+                options.threads.push_back(stoi(t));
+            }
+        } else if (arg == "--repetitions") {
+            options.repetitions = max(1, stoi(value(arg)));
+        } else if (arg == "--pin") {
+            options.pin = value(arg);
+        } else if (!arg.empty() && arg[0] != '-') {
+            options.filter = arg;
+        } else {
+            throw invalid_argument("unknown option " + arg);
+        }
+    }
+}
+
+void list_benchmarks() {
+    cout << left << setw(30) << "benchmark" << setw(14) << "default size" << setw(10) << "threads"
+         << "size means" << "\n";
+    for (const auto& b : BenchRegistry::get().all()) {
+        cout << setw(30) << b.name << setw(14) << b.default_size << setw(10) << (b.threaded ? "yes" : "-")
+             << b.description << "\n";
+    }
+    cout << right;
+}
+
+void print_summary(const vector<RunSummary>& runs) {
+    cout << "\n============================================================" << endl;
+    cout << "Summary (wall seconds per run):" << endl;
+    cout << "   " << left << setw(30) << "benchmark" << right << setw(12) << "size" << setw(9) << "threads"
+         << setw(6) << "reps" << setw(10) << "min" << setw(10) << "median" << setw(10) << "max" << "\n";
+    for (const auto& r : runs) {
+        vector<double> sorted = r.seconds;
+        sort(sorted.begin(), sorted.end());
+        double median = sorted.size() % 2 ? sorted[sorted.size() / 2]
+                                          : (sorted[sorted.size() / 2 - 1] + sorted[sorted.size() / 2]) / 2;
+        cout << "   " << left << setw(30) << r.name << right << setw(12) << r.size << setw(9)
+             << (r.threads > 0 ? to_string(r.threads) : string("default")) << setw(6) << sorted.size()
+             << fixed << setprecision(4) << setw(10) << sorted.front() << setw(10) << median
+             << setw(10) << sorted.back() << defaultfloat << "\n";
+    }
+}
+
+int main(int argc, char** argv) {
+    DriverOptions options;
+    try {
+        parse_args(argc, argv, options);
+    } catch (const exception& e) {
+        cerr << "Error: " << e.what() << "\n";
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    if (options.list) {
+        list_benchmarks();
+        return 0;
+    }
+
+    regex filter;
+    try {
+        filter = regex(options.filter);
+    } catch (const regex_error& e) {
+        cerr << "Invalid filter regex '" << options.filter << "': " << e.what() << "\n";
+        return 1;
+    }
+
+    vector<const Benchmark*> selected;
+    for (const auto& b : BenchRegistry::get().all()) {
+        if (regex_search(b.name, filter)) {
+            selected.push_back(&b);
+        }
+    }
+    if (selected.empty()) {
+        cerr << "No benchmark matches '" << options.filter << "' (see --list)\n";
+        return 1;
+    }
+
+    if (!options.pin.empty() && !pin_to_cpus(options.pin)) {
+        return 1;
+    }
+
+    cout << "Benchmark Driver" << endl;
+    cout << "============================================================" << endl;
+    cout << "Selected " << selected.size() << " benchmark(s), " << options.repetitions << " repetition(s)"
+         << (options.pin.empty() ? "" : ", pinned to CPUs " + options.pin) << endl;
+
+    // Measure peaks up front so the measurement never lands inside a timed section
+    MachinePeaks::get();
+
+    vector<RunSummary> runs;
+    for (const Benchmark* b : selected) {
+        // Fixed-workload sections (default size 0) ignore --size
+        vector<size_t> sizes = options.sizes.empty() || b->default_size == 0
+                                   ? vector<size_t>{b->default_size} : options.sizes;
+        vector<int> thread_counts = options.threads.empty() || !b->threaded
+                                        ? vector<int>{0} : options.threads;
+        for (size_t size : sizes) {
+            for (int threads : thread_counts) {
+                RunSummary summary{b->name, size, threads, {}};
+                for (int rep = 0; rep < options.repetitions; ++rep) {
+                    cout << "\n>>> " << b->name << " [size=" << size << ", threads="
+                         << (threads > 0 ? to_string(threads) : string("default")) << "] run "
+                         << rep + 1 << "/" << options.repetitions << endl;
+                    auto start = steady_clock::now();
+                    b->run(BenchContext{size, threads});
+                    summary.seconds.push_back(duration<double>(steady_clock::now() - start).count());
+                }
+                runs.push_back(summary);
+            }
+        }
+    }
+
+    print_summary(runs);
+    return 0;
+}
@@ -0,0 +1,60 @@
+/*
+ * Benchmark Registry
+ * Each example registers its sections here with a default problem size, so
+ * the bench_driver binary (all examples linked together, built with
+ * NSYS_BENCH_DRIVER so their own main() is left out) can select sections by
+ * regex and run them at other sizes, thread counts and repetition counts.
+ */
+
+#pragma once
+
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Parameters a benchmark section runs with
+struct BenchContext {
+    size_t size;        // problem size; meaning is per benchmark (see description)
+    int threads;        // worker threads for sections that take a thread count
+};
+
+struct Benchmark {
+    std::string name;           // "<example>/<section>", matched by the driver's filter
+    std::string description;    // what `size` means for this section
+    size_t default_size;
+    bool threaded;              // honours BenchContext::threads
+    std::function<void(const BenchContext&)> run;
+};
+
+class BenchRegistry {
+private:
+    std::vector<Benchmark> benchmarks;
+
+public:
+    static BenchRegistry& get() {
+        static BenchRegistry registry;
+        return registry;
+    }
+
+    void add(Benchmark benchmark) { benchmarks.push_back(std::move(benchmark)); }
+    const std::vector<Benchmark>& all() const { return benchmarks; }
+};
+
+// Registers a benchmark from a namespace-scope static object:
+//   static BenchRegistrar reg("basic/fibonacci", "n", 40, false, [](const BenchContext& ctx) {...});
+struct BenchRegistrar {
+    BenchRegistrar(const std::string& name, const std::string& description, size_t default_size,
+                   bool threaded, std::function<void(const BenchContext&)> run) {
+        BenchRegistry::get().add(Benchmark{name, description, default_size, threaded, std::move(run)});
+    }
+};
+
+// Thread count for a threaded section: the requested count, else all hardware threads
+inline int bench_threads(const BenchContext& ctx) {
+    if (ctx.threads > 0) {
+        return ctx.threads;
+    }
+    unsigned hw = std::thread::hardware_concurrency();
+    return hw > 0 ? static_cast<int>(hw) : 1;
+}
@@ -0,0 +1,120 @@
+/*
+ * Runtime CPU Dispatch
+ * The examples are compiled for the baseline ISA; hot kernels are additionally
+ * compiled for SSE4.2, AVX2+FMA and AVX-512 (per-function target attributes)
+ * and the best variant the running CPU supports is picked from a dispatch
+ * table on first use. NSYS_ISA=scalar|sse4.2|avx2|avx512 caps the selection,
+ * e.g. to reproduce what an older machine would run.
+ */
+
+#pragma once
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+enum class IsaLevel { SCALAR = 0, SSE42 = 1, AVX2 = 2, AVX512 = 3 };
+
+inline const char* isa_name(IsaLevel level) {
+    switch (level) {
+        case IsaLevel::SSE42: return "sse4.2";
+        case IsaLevel::AVX2: return "avx2+fma";
+        case IsaLevel::AVX512: return "avx512";
+        default: return "scalar";
+    }
+}
+
+// Highest level this CPU (and OS) supports
+inline IsaLevel cpu_isa_level() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") &&
+        __builtin_cpu_supports("avx512vl")) {
+        return IsaLevel::AVX512;
+    }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        return IsaLevel::AVX2;
+    }
+    if (__builtin_cpu_supports("sse4.2")) {
+        return IsaLevel::SSE42;
+    }
+#endif
+    return IsaLevel::SCALAR;
+}
+
+// Level used for dispatch: the CPU level, optionally capped by NSYS_ISA
+inline IsaLevel dispatch_isa_level() {
+    static const IsaLevel level = []() {
+        IsaLevel detected = cpu_isa_level();
+        const char* cap = std::getenv("NSYS_ISA");
+        if (!cap) {
+            return detected;
+        }
+        for (IsaLevel l : {IsaLevel::SCALAR, IsaLevel::SSE42, IsaLevel::AVX2, IsaLevel::AVX512}) {
+            if (std::strcmp(cap, isa_name(l)) == 0 ||
+                (l == IsaLevel::AVX2 && std::strcmp(cap, "avx2") == 0)) {
+                return l < detected ? l : detected;
+            }
+        }
+        std::cerr << "Ignoring unknown NSYS_ISA=" << cap << "\n";
+        return detected;
+    }();
+    return level;
+}
+
+inline bool isa_supported(IsaLevel level) {
+    return level <= dispatch_isa_level();
+}
+
+// Extensions outside the IsaLevel ladder. Read from CPUID directly, since
+// GCC 12's __builtin_cpu_supports reports some of them (f16c, avxvnni) absent.
+enum class CpuFeature { F16C, AVX_VNNI, AVX512_VNNI };
+
+inline bool cpu_has(CpuFeature feature) {
+#if defined(__x86_64__) || defined(__i386__)
+    unsigned a = 0, b = 0, c = 0, d = 0;
+    switch (feature) {
+        case CpuFeature::F16C:
+            return __get_cpuid(1, &a, &b, &c, &d) && (c >> 29 & 1);
+        case CpuFeature::AVX_VNNI:
+            return __get_cpuid_count(7, 1, &a, &b, &c, &d) && (a >> 4 & 1);
+        case CpuFeature::AVX512_VNNI:
+            return __get_cpuid_count(7, 0, &a, &b, &c, &d) && (c >> 11 & 1);
+    }
+#endif
+    (void)feature;
+    return false;
+}
+
+// A feature is usable when the CPU has it and its base level is within the
+// dispatch level (so NSYS_ISA caps extensions too)
+inline bool feature_supported(CpuFeature feature) {
+    IsaLevel base = feature == CpuFeature::AVX512_VNNI ? IsaLevel::AVX512 : IsaLevel::AVX2;
+    return isa_supported(base) && cpu_has(feature);
+}
+
+// One compiled variant of a kernel
+template<typename Fn>
+struct KernelVariant {
+    IsaLevel level;
+    const char* name;
+    Fn fn;
+};
+
+// Picks the highest-level variant the dispatch level allows. The table must
+// contain a SCALAR entry so there is always something to run.
+template<typename Fn>
+const KernelVariant<Fn>& select_variant(const std::vector<KernelVariant<Fn>>& table) {
+    const KernelVariant<Fn>* best = &table.front();
+    for (const auto& v : table) {
+        if (isa_supported(v.level) && v.level >= best->level) {
+            best = &v;
+        }
+    }
+    return *best;
+}
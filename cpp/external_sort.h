@@ -0,0 +1,425 @@
+/*
+ * External Merge Sort
+ * Sorts a file of raw elements (no header) into another file while keeping
+ * the buffers alive at once under a memory budget, so the input can be many
+ * times larger than the memory the sort may use.
+ *
+ * Run generation: worker threads each own budget / threads bytes, pread the
+ * next chunk of the input, std::sort it and write it to an unlinked temp
+ * file in large writes from a page-aligned buffer. Merging: a loser tree
+ * picks the next element from k runs with log2(k) compares against a cached
+ * key per run; every run reads in blocks and asks the kernel to read the
+ * following block ahead (POSIX_FADV_WILLNEED), and full output blocks are
+ * written by a helper thread while the next one fills. When the runs
+ * outnumber what the budget can buffer, intermediate passes merge them in
+ * groups first.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <future>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+struct ExternalSortOptions {
+    size_t memory_budget = 256ull << 20;    // bytes of sort and I/O buffers alive at once
+    unsigned threads = 0;                   // run-generation workers, 0 = hardware threads
+    size_t io_block = 4ull << 20;           // bytes per write call (and at most per read)
+    std::string temp_dir;                   // run files; empty = the output's directory
+};
+
+struct ExternalSortStats {
+    size_t runs = 0;                // sorted runs written by run generation
+    size_t merge_passes = 0;        // passes over the data after run generation
+    size_t temp_bytes = 0;          // bytes written to run files over all passes
+    double run_seconds = 0;         // reading, sorting and writing the runs
+    double merge_seconds = 0;       // all merge passes, including the final one
+};
+
+namespace ext_sort_detail {
+
+const size_t PAGE = 4096;
+// Smallest per-run read block; bounds the fan-in of one merge pass
+const size_t MIN_READ_BLOCK = 64 * 1024;
+
+// Page-aligned heap block; data() is null when the allocation failed
+class Block {
+private:
+    void* ptr = nullptr;
+    size_t len = 0;
+
+public:
+    explicit Block(size_t bytes) : len(bytes) {
+        if (posix_memalign(&ptr, PAGE, std::max(bytes, PAGE)) != 0) {
+            ptr = nullptr;
+        }
+    }
+    Block(Block&& other) noexcept : ptr(other.ptr), len(other.len) { other.ptr = nullptr; }
+    ~Block() { free(ptr); }
+
+    char* data() const { return static_cast<char*>(ptr); }
+    size_t size() const { return len; }
+
+    Block(const Block&) = delete;
+    Block& operator=(const Block&) = delete;
+};
+
+// A sorted run in a temp file
+struct Run {
+    int fd = -1;
+    size_t count = 0;
+};
+
+inline void close_runs(std::vector<Run>& runs, size_t first, size_t last) {
+    for (size_t i = first; i < last; ++i) {
+        if (runs[i].fd >= 0) {
+            ::close(runs[i].fd);
+            runs[i].fd = -1;
+        }
+    }
+}
+
+// Appends bytes at the file position in calls of at most `block`; 0 or -errno
+inline int write_all(int fd, const char* p, size_t bytes, size_t block) {
+    while (bytes > 0) {
+        ssize_t w = ::write(fd, p, std::min(bytes, block));
+        if (w < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -errno;
+        }
+        p += w;
+        bytes -= static_cast<size_t>(w);
+    }
+    return 0;
+}
+
+// Reads exactly `bytes` at `offset`; 0 or -errno (-EIO on a short file)
+inline int read_all(int fd, char* p, size_t bytes, off_t offset) {
+    while (bytes > 0) {
+        ssize_t r = ::pread(fd, p, bytes, offset);
+        if (r < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -errno;
+        }
+        if (r == 0) {
+            return -EIO;
+        }
+        p += r;
+        bytes -= static_cast<size_t>(r);
+        offset += r;
+    }
+    return 0;
+}
+
+// Anonymous temp file in `dir`: unlinked at once, so it disappears with its
+// descriptor even if the sort fails midway. Descriptor or -errno.
+inline int temp_file(const std::string& dir) {
+    std::string name = dir + "/nsys_sort_XXXXXX";
+    int fd = mkstemp(&name[0]);
+    if (fd < 0) {
+        return -errno;
+    }
+    unlink(name.c_str());
+    return fd;
+}
+
+// Sequential reader over one run, one block at a time
+template<typename T>
+class RunReader {
+private:
+    int fd;
+    off_t offset = 0;
+    size_t unread;              // elements still in the file
+    size_t block;               // elements per read
+    Block buffer;
+    size_t pos = 0, count = 0;
+
+public:
+    RunReader(const Run& run, size_t block_elems)
+        : fd(run.fd), unread(run.count), block(block_elems), buffer(block_elems * sizeof(T)) {
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    }
+
+    bool ok() const { return buffer.data() != nullptr; }
+
+    // Loads the next block and starts kernel read-ahead of the one after; 0 or -errno
+    int refill() {
+        pos = 0;
+        count = std::min(block, unread);
+        if (count == 0) {
+            return 0;
+        }
+        int err = read_all(fd, buffer.data(), count * sizeof(T), offset);
+        offset += static_cast<off_t>(count * sizeof(T));
+        unread -= count;
+        if (unread > 0) {
+            posix_fadvise(fd, offset, static_cast<off_t>(std::min(block, unread) * sizeof(T)), POSIX_FADV_WILLNEED);
+        }
+        return err;
+    }
+
+    // Next element of the current block; false when the block is used up
+    bool next(T& value) {
+        if (pos == count) {
+            return false;
+        }
+        std::memcpy(&value, buffer.data() + pos * sizeof(T), sizeof(T));
+        ++pos;
+        return true;
+    }
+
+    bool finished() const { return unread == 0 && pos == count; }
+};
+
+// Merges runs [first, last) into out_fd at its file position; 0 or -errno
+template<typename T>
+int merge_runs(const std::vector<Run>& runs, size_t first, size_t last, int out_fd,
+               size_t read_elems, size_t write_elems, size_t io_block) {
+    const size_t k = last - first;
+    if (k == 0) {
+        return 0;
+    }
+    std::vector<RunReader<T>> readers;
+    readers.reserve(k);
+    std::vector<T> key(k);
+    std::vector<char> live(k);
+    for (size_t i = 0; i < k; ++i) {
+        readers.emplace_back(runs[first + i], read_elems);
+        if (!readers[i].ok()) {
+            return -ENOMEM;
+        }
+        int err = readers[i].refill();
+        if (err != 0) {
+            return err;
+        }
+        live[i] = readers[i].next(key[i]);
+    }
+
+    // Loser tree: leaf i sits at k + i, internal node j keeps the loser of
+    // the match played there; an exhausted run loses to every live one
+    auto less = [&](size_t a, size_t b) {
+        return live[a] && (!live[b] || key[a] < key[b]);
+    };
+    std::vector<size_t> loser(k), winner(2 * k);
+    for (size_t i = 0; i < k; ++i) {
+        winner[k + i] = i;
+    }
+    for (size_t node = k - 1; node > 0; --node) {
+        size_t a = winner[2 * node], b = winner[2 * node + 1];
+        if (less(b, a)) {
+            std::swap(a, b);
+        }
+        winner[node] = a;
+        loser[node] = b;
+    }
+    size_t top = winner[1];
+
+    // Double-buffered output: one block fills while the other is written
+    Block out[2] = {Block(write_elems * sizeof(T)), Block(write_elems * sizeof(T))};
+    if (!out[0].data() || !out[1].data()) {
+        return -ENOMEM;
+    }
+    int current = 0;
+    size_t filled = 0;
+    std::future<int> pending;
+    auto flush = [&]() {
+        int err = pending.valid() ? pending.get() : 0;
+        if (err == 0 && filled > 0) {
+            pending = std::async(std::launch::async, write_all, out_fd, out[current].data(),
+                                 filled * sizeof(T), io_block);
+            current ^= 1;
+            filled = 0;
+        }
+        return err;
+    };
+
+    while (live[top]) {
+        std::memcpy(out[current].data() + filled * sizeof(T), &key[top], sizeof(T));
+        if (++filled == write_elems) {
+            int err = flush();
+            if (err != 0) {
+                return err;
+            }
+        }
+        RunReader<T>& reader = readers[top];
+        if (!reader.next(key[top])) {
+            int err = reader.finished() ? 0 : reader.refill();
+            if (err != 0) {
+                return err;
+            }
+            live[top] = reader.next(key[top]);
+        }
+        size_t w = top;
+        for (size_t node = (k + top) / 2; node > 0; node /= 2) {
+            if (less(loser[node], w)) {
+                std::swap(loser[node], w);
+            }
+        }
+        top = w;
+    }
+    int err = flush();
+    if (err == 0 && pending.valid()) {
+        err = pending.get();
+    }
+    return err;
+}
+
+// Sorted runs of at most budget / threads bytes each; 0 or -errno
+template<typename T>
+int make_runs(int in_fd, size_t n, size_t chunk, unsigned threads, const std::string& dir,
+              size_t io_block, std::vector<Run>& runs) {
+    runs.assign((n + chunk - 1) / chunk, Run());
+    std::atomic<size_t> next(0);
+    std::atomic<int> error(0);
+    auto worker = [&]() {
+        Block buffer(chunk * sizeof(T));
+        if (!buffer.data()) {
+            error = -ENOMEM;
+            return;
+        }
+        T* data = reinterpret_cast<T*>(buffer.data());
+        for (size_t i = next++; i < runs.size() && error == 0; i = next++) {
+            const size_t count = std::min(chunk, n - i * chunk);
+            int err = read_all(in_fd, buffer.data(), count * sizeof(T), static_cast<off_t>(i * chunk * sizeof(T)));
+            if (err == 0) {
+                std::sort(data, data + count);
+                int fd = temp_file(dir);
+                err = fd < 0 ? fd : write_all(fd, buffer.data(), count * sizeof(T), io_block);
+                if (fd >= 0) {
+                    runs[i] = {fd, count};
+                }
+            }
+            if (err != 0) {
+                error = err;
+            }
+        }
+    };
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; ++t) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (auto& t : pool) {
+        t.join();
+    }
+    return error;
+}
+
+} // namespace ext_sort_detail
+
+// Smallest memory budget external_sort accepts (four minimum read blocks)
+const size_t EXTERNAL_SORT_MIN_BUDGET = 4 * ext_sort_detail::MIN_READ_BLOCK;
+
+// Sorts the elements of `input` (a file of raw T) into `output` with
+// operator<, within options.memory_budget bytes of buffers. Returns 0 or -errno.
+template<typename T>
+int external_sort(const std::string& input, const std::string& output,
+                  const ExternalSortOptions& options = ExternalSortOptions(), ExternalSortStats* stats = nullptr) {
+    using namespace ext_sort_detail;
+    static_assert(std::is_trivially_copyable<T>::value, "external_sort moves elements as raw bytes");
+    ExternalSortStats local;
+    ExternalSortStats& st = stats ? *stats : local;
+    st = ExternalSortStats();
+
+    const size_t budget = options.memory_budget;
+    const size_t io_block = std::max(PAGE, options.io_block / PAGE * PAGE);
+    if (budget < EXTERNAL_SORT_MIN_BUDGET || budget < 4 * sizeof(T)) {
+        return -EINVAL;
+    }
+    std::string dir = options.temp_dir;
+    if (dir.empty()) {
+        size_t slash = output.rfind('/');
+        dir = slash == std::string::npos ? "." : slash == 0 ? "/" : output.substr(0, slash);
+    }
+
+    int in_fd = ::open(input.c_str(), O_RDONLY);
+    if (in_fd < 0) {
+        return -errno;
+    }
+    struct stat info;
+    if (fstat(in_fd, &info) != 0) {
+        int err = -errno;
+        ::close(in_fd);
+        return err;
+    }
+    if (info.st_size % sizeof(T) != 0) {
+        ::close(in_fd);
+        return -EINVAL;
+    }
+    const size_t n = static_cast<size_t>(info.st_size) / sizeof(T);
+    unsigned threads = options.threads ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+    const size_t chunk = std::max<size_t>(1, budget / threads / sizeof(T));
+    threads = static_cast<unsigned>(std::min<size_t>(threads, std::max<size_t>(1, (n + chunk - 1) / chunk)));
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<Run> runs;
+    int err = make_runs<T>(in_fd, n, chunk, threads, dir, io_block, runs);
+    ::close(in_fd);
+    st.runs = runs.size();
+    st.temp_bytes = n * sizeof(T);
+    auto merge_start = std::chrono::steady_clock::now();
+    st.run_seconds = std::chrono::duration<double>(merge_start - start).count();
+
+    // Two output blocks, the rest split between the runs being merged
+    const size_t write_elems = std::max<size_t>(1, std::min(io_block, budget / 4) / sizeof(T));
+    const size_t read_budget = budget - 2 * write_elems * sizeof(T);
+    const size_t fan_in = std::max<size_t>(2, read_budget / MIN_READ_BLOCK);
+    auto read_elems = [&](size_t k) {
+        size_t bytes = std::min(io_block, read_budget / std::max<size_t>(1, k) / PAGE * PAGE);
+        return std::max<size_t>(1, bytes / sizeof(T));
+    };
+
+    while (err == 0 && runs.size() > fan_in) {
+        std::vector<Run> merged;
+        for (size_t first = 0; first < runs.size() && err == 0; first += fan_in) {
+            const size_t last = std::min(runs.size(), first + fan_in);
+            Run run;
+            for (size_t i = first; i < last; ++i) {
+                run.count += runs[i].count;
+            }
+            run.fd = temp_file(dir);
+            err = run.fd < 0 ? run.fd
+                             : merge_runs<T>(runs, first, last, run.fd, read_elems(last - first), write_elems, io_block);
+            if (run.fd >= 0) {
+                merged.push_back(run);
+            }
+            close_runs(runs, first, last);
+        }
+        close_runs(runs, 0, runs.size());
+        runs.swap(merged);
+        st.merge_passes++;
+        st.temp_bytes += n * sizeof(T);
+    }
+
+    if (err == 0) {
+        int out_fd = ::open(output.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (out_fd < 0) {
+            err = -errno;
+        } else {
+            err = merge_runs<T>(runs, 0, runs.size(), out_fd, read_elems(runs.size()), write_elems, io_block);
+            if (::close(out_fd) != 0 && err == 0) {
+                err = -errno;
+            }
+            st.merge_passes++;
+        }
+    }
+    close_runs(runs, 0, runs.size());
+    st.merge_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - merge_start).count();
+    return err;
+}
@@ -0,0 +1,242 @@
+/*
+ * Dense Factorizations
+ * Right-looking blocked LU with partial pivoting and blocked Cholesky on
+ * Matrix<T>, plus the triangular solves that use them. Each step factors a
+ * narrow panel with unblocked code, and the trailing update then does almost
+ * all of the O(n^3) work as a GEMM, C -= A * B on strided blocks
+ * (gemm_subtract from gemm_update.h). The multithreaded variants split each
+ * step's update into tiles that workers take from a shared counter.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "cpu_dispatch.h"
+#include "gemm_update.h"
+#include "matrix.h"
+#include "reductions.h"
+
+namespace factor_detail {
+
+// Panel width: columns factored per step
+const size_t BLOCK = 128;
+// Columns of C per update tile; a BLOCK x 256 double block of B is 256KB (L2)
+const size_t UPDATE_COLS = 256;
+
+// Runs fn(task) for task < count on `threads` workers pulling from a shared counter
+template<typename Fn>
+void run_tasks(size_t count, int threads, Fn fn) {
+    threads = std::max(1, std::min<int>(threads, static_cast<int>(count)));
+    if (threads == 1) {
+        for (size_t t = 0; t < count; ++t) {
+            fn(t);
+        }
+        return;
+    }
+    std::atomic<size_t> next{0};
+    auto worker = [&]() {
+        for (size_t t = next++; t < count; t = next++) {
+            fn(t);
+        }
+    };
+    std::vector<std::thread> workers;
+    for (int t = 1; t < threads; ++t) {
+        workers.emplace_back(worker);
+    }
+    worker();
+    for (auto& w : workers) {
+        w.join();
+    }
+}
+
+// Tiles of rows [r_begin, n) x columns [c_begin, n): BLOCK rows by UPDATE_COLS columns
+struct Tile {
+    size_t r0, r1, c0, c1;
+};
+
+inline std::vector<Tile> tiles(size_t r_begin, size_t c_begin, size_t n, bool lower_only) {
+    std::vector<Tile> out;
+    for (size_t r0 = r_begin; r0 < n; r0 += BLOCK) {
+        size_t r1 = std::min(n, r0 + BLOCK);
+        size_t c_end = lower_only ? r1 : n;
+        for (size_t c0 = c_begin; c0 < c_end; c0 += UPDATE_COLS) {
+            out.push_back({r0, r1, c0, std::min(c_end, c0 + UPDATE_COLS)});
+        }
+    }
+    return out;
+}
+
+} // namespace factor_detail
+
+// In-place LU with partial pivoting, P A = L U: L (unit diagonal) below the
+// diagonal, U on and above it; rows j and piv[j] were swapped at step j.
+// Returns 0, or j + 1 for the first exactly zero pivot U(j, j) (the
+// factorization still completes, but U is singular).
+template<typename T>
+int lu_factor(Matrix<T>& a, std::vector<size_t>& piv, int threads = 1) {
+    using namespace factor_detail;
+    const size_t n = a.num_rows();
+    piv.resize(n);
+    int info = 0;
+    for (size_t k0 = 0; k0 < n; k0 += BLOCK) {
+        const size_t k1 = std::min(n, k0 + BLOCK);
+
+        // Panel: columns [k0, k1), unblocked, swapping whole rows
+        for (size_t j = k0; j < k1; ++j) {
+            size_t p = j;
+            for (size_t i = j + 1; i < n; ++i) {
+                if (std::fabs(a(i, j)) > std::fabs(a(p, j))) {
+                    p = i;
+                }
+            }
+            piv[j] = p;
+            if (p != j) {
+                std::swap_ranges(a.row(j), a.row(j) + n, a.row(p));
+            }
+            const T pivot = a(j, j);
+            if (pivot == T(0)) {
+                info = info ? info : static_cast<int>(j + 1);
+                continue;
+            }
+            for (size_t i = j + 1; i < n; ++i) {
+                T l = a(i, j) /= pivot;
+                for (size_t c = j + 1; c < k1; ++c) {
+                    a(i, c) -= l * a(j, c);
+                }
+            }
+        }
+        if (k1 == n) {
+            break;
+        }
+
+        // U12 = L11^-1 A12, in column chunks
+        const size_t chunks = (n - k1 + UPDATE_COLS - 1) / UPDATE_COLS;
+        run_tasks(chunks, threads, [&](size_t t) {
+            size_t c0 = k1 + t * UPDATE_COLS, c1 = std::min(n, c0 + UPDATE_COLS);
+            for (size_t i = k0 + 1; i < k1; ++i) {
+                gemm_subtract(a.row(i) + k0, n, a.row(k0) + c0, n, a.row(i) + c0, n, 1, c1 - c0, i - k0);
+            }
+        });
+
+        // A22 -= L21 U12
+        std::vector<Tile> work = tiles(k1, k1, n, false);
+        run_tasks(work.size(), threads, [&](size_t t) {
+            const Tile& w = work[t];
+            gemm_subtract(a.row(w.r0) + k0, n, a.row(k0) + w.c0, n, a.row(w.r0) + w.c0, n,
+                   w.r1 - w.r0, w.c1 - w.c0, k1 - k0);
+        });
+    }
+    return info;
+}
+
+// In-place Cholesky A = L L^T of a symmetric positive definite matrix; reads
+// the lower triangle and leaves L there, with the strict upper triangle zeroed.
+// Returns 0, or j + 1 if the leading minor of order j + 1 is not positive definite.
+template<typename T>
+int cholesky_factor(Matrix<T>& a, int threads = 1) {
+    using namespace factor_detail;
+    const size_t n = a.num_rows();
+    std::vector<T> l21t;
+    for (size_t k0 = 0; k0 < n; k0 += BLOCK) {
+        const size_t k1 = std::min(n, k0 + BLOCK);
+
+        // Diagonal block, unblocked (earlier panels are already subtracted)
+        for (size_t j = k0; j < k1; ++j) {
+            T d = a(j, j) - reduce_dot(a.row(j) + k0, a.row(j) + k0, j - k0);
+            if (!(d > T(0))) {
+                return static_cast<int>(j + 1);
+            }
+            a(j, j) = std::sqrt(d);
+            for (size_t i = j + 1; i < k1; ++i) {
+                a(i, j) = (a(i, j) - reduce_dot(a.row(i) + k0, a.row(j) + k0, j - k0)) / a(j, j);
+            }
+        }
+        if (k1 == n) {
+            break;
+        }
+
+        // L21 = A21 L11^-T, a row at a time (rows are independent)
+        const size_t row_chunks = (n - k1 + BLOCK - 1) / BLOCK;
+        run_tasks(row_chunks, threads, [&](size_t t) {
+            size_t r0 = k1 + t * BLOCK, r1 = std::min(n, r0 + BLOCK);
+            for (size_t i = r0; i < r1; ++i) {
+                for (size_t j = k0; j < k1; ++j) {
+                    a(i, j) = (a(i, j) - reduce_dot(a.row(i) + k0, a.row(j) + k0, j - k0)) / a(j, j);
+                }
+            }
+        });
+
+        // Lower triangle of A22 -= L21 L21^T, with L21^T packed row-major
+        const size_t m = n - k1, kb = k1 - k0;
+        l21t.resize(kb * m);
+        for (size_t i = k1; i < n; ++i) {
+            for (size_t p = 0; p < kb; ++p) {
+                l21t[p * m + (i - k1)] = a(i, k0 + p);
+            }
+        }
+        std::vector<Tile> work = tiles(k1, k1, n, true);
+        run_tasks(work.size(), threads, [&](size_t t) {
+            const Tile& w = work[t];
+            gemm_subtract(a.row(w.r0) + k0, n, l21t.data() + (w.c0 - k1), m, a.row(w.r0) + w.c0, n,
+                   w.r1 - w.r0, w.c1 - w.c0, kb);
+        });
+    }
+    for (size_t i = 0; i < n; ++i) {
+        std::fill(a.row(i) + i + 1, a.row(i) + n, T(0));
+    }
+    return 0;
+}
+
+// x := L^-1 x for lower-triangular L (diagonal taken as 1 if unit_diagonal)
+template<typename T>
+void solve_lower(const Matrix<T>& l, T* x, bool unit_diagonal = false) {
+    for (size_t i = 0; i < l.num_rows(); ++i) {
+        T v = x[i] - reduce_dot(l.row(i), x, i);
+        x[i] = unit_diagonal ? v : v / l(i, i);
+    }
+}
+
+// x := U^-1 x for upper-triangular U
+template<typename T>
+void solve_upper(const Matrix<T>& u, T* x) {
+    const size_t n = u.num_rows();
+    for (size_t i = n; i-- > 0;) {
+        x[i] = (x[i] - reduce_dot(u.row(i) + i + 1, x + i + 1, n - i - 1)) / u(i, i);
+    }
+}
+
+// x := L^-T x for lower-triangular L; walks rows of L, so access stays contiguous
+template<typename T>
+void solve_lower_transposed(const Matrix<T>& l, T* x) {
+    for (size_t i = l.num_rows(); i-- > 0;) {
+        x[i] /= l(i, i);
+        const T xi = x[i];
+        const T* row = l.row(i);
+        for (size_t j = 0; j < i; ++j) {
+            x[j] -= row[j] * xi;
+        }
+    }
+}
+
+// Solves A x = b in place (b becomes x) from lu_factor's output
+template<typename T>
+void lu_solve(const Matrix<T>& lu, const std::vector<size_t>& piv, T* b) {
+    for (size_t j = 0; j < piv.size(); ++j) {
+        std::swap(b[j], b[piv[j]]);
+    }
+    solve_lower(lu, b, true);
+    solve_upper(lu, b);
+}
+
+// Solves A x = b in place from cholesky_factor's output
+template<typename T>
+void cholesky_solve(const Matrix<T>& l, T* b) {
+    solve_lower(l, b);
+    solve_lower_transposed(l, b);
+}
@@ -0,0 +1,422 @@
+/*
+ * FFT Convolution
+ * Complex FFTs of any length 2^a 3^b (Stockham autosort, so no bit-reversal
+ * pass): radix-4, radix-2 and radix-3 stages with AVX2 butterflies over two
+ * complex values per register, and twiddles precomputed per stage. Transforms can be batched: element t of
+ * a batched transform is `batch` contiguous values, which is how 2D column
+ * transforms run with unit-stride inner loops.
+ *
+ * RealFft2d transforms real rows x cols images to the rows x (cols/2 + 1)
+ * half spectrum (the rest is its conjugate mirror). Two real rows go through
+ * one complex row transform as its real and imaginary parts.
+ *
+ * fft_correlate_2d computes the same "valid" correlation as a direct
+ * sliding-window loop: O(N^2 log N) instead of O(N^2 K^2). Large images are
+ * processed by overlap-add over tiles sized for the kernel, so the transforms
+ * stay cache-sized.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <vector>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#include "cpu_dispatch.h"
+#include "matrix.h"
+
+typedef std::complex<double> cplx;
+
+// Smallest 2^a 3^b >= n (even, if `even`); the lengths FftPlan accepts
+inline size_t fft_size(size_t n, bool even = false) {
+    for (size_t m = std::max<size_t>(n, 1);; ++m) {
+        size_t r = m;
+        for (size_t f : {2, 3}) {
+            while (r % f == 0) {
+                r /= f;
+            }
+        }
+        if (r == 1 && (!even || m % 2 == 0)) {
+            return m;
+        }
+    }
+}
+
+namespace fft_detail {
+
+struct Stage {
+    size_t radix;
+    size_t n;                   // transform length this stage splits
+    std::vector<cplx> twiddles; // W_n^(p u), p < n / radix, 1 <= u < radix, at [p (radix - 1) + u - 1]
+};
+
+// sin(2 pi / 3), for the radix-3 butterfly
+const double SIN_60 = 0.86602540378443864676;
+
+// Columns q_begin <= q < s of a stage
+inline void stage_scalar(const Stage& st, const cplx* x, cplx* y, size_t s, size_t q_begin = 0) {
+    const size_t m = st.n / st.radix;
+    if (st.radix == 2) {
+        for (size_t p = 0; p < m; ++p) {
+            const cplx w1 = st.twiddles[p];
+            for (size_t q = q_begin; q < s; ++q) {
+                cplx a0 = x[q + s * p], a1 = x[q + s * (p + m)];
+                y[q + s * 2 * p] = a0 + a1;
+                y[q + s * (2 * p + 1)] = (a0 - a1) * w1;
+            }
+        }
+    } else if (st.radix == 4) {
+        for (size_t p = 0; p < m; ++p) {
+            const cplx* w = st.twiddles.data() + 3 * p;
+            for (size_t q = q_begin; q < s; ++q) {
+                cplx a0 = x[q + s * p], a1 = x[q + s * (p + m)];
+                cplx a2 = x[q + s * (p + 2 * m)], a3 = x[q + s * (p + 3 * m)];
+                cplx t0 = a0 + a2, t1 = a0 - a2, t2 = a1 + a3;
+                cplx d = a1 - a3, t3(d.imag(), -d.real());     // (a1 - a3) * -i
+                y[q + s * 4 * p] = t0 + t2;
+                y[q + s * (4 * p + 1)] = (t1 + t3) * w[0];
+                y[q + s * (4 * p + 2)] = (t0 - t2) * w[1];
+                y[q + s * (4 * p + 3)] = (t1 - t3) * w[2];
+            }
+        }
+    } else {
+        // y1, y2 = a0 - (a1 + a2) / 2 -+ i sin60 (a1 - a2)
+        for (size_t p = 0; p < m; ++p) {
+            const cplx* w = st.twiddles.data() + 2 * p;
+            for (size_t q = q_begin; q < s; ++q) {
+                cplx a0 = x[q + s * p], a1 = x[q + s * (p + m)], a2 = x[q + s * (p + 2 * m)];
+                cplx t1 = a1 + a2, t2 = a0 - 0.5 * t1, d = SIN_60 * (a1 - a2), t3(d.imag(), -d.real());
+                y[q + s * 3 * p] = a0 + t1;
+                y[q + s * (3 * p + 1)] = (t2 + t3) * w[0];
+                y[q + s * (3 * p + 2)] = (t2 - t3) * w[1];
+            }
+        }
+    }
+}
+
+#if defined(__x86_64__)
+// Two complex values per register: [re0, im0, re1, im1]
+__attribute__((target("avx2,fma")))
+inline __m256d cmul(__m256d v, __m256d wr, __m256d wi) {
+    return _mm256_fmaddsub_pd(v, wr, _mm256_mul_pd(_mm256_permute_pd(v, 0x5), wi));
+}
+
+__attribute__((target("avx2,fma")))
+inline __m256d mul_neg_i(__m256d v) {
+    return _mm256_xor_pd(_mm256_permute_pd(v, 0x5), _mm256_setr_pd(0.0, -0.0, 0.0, -0.0));
+}
+
+// The q loop (stride s, contiguous) two values at a time; odd s leaves a
+// scalar tail column
+__attribute__((target("avx2,fma")))
+inline void stage_avx2(const Stage& st, const cplx* x, cplx* y, size_t s) {
+    const size_t m = st.n / st.radix;
+    const double* xd = reinterpret_cast<const double*>(x);
+    double* yd = reinterpret_cast<double*>(y);
+    const size_t s2 = s & ~size_t(1);
+    if (s2 < s) {
+        stage_scalar(st, x, y, s, s2);
+    }
+    if (st.radix == 3) {
+        const __m256d half = _mm256_set1_pd(0.5), sin60 = _mm256_set1_pd(SIN_60);
+        for (size_t p = 0; p < m; ++p) {
+            const cplx* w = st.twiddles.data() + 2 * p;
+            __m256d w1r = _mm256_set1_pd(w[0].real()), w1i = _mm256_set1_pd(w[0].imag());
+            __m256d w2r = _mm256_set1_pd(w[1].real()), w2i = _mm256_set1_pd(w[1].imag());
+            for (size_t q = 0; q < s2; q += 2) {
+                __m256d a0 = _mm256_loadu_pd(xd + 2 * (q + s * p));
+                __m256d a1 = _mm256_loadu_pd(xd + 2 * (q + s * (p + m)));
+                __m256d a2 = _mm256_loadu_pd(xd + 2 * (q + s * (p + 2 * m)));
+                __m256d t1 = _mm256_add_pd(a1, a2);
+                __m256d t2 = _mm256_fnmadd_pd(half, t1, a0);
+                __m256d t3 = mul_neg_i(_mm256_mul_pd(sin60, _mm256_sub_pd(a1, a2)));
+                _mm256_storeu_pd(yd + 2 * (q + s * 3 * p), _mm256_add_pd(a0, t1));
+                _mm256_storeu_pd(yd + 2 * (q + s * (3 * p + 1)), cmul(_mm256_add_pd(t2, t3), w1r, w1i));
+                _mm256_storeu_pd(yd + 2 * (q + s * (3 * p + 2)), cmul(_mm256_sub_pd(t2, t3), w2r, w2i));
+            }
+        }
+        return;
+    }
+    if (st.radix == 2) {
+        for (size_t p = 0; p < m; ++p) {
+            const cplx w1 = st.twiddles[p];
+            __m256d wr = _mm256_set1_pd(w1.real()), wi = _mm256_set1_pd(w1.imag());
+            for (size_t q = 0; q < s2; q += 2) {
+                __m256d a0 = _mm256_loadu_pd(xd + 2 * (q + s * p));
+                __m256d a1 = _mm256_loadu_pd(xd + 2 * (q + s * (p + m)));
+                _mm256_storeu_pd(yd + 2 * (q + s * 2 * p), _mm256_add_pd(a0, a1));
+                _mm256_storeu_pd(yd + 2 * (q + s * (2 * p + 1)), cmul(_mm256_sub_pd(a0, a1), wr, wi));
+            }
+        }
+        return;
+    }
+    for (size_t p = 0; p < m; ++p) {
+        const cplx* w = st.twiddles.data() + 3 * p;
+        __m256d w1r = _mm256_set1_pd(w[0].real()), w1i = _mm256_set1_pd(w[0].imag());
+        __m256d w2r = _mm256_set1_pd(w[1].real()), w2i = _mm256_set1_pd(w[1].imag());
+        __m256d w3r = _mm256_set1_pd(w[2].real()), w3i = _mm256_set1_pd(w[2].imag());
+        for (size_t q = 0; q < s2; q += 2) {
+            __m256d a0 = _mm256_loadu_pd(xd + 2 * (q + s * p));
+            __m256d a1 = _mm256_loadu_pd(xd + 2 * (q + s * (p + m)));
+            __m256d a2 = _mm256_loadu_pd(xd + 2 * (q + s * (p + 2 * m)));
+            __m256d a3 = _mm256_loadu_pd(xd + 2 * (q + s * (p + 3 * m)));
+            __m256d t0 = _mm256_add_pd(a0, a2), t1 = _mm256_sub_pd(a0, a2);
+            __m256d t2 = _mm256_add_pd(a1, a3), t3 = mul_neg_i(_mm256_sub_pd(a1, a3));
+            _mm256_storeu_pd(yd + 2 * (q + s * 4 * p), _mm256_add_pd(t0, t2));
+            _mm256_storeu_pd(yd + 2 * (q + s * (4 * p + 1)), cmul(_mm256_add_pd(t1, t3), w1r, w1i));
+            _mm256_storeu_pd(yd + 2 * (q + s * (4 * p + 2)), cmul(_mm256_sub_pd(t0, t2), w2r, w2i));
+            _mm256_storeu_pd(yd + 2 * (q + s * (4 * p + 3)), cmul(_mm256_sub_pd(t1, t3), w3r, w3i));
+        }
+    }
+}
+#endif
+
+} // namespace fft_detail
+
+// Forward (e^-2pi i jk/n) and unscaled inverse complex FFTs of one length
+class FftPlan {
+private:
+    size_t length = 0;
+    std::vector<fft_detail::Stage> stages;
+
+public:
+    FftPlan() = default;
+
+    // n must be 2^a 3^b (see fft_size)
+    explicit FftPlan(size_t n) : length(n) {
+        size_t rest = n;
+        while (rest > 1) {
+            size_t radix = rest % 4 == 0 ? 4 : rest % 2 == 0 ? 2 : 3;
+            fft_detail::Stage st;
+            st.radix = radix;
+            st.n = rest;
+            const size_t m = rest / radix;
+            st.twiddles.resize(m * (radix - 1));
+            for (size_t p = 0; p < m; ++p) {
+                for (size_t u = 1; u < radix; ++u) {
+                    st.twiddles[p * (radix - 1) + u - 1] = std::polar(1.0, -2 * M_PI * double(p * u) / rest);
+                }
+            }
+            stages.push_back(std::move(st));
+            rest = m;
+        }
+    }
+
+    size_t size() const { return length; }
+
+    // Transforms `batch` interleaved sequences in place: element t of sequence
+    // b is data[t * batch + b]. work must hold size() * batch values.
+    void forward(cplx* data, cplx* work, size_t batch = 1) const {
+        cplx* x = data;
+        cplx* y = work;
+        size_t s = batch;
+#if defined(__x86_64__)
+        const bool simd = isa_supported(IsaLevel::AVX2);
+#endif
+        for (const auto& st : stages) {
+#if defined(__x86_64__)
+            if (simd && s >= 2) {
+                fft_detail::stage_avx2(st, x, y, s);
+            } else {
+                fft_detail::stage_scalar(st, x, y, s);
+            }
+#else
+            fft_detail::stage_scalar(st, x, y, s);
+#endif
+            std::swap(x, y);
+            s *= st.radix;
+        }
+        if (x != data) {
+            std::copy(x, x + length * batch, data);
+        }
+    }
+
+    // Inverse without the 1/n scale: conj(FFT(conj(x)))
+    void inverse(cplx* data, cplx* work, size_t batch = 1) const {
+        for (size_t i = 0; i < length * batch; ++i) {
+            data[i] = std::conj(data[i]);
+        }
+        forward(data, work, batch);
+        for (size_t i = 0; i < length * batch; ++i) {
+            data[i] = std::conj(data[i]);
+        }
+    }
+};
+
+// 2D FFT of real rows x cols images (cols even, both valid FftPlan lengths)
+// to and from the rows x (cols / 2 + 1) half spectrum
+class RealFft2d {
+private:
+    size_t rows, cols, half;
+    FftPlan row_plan, col_plan;
+    std::vector<cplx> line, work;
+
+public:
+    RealFft2d(size_t r, size_t c)
+        : rows(r), cols(c), half(c / 2 + 1), row_plan(c), col_plan(r),
+          line(c), work(std::max(c, r * (c / 2 + 1))) {}
+
+    size_t spectrum_cols() const { return half; }
+
+    // in: rows x cols (leading dimension ld); out: rows x spectrum_cols()
+    void forward(const double* in, size_t ld, cplx* out) {
+        for (size_t r = 0; r < rows; r += 2) {
+            const double* x0 = in + r * ld;
+            const double* x1 = r + 1 < rows ? in + (r + 1) * ld : nullptr;
+            for (size_t c = 0; c < cols; ++c) {
+                line[c] = cplx(x0[c], x1 ? x1[c] : 0.0);
+            }
+            row_plan.forward(line.data(), work.data());
+            // Split the two real transforms: X = (Z[k] + conj Z[-k]) / 2, Y = (Z[k] - conj Z[-k]) / 2i
+            for (size_t k = 0; k < half; ++k) {
+                cplx z = line[k], zc = std::conj(line[(cols - k) % cols]);
+                out[r * half + k] = 0.5 * (z + zc);
+                if (x1) {
+                    cplx d = 0.5 * (z - zc);
+                    out[(r + 1) * half + k] = cplx(d.imag(), -d.real());
+                }
+            }
+        }
+        col_plan.forward(out, work.data(), half);
+    }
+
+    // Scaled inverse (1 / (rows cols)); `spectrum` is overwritten
+    void inverse(cplx* spectrum, double* out, size_t ld) {
+        col_plan.inverse(spectrum, work.data(), half);
+        const double scale = 1.0 / (double(rows) * cols);
+        for (size_t r = 0; r < rows; r += 2) {
+            const cplx* x0 = spectrum + r * half;
+            const cplx* x1 = r + 1 < rows ? spectrum + (r + 1) * half : nullptr;
+            // Z = X + iY over the full length, mirroring the half spectra
+            for (size_t k = 0; k < cols; ++k) {
+                cplx a = k < half ? x0[k] : std::conj(x0[cols - k]);
+                cplx b = x1 ? (k < half ? x1[k] : std::conj(x1[cols - k])) : 0.0;
+                line[k] = a + cplx(-b.imag(), b.real());
+            }
+            row_plan.inverse(line.data(), work.data());
+            for (size_t c = 0; c < cols; ++c) {
+                out[r * ld + c] = line[c].real() * scale;
+                if (x1) {
+                    out[(r + 1) * ld + c] = line[c].imag() * scale;
+                }
+            }
+        }
+    }
+};
+
+namespace fft_detail {
+
+// Approximate flops of one real 2D transform (half of a complex one)
+inline double real_fft2d_flops(size_t r, size_t c) {
+    return 2.5 * double(r) * c * std::log2(double(r) * c);
+}
+
+// FFT tile side for a kernel side k: minimizes transform work per output
+// pixel, (2 transforms + spectrum product) / (tile - k + 1)^2
+inline size_t tile_size(size_t k, size_t image) {
+    size_t best = fft_size(image + k - 1, true);
+    double best_cost = 1e300;
+    for (size_t t = fft_size(2 * k, true); t <= std::max<size_t>(fft_size(image + k - 1, true), 2 * k); t = fft_size(t + 1, true)) {
+        size_t useful = std::min(t - k + 1, image);
+        double cost = (2 * real_fft2d_flops(t, t) + 6.0 * t * t) / (double(useful) * useful);
+        if (cost < best_cost) {
+            best_cost = cost;
+            best = t;
+        }
+        if (t >= image + k - 1) {
+            break;
+        }
+    }
+    return best;
+}
+
+} // namespace fft_detail
+
+// Valid 2D correlation, out(i, j) = sum input(i + u, j + v) kernel(u, v),
+// identical in meaning to a direct sliding-window loop. Overlap-add: input
+// blocks of (tile - k + 1) per side are correlated with the kernel through
+// tile x tile transforms and summed into the output.
+template<typename T>
+Matrix<T> fft_correlate_2d(const Matrix<T>& input, const Matrix<T>& kernel) {
+    const size_t in_r = input.num_rows(), in_c = input.num_cols();
+    const size_t k_r = kernel.num_rows(), k_c = kernel.num_cols();
+    const size_t out_r = in_r - k_r + 1, out_c = in_c - k_c + 1;
+    const size_t tr = fft_detail::tile_size(k_r, in_r), tc = fft_detail::tile_size(k_c, in_c);
+    const size_t br = tr - k_r + 1, bc = tc - k_c + 1;     // input block per tile
+
+    RealFft2d fft(tr, tc);
+    const size_t half = fft.spectrum_cols();
+
+    // Correlation is convolution with the flipped kernel
+    std::vector<double> pad(tr * tc, 0.0);
+    for (size_t u = 0; u < k_r; ++u) {
+        for (size_t v = 0; v < k_c; ++v) {
+            pad[u * tc + v] = kernel(k_r - 1 - u, k_c - 1 - v);
+        }
+    }
+    std::vector<cplx> kernel_spectrum(tr * half), spectrum(tr * half);
+    fft.forward(pad.data(), tc, kernel_spectrum.data());
+
+    std::vector<double> acc(out_r * out_c, 0.0);
+    for (size_t i0 = 0; i0 < in_r; i0 += br) {
+        for (size_t j0 = 0; j0 < in_c; j0 += bc) {
+            const size_t rows = std::min(br, in_r - i0), cols = std::min(bc, in_c - j0);
+            std::fill(pad.begin(), pad.end(), 0.0);
+            for (size_t u = 0; u < rows; ++u) {
+                for (size_t v = 0; v < cols; ++v) {
+                    pad[u * tc + v] = input(i0 + u, j0 + v);
+                }
+            }
+            fft.forward(pad.data(), tc, spectrum.data());
+            for (size_t e = 0; e < spectrum.size(); ++e) {
+                spectrum[e] *= kernel_spectrum[e];
+            }
+            fft.inverse(spectrum.data(), pad.data(), tc);
+
+            // Full convolution index (i0 + u, j0 + v) is output (.. - k + 1)
+            for (size_t u = 0; u < rows + k_r - 1; ++u) {
+                size_t oi = i0 + u;
+                if (oi < k_r - 1 || oi - (k_r - 1) >= out_r) {
+                    continue;
+                }
+                double* out_row = acc.data() + (oi - (k_r - 1)) * out_c;
+                for (size_t v = 0; v < cols + k_c - 1; ++v) {
+                    size_t oj = j0 + v;
+                    if (oj >= k_c - 1 && oj - (k_c - 1) < out_c) {
+                        out_row[oj - (k_c - 1)] += pad[u * tc + v];
+                    }
+                }
+            }
+        }
+    }
+    Matrix<T> output(out_r, out_c);
+    for (size_t i = 0; i < out_r; ++i) {
+        for (size_t j = 0; j < out_c; ++j) {
+            output(i, j) = static_cast<T>(acc[i * out_c + j]);
+        }
+    }
+    return output;
+}
+
+// Cost model for choosing between direct and FFT correlation. Direct work is
+// 2 K^2 flops per output; the FFT path's transform flops are weighted by
+// FFT_FLOP_WEIGHT, the rate of the scalar sliding-window loop relative to the
+// vectorized butterflies (measured ~0.5, putting the crossover near 5x5).
+const double FFT_FLOP_WEIGHT = 0.5;
+
+inline bool prefer_fft_correlation(size_t in_r, size_t in_c, size_t k_r, size_t k_c) {
+    if (k_r > in_r || k_c > in_c) {
+        return false;
+    }
+    const double direct = 2.0 * (in_r - k_r + 1) * (in_c - k_c + 1) * k_r * k_c;
+    const size_t tr = fft_detail::tile_size(k_r, in_r), tc = fft_detail::tile_size(k_c, in_c);
+    const double tiles = std::ceil(double(in_r) / (tr - k_r + 1)) * std::ceil(double(in_c) / (tc - k_c + 1));
+    const double fft = tiles * (2 * fft_detail::real_fft2d_flops(tr, tc) + 6.0 * tr * tc);
+    return FFT_FLOP_WEIGHT * fft < direct;
+}
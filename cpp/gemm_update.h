@@ -0,0 +1,123 @@
+/*
+ * Strided GEMM Update
+ * C += A * B and C -= A * B on row-major blocks with independent row strides,
+ * so the operands can be sub-blocks of larger matrices. The kernel is
+ * register-blocked over 4 rows and 2 vectors of C (AVX2+FMA when available,
+ * scalar otherwise). It is the trailing update of the blocked factorizations
+ * and the per-element GEMM of multi-channel Winograd convolution.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <type_traits>
+
+#include "batched_gemm.h"
+#include "cpu_dispatch.h"
+
+namespace gemm_update_detail {
+
+// A's coefficient as added into C
+template<bool SUBTRACT, typename T>
+inline T coefficient(T a) {
+    return SUBTRACT ? -a : a;
+}
+
+// c (m x n) +/-= a (m x k) * b (k x n); lda / ldb / ldc are row strides
+template<bool SUBTRACT, typename T>
+void update_scalar(const T* a, size_t lda, const T* b, size_t ldb, T* c, size_t ldc,
+                   size_t m, size_t n, size_t k) {
+    for (size_t i = 0; i < m; ++i) {
+        T* c_row = c + i * ldc;
+        for (size_t p = 0; p < k; ++p) {
+            const T a_ip = coefficient<SUBTRACT>(a[i * lda + p]);
+            const T* b_row = b + p * ldb;
+            for (size_t j = 0; j < n; ++j) {
+                c_row[j] += a_ip * b_row[j];
+            }
+        }
+    }
+}
+
+#if defined(__x86_64__)
+// 4 rows x 2 vectors of C stay in registers for the whole k loop; per step
+// two vectors of B and four broadcasts of A feed eight FMAs
+template<bool SUBTRACT, typename T>
+__attribute__((target("avx2,fma")))
+void update_avx2(const T* a, size_t lda, const T* b, size_t ldb, T* c, size_t ldc,
+                 size_t m, size_t n, size_t k) {
+    using L = batched_detail::Lanes<T>;
+    const size_t W = L::W;
+    size_t i = 0;
+    for (; i + 4 <= m; i += 4) {
+        const T* a_rows = a + i * lda;
+        T* c_rows = c + i * ldc;
+        size_t j = 0;
+        for (; j + 2 * W <= n; j += 2 * W) {
+            auto c00 = L::load(c_rows + j), c01 = L::load(c_rows + j + W);
+            auto c10 = L::load(c_rows + ldc + j), c11 = L::load(c_rows + ldc + j + W);
+            auto c20 = L::load(c_rows + 2 * ldc + j), c21 = L::load(c_rows + 2 * ldc + j + W);
+            auto c30 = L::load(c_rows + 3 * ldc + j), c31 = L::load(c_rows + 3 * ldc + j + W);
+            for (size_t p = 0; p < k; ++p) {
+                const T* b_row = b + p * ldb + j;
+                auto b0 = L::load(b_row), b1 = L::load(b_row + W);
+                auto a0 = L::broadcast(coefficient<SUBTRACT>(a_rows[p]));
+                auto a1 = L::broadcast(coefficient<SUBTRACT>(a_rows[lda + p]));
+                auto a2 = L::broadcast(coefficient<SUBTRACT>(a_rows[2 * lda + p]));
+                auto a3 = L::broadcast(coefficient<SUBTRACT>(a_rows[3 * lda + p]));
+                c00 = L::fmadd(a0, b0, c00);
+                c01 = L::fmadd(a0, b1, c01);
+                c10 = L::fmadd(a1, b0, c10);
+                c11 = L::fmadd(a1, b1, c11);
+                c20 = L::fmadd(a2, b0, c20);
+                c21 = L::fmadd(a2, b1, c21);
+                c30 = L::fmadd(a3, b0, c30);
+                c31 = L::fmadd(a3, b1, c31);
+            }
+            L::store(c_rows + j, c00);
+            L::store(c_rows + j + W, c01);
+            L::store(c_rows + ldc + j, c10);
+            L::store(c_rows + ldc + j + W, c11);
+            L::store(c_rows + 2 * ldc + j, c20);
+            L::store(c_rows + 2 * ldc + j + W, c21);
+            L::store(c_rows + 3 * ldc + j, c30);
+            L::store(c_rows + 3 * ldc + j + W, c31);
+        }
+        if (j < n) {
+            update_scalar<SUBTRACT>(a_rows, lda, b + j, ldb, c_rows + j, ldc, 4, n - j, k);
+        }
+    }
+    if (i < m) {
+        update_scalar<SUBTRACT>(a + i * lda, lda, b, ldb, c + i * ldc, ldc, m - i, n, k);
+    }
+}
+#endif
+
+template<bool SUBTRACT, typename T>
+void update(const T* a, size_t lda, const T* b, size_t ldb, T* c, size_t ldc, size_t m, size_t n, size_t k) {
+#if defined(__x86_64__)
+    if constexpr (std::is_same<T, float>::value || std::is_same<T, double>::value) {
+        if (isa_supported(IsaLevel::AVX2)) {
+            update_avx2<SUBTRACT>(a, lda, b, ldb, c, ldc, m, n, k);
+            return;
+        }
+    }
+#endif
+    update_scalar<SUBTRACT>(a, lda, b, ldb, c, ldc, m, n, k);
+}
+
+} // namespace gemm_update_detail
+
+// c (m x n) += a (m x k) * b (k x n); lda / ldb / ldc are row strides
+template<typename T>
+void gemm_accumulate(const T* a, size_t lda, const T* b, size_t ldb, T* c, size_t ldc,
+                     size_t m, size_t n, size_t k) {
+    gemm_update_detail::update<false>(a, lda, b, ldb, c, ldc, m, n, k);
+}
+
+// c (m x n) -= a (m x k) * b (k x n)
+template<typename T>
+void gemm_subtract(const T* a, size_t lda, const T* b, size_t ldb, T* c, size_t ldc,
+                   size_t m, size_t n, size_t k) {
+    gemm_update_detail::update<true>(a, lda, b, ldb, c, ldc, m, n, k);
+}
@@ -0,0 +1,322 @@
+/*
+ * Reduced-Precision Storage
+ * bf16 (8-bit exponent, 7-bit mantissa: fp32 range, ~3 significant digits)
+ * and fp16 (IEEE half: 5-bit exponent, 10-bit mantissa, max 65504) element
+ * types for Matrix<T>. Values are stored in 16 bits and widened to fp32 for
+ * arithmetic, so memory-bound kernels move half the bytes while accumulating
+ * in fp32. Bulk conversions and the GEMM / element-wise kernels use F16C
+ * (fp16) and AVX2 (bf16: a 16-bit shift) when available; the scalar
+ * conversions round to nearest even.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#include "cpu_dispatch.h"
+#include "matrix.h"
+
+inline uint32_t float_bits(float f) {
+    uint32_t bits;
+    std::memcpy(&bits, &f, sizeof(bits));
+    return bits;
+}
+
+inline float bits_float(uint32_t bits) {
+    float f;
+    std::memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+inline uint16_t float_to_bf16_bits(float f) {
+    uint32_t bits = float_bits(f);
+    if ((bits & 0x7fffffff) > 0x7f800000) {
+        return static_cast<uint16_t>((bits >> 16) | 0x40);     // keep NaN quiet
+    }
+    bits += 0x7fff + ((bits >> 16) & 1);
+    return static_cast<uint16_t>(bits >> 16);
+}
+
+inline float bf16_bits_to_float(uint16_t h) {
+    return bits_float(static_cast<uint32_t>(h) << 16);
+}
+
+inline uint16_t float_to_fp16_bits(float f) {
+    uint32_t bits = float_bits(f);
+    uint32_t sign = (bits >> 16) & 0x8000;
+    uint32_t mag = bits & 0x7fffffff;
+    if (mag >= 0x7f800000) {
+        return static_cast<uint16_t>(sign | 0x7c00 | (mag > 0x7f800000 ? 0x200 : 0));
+    }
+    if (mag >= 0x477ff000) {                // rounds past 65504
+        return static_cast<uint16_t>(sign | 0x7c00);
+    }
+    if (mag < 0x38800000) {                 // below 2^-14: subnormal or zero
+        if (mag < 0x33000000) {
+            return static_cast<uint16_t>(sign);
+        }
+        uint32_t shift = 126 - (mag >> 23);
+        uint32_t mant = (mag & 0x7fffff) | 0x800000;
+        uint32_t r = mant >> shift, rem = mant & ((1u << shift) - 1), half = 1u << (shift - 1);
+        r += rem > half || (rem == half && (r & 1));
+        return static_cast<uint16_t>(sign | r);
+    }
+    uint32_t r = (mag - 0x38000000) >> 13, rem = mag & 0x1fff;
+    r += rem > 0x1000 || (rem == 0x1000 && (r & 1));
+    return static_cast<uint16_t>(sign | r);
+}
+
+inline float fp16_bits_to_float(uint16_t h) {
+    uint32_t sign = static_cast<uint32_t>(h & 0x8000) << 16;
+    uint32_t exp = (h >> 10) & 0x1f, mant = h & 0x3ff;
+    if (exp == 0x1f) {
+        return bits_float(sign | 0x7f800000 | (mant << 13));
+    }
+    if (exp == 0) {
+        if (mant == 0) {
+            return bits_float(sign);
+        }
+        exp = 113;
+        while (!(mant & 0x400)) {
+            mant <<= 1;
+            --exp;
+        }
+        return bits_float(sign | (exp << 23) | ((mant & 0x3ff) << 13));
+    }
+    return bits_float(sign | ((exp + 112) << 23) | (mant << 13));
+}
+
+// Implicit conversions both ways, so Matrix<T> code (randomize, fills) works
+struct bf16 {
+    uint16_t bits = 0;
+    bf16() = default;
+    bf16(float f) : bits(float_to_bf16_bits(f)) {}
+    operator float() const { return bf16_bits_to_float(bits); }
+    static const char* name() { return "bf16"; }
+};
+
+struct fp16 {
+    uint16_t bits = 0;
+    fp16() = default;
+    fp16(float f) : bits(float_to_fp16_bits(f)) {}
+    operator float() const { return fp16_bits_to_float(bits); }
+    static const char* name() { return "fp16"; }
+};
+
+namespace half_detail {
+
+#if defined(__x86_64__)
+// 8 values <-> one fp32 register
+__attribute__((target("avx2,fma,f16c")))
+inline __m256 load8(const fp16* p) {
+    return _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+}
+
+__attribute__((target("avx2,fma,f16c")))
+inline void store8(fp16* p, __m256 v) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p), _mm256_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT));
+}
+
+__attribute__((target("avx2,fma,f16c")))
+inline __m256 load8(const bf16* p) {
+    __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    return _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_cvtepu16_epi32(h), 16));
+}
+
+// Round to nearest even, NaNs kept quiet, then pack the high halves
+__attribute__((target("avx2,fma,f16c")))
+inline void store8(bf16* p, __m256 v) {
+    __m256i bits = _mm256_castps_si256(v);
+    __m256i lsb = _mm256_and_si256(_mm256_srli_epi32(bits, 16), _mm256_set1_epi32(1));
+    __m256i rounded = _mm256_srli_epi32(_mm256_add_epi32(bits, _mm256_add_epi32(lsb, _mm256_set1_epi32(0x7fff))), 16);
+    __m256i quiet_nan = _mm256_or_si256(_mm256_srli_epi32(bits, 16), _mm256_set1_epi32(0x40));
+    __m256 is_nan = _mm256_cmp_ps(v, v, _CMP_UNORD_Q);
+    __m256i h = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(rounded),
+                                                     _mm256_castsi256_ps(quiet_nan), is_nan));
+    h = _mm256_and_si256(h, _mm256_set1_epi32(0xffff));
+    __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(h, h), 0x08);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p), _mm256_castsi256_si128(packed));
+}
+
+template<typename H>
+__attribute__((target("avx2,fma,f16c")))
+void widen_simd(const H* src, float* dst, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(dst + i, load8(src + i));
+    }
+    for (; i < n; ++i) {
+        dst[i] = src[i];
+    }
+}
+
+template<typename H>
+__attribute__((target("avx2,fma,f16c")))
+void narrow_simd(const float* src, H* dst, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        store8(dst + i, _mm256_loadu_ps(src + i));
+    }
+    for (; i < n; ++i) {
+        dst[i] = src[i];
+    }
+}
+
+// Same loop order as gemm_kernel_avx2 (broadcast a(i, p) times row p of B);
+// B rows are widened on load and C stays fp32
+template<typename H>
+__attribute__((target("avx2,fma,f16c")))
+void gemm_simd(const H* a, const H* b, float* c, size_t m, size_t n, size_t k) {
+    for (size_t i = 0; i < m; ++i) {
+        float* c_row = c + i * n;
+        for (size_t p = 0; p < k; ++p) {
+            float a_ip = a[i * k + p];
+            __m256 a_vec = _mm256_set1_ps(a_ip);
+            const H* b_row = b + p * n;
+            size_t j = 0;
+            for (; j + 8 <= n; j += 8) {
+                _mm256_storeu_ps(c_row + j, _mm256_fmadd_ps(a_vec, load8(b_row + j), _mm256_loadu_ps(c_row + j)));
+            }
+            for (; j < n; ++j) {
+                c_row[j] += a_ip * float(b_row[j]);
+            }
+        }
+    }
+}
+
+template<typename H>
+__attribute__((target("avx2,fma,f16c")))
+void axpy_simd(float alpha, const H* x, H* y, size_t n) {
+    const __m256 av = _mm256_set1_ps(alpha);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        store8(y + i, _mm256_fmadd_ps(av, load8(x + i), load8(y + i)));
+    }
+    for (; i < n; ++i) {
+        y[i] = alpha * float(x[i]) + float(y[i]);
+    }
+}
+
+template<typename H>
+__attribute__((target("avx2,fma,f16c")))
+float dot_simd(const H* x, const H* y, size_t n) {
+    __m256 a0 = _mm256_setzero_ps(), a1 = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        a0 = _mm256_fmadd_ps(load8(x + i), load8(y + i), a0);
+        a1 = _mm256_fmadd_ps(load8(x + i + 8), load8(y + i + 8), a1);
+    }
+    alignas(32) float lanes[8];
+    _mm256_store_ps(lanes, _mm256_add_ps(a0, a1));
+    float s = 0;
+    for (float v : lanes) {
+        s += v;
+    }
+    for (; i < n; ++i) {
+        s += float(x[i]) * float(y[i]);
+    }
+    return s;
+}
+#endif
+
+// bf16 needs only AVX2; fp16 also needs F16C
+template<typename H>
+bool use_simd() {
+    return std::is_same<H, bf16>::value ? isa_supported(IsaLevel::AVX2) : feature_supported(CpuFeature::F16C);
+}
+
+} // namespace half_detail
+
+template<typename H>
+void widen(const H* src, float* dst, size_t n) {
+#if defined(__x86_64__)
+    if (half_detail::use_simd<H>()) {
+        half_detail::widen_simd(src, dst, n);
+        return;
+    }
+#endif
+    std::copy(src, src + n, dst);
+}
+
+template<typename H>
+void narrow(const float* src, H* dst, size_t n) {
+#if defined(__x86_64__)
+    if (half_detail::use_simd<H>()) {
+        half_detail::narrow_simd(src, dst, n);
+        return;
+    }
+#endif
+    std::copy(src, src + n, dst);
+}
+
+template<typename H>
+Matrix<H> to_reduced(const Matrix<float>& a) {
+    Matrix<H> r(a.num_rows(), a.num_cols());
+    narrow(a.raw(), r.raw(), a.num_rows() * a.num_cols());
+    return r;
+}
+
+template<typename H>
+Matrix<float> to_float(const Matrix<H>& a) {
+    Matrix<float> r(a.num_rows(), a.num_cols());
+    widen(a.raw(), r.raw(), a.num_rows() * a.num_cols());
+    return r;
+}
+
+// C (fp32) = A * B with reduced-precision operands and fp32 accumulation
+template<typename H>
+Matrix<float> multiply_reduced(const Matrix<H>& a, const Matrix<H>& b) {
+    size_t m = a.num_rows(), n = b.num_cols(), k = a.num_cols();
+    Matrix<float> c(m, n, 0.0f);
+#if defined(__x86_64__)
+    if (half_detail::use_simd<H>()) {
+        half_detail::gemm_simd(a.raw(), b.raw(), c.raw(), m, n, k);
+        return c;
+    }
+#endif
+    for (size_t i = 0; i < m; ++i) {
+        for (size_t p = 0; p < k; ++p) {
+            float a_ip = a(i, p);
+            for (size_t j = 0; j < n; ++j) {
+                c(i, j) += a_ip * float(b(p, j));
+            }
+        }
+    }
+    return c;
+}
+
+// y = alpha * x + y, computed in fp32 and rounded back to H
+template<typename H>
+void axpy_reduced(float alpha, const H* x, H* y, size_t n) {
+#if defined(__x86_64__)
+    if (half_detail::use_simd<H>()) {
+        half_detail::axpy_simd(alpha, x, y, n);
+        return;
+    }
+#endif
+    for (size_t i = 0; i < n; ++i) {
+        y[i] = alpha * float(x[i]) + float(y[i]);
+    }
+}
+
+// Dot product accumulated in fp32
+template<typename H>
+float dot_reduced(const H* x, const H* y, size_t n) {
+#if defined(__x86_64__)
+    if (half_detail::use_simd<H>()) {
+        return half_detail::dot_simd(x, y, n);
+    }
+#endif
+    float s = 0;
+    for (size_t i = 0; i < n; ++i) {
+        s += float(x[i]) * float(y[i]);
+    }
+    return s;
+}
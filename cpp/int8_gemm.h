@@ -0,0 +1,331 @@
+/*
+ * Int8 Quantized GEMM
+ * Symmetric linear quantization of Matrix<float> to int8 (per tensor, per
+ * row or per column scales) and an int8 x int8 -> int32 GEMM with
+ * dequantization back to float.
+ *
+ * The x86 byte dot products multiply unsigned by signed bytes, so A is
+ * shifted by +64 to unsigned and the shift is removed afterwards with the
+ * column sums of B: sum (a + 64) b = sum a b + 64 sum b. AVX2's vpmaddubsw
+ * adds pairs of products into saturating int16, so A is quantized to 7 bits
+ * (levels -63..63, shifted 1..127), which keeps every pair below 2^15; B
+ * uses the full int8 range. vpmaddwd then widens the pairs to int32. With
+ * VNNI (AVX-VNNI or AVX512-VNNI), vpdpbusd does all of that in one
+ * instruction.
+ *
+ * B is packed once into 16-column panels: for every 4 consecutive k, the 4
+ * bytes of each of the 16 columns are contiguous, which is exactly the
+ * operand layout of the byte dot products (one int32 lane per column).
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#include "cpu_dispatch.h"
+#include "matrix.h"
+
+enum class QuantGranularity { PER_TENSOR, PER_ROW, PER_COLUMN };
+
+struct QuantizedMatrix {
+    size_t rows = 0, cols = 0;
+    int max_level = 127;                    // values lie in [-max_level, max_level]
+    QuantGranularity granularity = QuantGranularity::PER_TENSOR;
+    std::vector<int8_t> values;             // row-major
+    std::vector<float> scales;              // 1, rows or cols entries
+
+    float scale(size_t i, size_t j) const {
+        switch (granularity) {
+            case QuantGranularity::PER_ROW: return scales[i];
+            case QuantGranularity::PER_COLUMN: return scales[j];
+            default: return scales[0];
+        }
+    }
+};
+
+// x ~= q * scale with scale = max|x| / max_level over each group
+inline QuantizedMatrix quantize(const Matrix<float>& a, QuantGranularity granularity, int bits = 8) {
+    QuantizedMatrix q;
+    q.rows = a.num_rows();
+    q.cols = a.num_cols();
+    q.max_level = (1 << (bits - 1)) - 1;
+    q.granularity = granularity;
+    size_t groups = granularity == QuantGranularity::PER_ROW ? q.rows
+                  : granularity == QuantGranularity::PER_COLUMN ? q.cols : 1;
+    std::vector<float> max_abs(groups, 0.0f);
+    auto group = [&](size_t i, size_t j) {
+        return granularity == QuantGranularity::PER_ROW ? i : granularity == QuantGranularity::PER_COLUMN ? j : 0;
+    };
+    for (size_t i = 0; i < q.rows; ++i) {
+        for (size_t j = 0; j < q.cols; ++j) {
+            float& m = max_abs[group(i, j)];
+            m = std::max(m, std::fabs(a(i, j)));
+        }
+    }
+    q.scales.resize(groups);
+    for (size_t g = 0; g < groups; ++g) {
+        q.scales[g] = max_abs[g] > 0 ? max_abs[g] / q.max_level : 1.0f;
+    }
+    q.values.resize(q.rows * q.cols);
+    for (size_t i = 0; i < q.rows; ++i) {
+        for (size_t j = 0; j < q.cols; ++j) {
+            float level = std::nearbyint(a(i, j) / q.scales[group(i, j)]);
+            level = std::min<float>(q.max_level, std::max<float>(-q.max_level, level));
+            q.values[i * q.cols + j] = static_cast<int8_t>(level);
+        }
+    }
+    return q;
+}
+
+// Left operand of multiply_int8: 7 bits (levels -63..63) so the +64 shift
+// fits an unsigned byte and vpmaddubsw pairs cannot saturate
+inline QuantizedMatrix quantize_lhs(const Matrix<float>& a, QuantGranularity granularity) {
+    return quantize(a, granularity, 7);
+}
+
+inline Matrix<float> dequantize(const QuantizedMatrix& q) {
+    Matrix<float> a(q.rows, q.cols);
+    for (size_t i = 0; i < q.rows; ++i) {
+        for (size_t j = 0; j < q.cols; ++j) {
+            a(i, j) = q.values[i * q.cols + j] * q.scale(i, j);
+        }
+    }
+    return a;
+}
+
+// B (k x n) packed into 16-column panels of 4-deep k groups, zero-padded
+struct PackedB {
+    static const size_t PANEL = 16;
+    size_t k = 0, n = 0, k_padded = 0, n_padded = 0;
+    std::vector<int8_t> data;               // n_padded / PANEL panels of k_padded * PANEL bytes
+    std::vector<int32_t> col_sums;          // sum over k of each column, for the A shift
+};
+
+inline PackedB pack_b(const QuantizedMatrix& b) {
+    PackedB packed;
+    packed.k = b.rows;
+    packed.n = b.cols;
+    packed.k_padded = (b.rows + 3) / 4 * 4;
+    packed.n_padded = (b.cols + PackedB::PANEL - 1) / PackedB::PANEL * PackedB::PANEL;
+    packed.data.assign(packed.k_padded * packed.n_padded, 0);
+    packed.col_sums.assign(packed.n_padded, 0);
+    for (size_t p = 0; p < b.rows; ++p) {
+        for (size_t j = 0; j < b.cols; ++j) {
+            int8_t v = b.values[p * b.cols + j];
+            size_t panel = j / PackedB::PANEL, col = j % PackedB::PANEL;
+            packed.data[panel * packed.k_padded * PackedB::PANEL + (p / 4) * 4 * PackedB::PANEL
+                        + col * 4 + p % 4] = v;
+            packed.col_sums[j] += v;
+        }
+    }
+    return packed;
+}
+
+namespace int8_detail {
+
+// Added to A so it becomes unsigned; A's levels must stay below it
+const int A_SHIFT = 64;
+// Rows of C per micro-kernel step (A is padded to a multiple of this)
+const size_t ROWS = 4;
+
+// a is m x k unsigned (m % ROWS == 0, k % 4 == 0), b packed with
+// n % PANEL == 0; c (m x n) receives sum (a + A_SHIFT) * b
+typedef void (*Int8Kernel)(const uint8_t* a, const int8_t* b, int32_t* c, size_t m, size_t n, size_t k);
+
+inline void kernel_scalar(const uint8_t* a, const int8_t* b, int32_t* c, size_t m, size_t n, size_t k) {
+    for (size_t jp = 0; jp < n; jp += PackedB::PANEL) {
+        const int8_t* panel = b + jp * k;
+        for (size_t i = 0; i < m; ++i) {
+            for (size_t col = 0; col < PackedB::PANEL; ++col) {
+                int32_t sum = 0;
+                for (size_t p = 0; p < k; ++p) {
+                    sum += a[i * k + p] * panel[(p / 4) * 4 * PackedB::PANEL + col * 4 + p % 4];
+                }
+                c[i * n + jp + col] = sum;
+            }
+        }
+    }
+}
+
+#if defined(__x86_64__)
+inline int32_t load4(const uint8_t* p) {
+    int32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// 4 rows x 16 columns of C in 8 registers; per 4-deep k step, two panel
+// loads are shared by the 4 rows
+__attribute__((target("avx2,fma")))
+inline void kernel_avx2(const uint8_t* a, const int8_t* b, int32_t* c, size_t m, size_t n, size_t k) {
+    const __m256i ones = _mm256_set1_epi16(1);
+    for (size_t jp = 0; jp < n; jp += PackedB::PANEL) {
+        const int8_t* panel = b + jp * k;
+        for (size_t i = 0; i < m; i += ROWS) {
+            __m256i acc[ROWS][2];
+            for (size_t r = 0; r < ROWS; ++r) {
+                acc[r][0] = acc[r][1] = _mm256_setzero_si256();
+            }
+            for (size_t p = 0; p < k; p += 4) {
+                __m256i b0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(panel + p * PackedB::PANEL));
+                __m256i b1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(panel + p * PackedB::PANEL + 32));
+                for (size_t r = 0; r < ROWS; ++r) {
+                    __m256i av = _mm256_set1_epi32(load4(a + (i + r) * k + p));
+                    acc[r][0] = _mm256_add_epi32(acc[r][0], _mm256_madd_epi16(_mm256_maddubs_epi16(av, b0), ones));
+                    acc[r][1] = _mm256_add_epi32(acc[r][1], _mm256_madd_epi16(_mm256_maddubs_epi16(av, b1), ones));
+                }
+            }
+            for (size_t r = 0; r < ROWS; ++r) {
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(c + (i + r) * n + jp), acc[r][0]);
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(c + (i + r) * n + jp + 8), acc[r][1]);
+            }
+        }
+    }
+}
+
+// Same blocking; vpdpbusd (VEX-encoded AVX-VNNI) replaces maddubs + madd + add
+__attribute__((target("avx2,fma,avxvnni")))
+inline void kernel_avx_vnni(const uint8_t* a, const int8_t* b, int32_t* c, size_t m, size_t n, size_t k) {
+    for (size_t jp = 0; jp < n; jp += PackedB::PANEL) {
+        const int8_t* panel = b + jp * k;
+        for (size_t i = 0; i < m; i += ROWS) {
+            __m256i acc[ROWS][2];
+            for (size_t r = 0; r < ROWS; ++r) {
+                acc[r][0] = acc[r][1] = _mm256_setzero_si256();
+            }
+            for (size_t p = 0; p < k; p += 4) {
+                __m256i b0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(panel + p * PackedB::PANEL));
+                __m256i b1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(panel + p * PackedB::PANEL + 32));
+                for (size_t r = 0; r < ROWS; ++r) {
+                    __m256i av = _mm256_set1_epi32(load4(a + (i + r) * k + p));
+                    acc[r][0] = _mm256_dpbusd_avx_epi32(acc[r][0], av, b0);
+                    acc[r][1] = _mm256_dpbusd_avx_epi32(acc[r][1], av, b1);
+                }
+            }
+            for (size_t r = 0; r < ROWS; ++r) {
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(c + (i + r) * n + jp), acc[r][0]);
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(c + (i + r) * n + jp + 8), acc[r][1]);
+            }
+        }
+    }
+}
+
+// EVEX-encoded vpdpbusd on 256-bit registers (AVX512-VNNI + VL)
+__attribute__((target("avx512f,avx512vl,avx512vnni")))
+inline void kernel_avx512_vnni(const uint8_t* a, const int8_t* b, int32_t* c, size_t m, size_t n, size_t k) {
+    for (size_t jp = 0; jp < n; jp += PackedB::PANEL) {
+        const int8_t* panel = b + jp * k;
+        for (size_t i = 0; i < m; i += ROWS) {
+            __m256i acc[ROWS][2];
+            for (size_t r = 0; r < ROWS; ++r) {
+                acc[r][0] = acc[r][1] = _mm256_setzero_si256();
+            }
+            for (size_t p = 0; p < k; p += 4) {
+                __m256i b0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(panel + p * PackedB::PANEL));
+                __m256i b1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(panel + p * PackedB::PANEL + 32));
+                for (size_t r = 0; r < ROWS; ++r) {
+                    __m256i av = _mm256_set1_epi32(load4(a + (i + r) * k + p));
+                    acc[r][0] = _mm256_dpbusd_epi32(acc[r][0], av, b0);
+                    acc[r][1] = _mm256_dpbusd_epi32(acc[r][1], av, b1);
+                }
+            }
+            for (size_t r = 0; r < ROWS; ++r) {
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(c + (i + r) * n + jp), acc[r][0]);
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(c + (i + r) * n + jp + 8), acc[r][1]);
+            }
+        }
+    }
+}
+#endif
+
+inline bool always() { return true; }
+inline bool has_avx2() { return isa_supported(IsaLevel::AVX2); }
+inline bool has_avx_vnni() { return feature_supported(CpuFeature::AVX_VNNI); }
+inline bool has_avx512_vnni() { return feature_supported(CpuFeature::AVX512_VNNI); }
+
+struct Int8Variant {
+    const char* name;
+    bool (*available)();
+    Int8Kernel fn;
+};
+
+} // namespace int8_detail
+
+// Every compiled kernel, lowest first; the last available one is the default
+inline const std::vector<int8_detail::Int8Variant>& int8_kernels() {
+    using namespace int8_detail;
+    static const std::vector<Int8Variant> table = {
+        {"scalar", always, kernel_scalar},
+#if defined(__x86_64__)
+        {"avx2 (vpmaddubsw+vpmaddwd)", has_avx2, kernel_avx2},
+        {"avx512-vnni (vpdpbusd)", has_avx512_vnni, kernel_avx512_vnni},
+        {"avx-vnni (vpdpbusd)", has_avx_vnni, kernel_avx_vnni},
+#endif
+    };
+    return table;
+}
+
+inline const int8_detail::Int8Variant& select_int8_kernel() {
+    const int8_detail::Int8Variant* best = &int8_kernels().front();
+    for (const auto& v : int8_kernels()) {
+        if (v.available()) {
+            best = &v;
+        }
+    }
+    return *best;
+}
+
+// C (int32, a.rows x b.n) = A * B exactly. A must be quantized with at most
+// 7 bits (quantize_lhs); otherwise, or when a.cols != b.k, C is empty.
+inline Matrix<int32_t> multiply_int8(const QuantizedMatrix& a, const PackedB& b,
+                                     int8_detail::Int8Kernel kernel = select_int8_kernel().fn) {
+    using namespace int8_detail;
+    if (a.max_level >= A_SHIFT || a.cols != b.k) {
+        return Matrix<int32_t>(0, 0);
+    }
+    const size_t m_padded = (a.rows + ROWS - 1) / ROWS * ROWS;
+    std::vector<uint8_t> a_shifted(m_padded * b.k_padded, A_SHIFT);
+    for (size_t i = 0; i < a.rows; ++i) {
+        for (size_t p = 0; p < a.cols; ++p) {
+            a_shifted[i * b.k_padded + p] = static_cast<uint8_t>(a.values[i * a.cols + p] + A_SHIFT);
+        }
+    }
+    std::vector<int32_t> c_padded(m_padded * b.n_padded);
+    kernel(a_shifted.data(), b.data.data(), c_padded.data(), m_padded, b.n_padded, b.k_padded);
+
+    // Padded k rows of B are zero, so the shift contributes A_SHIFT * col_sum
+    Matrix<int32_t> c(a.rows, b.n);
+    for (size_t i = 0; i < a.rows; ++i) {
+        for (size_t j = 0; j < b.n; ++j) {
+            c(i, j) = c_padded[i * b.n_padded + j] - A_SHIFT * b.col_sums[j];
+        }
+    }
+    return c;
+}
+
+// Float result: int32 sums scaled by A's row (or tensor) scale and B's column
+// (or tensor) scale. A must be PER_TENSOR or PER_ROW, B PER_TENSOR or
+// PER_COLUMN, and c a.rows x b.cols; otherwise the result is empty.
+inline Matrix<float> dequantize_product(const Matrix<int32_t>& c, const QuantizedMatrix& a,
+                                        const QuantizedMatrix& b) {
+    if (a.granularity == QuantGranularity::PER_COLUMN || b.granularity == QuantGranularity::PER_ROW ||
+        c.num_rows() != a.rows || c.num_cols() != b.cols) {
+        return Matrix<float>(0, 0);
+    }
+    Matrix<float> out(c.num_rows(), c.num_cols());
+    for (size_t i = 0; i < c.num_rows(); ++i) {
+        float sa = a.scale(i, 0);
+        for (size_t j = 0; j < c.num_cols(); ++j) {
+            out(i, j) = c(i, j) * sa * b.scale(0, j);
+        }
+    }
+    return out;
+}
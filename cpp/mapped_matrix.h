@@ -0,0 +1,342 @@
+/*
+ * Out-of-Core Matrices
+ * MappedMatrix<T> is a row-major matrix stored in a file (raw elements, no
+ * header). Nothing is mapped up front: callers map windows of consecutive
+ * rows, so the address space in use is bounded by the windows alive at once,
+ * not by the matrix size, and the matrices can be far larger than memory.
+ *
+ * multiply_out_of_core computes C = A * B panel by panel: for every panel of
+ * C rows it walks down the depth of B in windows, packing the matching
+ * columns of the A panel and accumulating into the mapped C panel. With
+ * prefetch on, a helper thread maps, madvise(WILLNEED)s and touches the next
+ * window while the current one is multiplied, so page faults and disk reads
+ * overlap the arithmetic instead of stalling it.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <future>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#include "cpu_dispatch.h"
+
+template<typename T>
+class MappedMatrix {
+private:
+    int fd = -1;
+    size_t rows = 0, cols = 0;
+    bool writable = false;
+
+    int open_file(const std::string& path, int flags, size_t r, size_t c) {
+        close_file();
+        fd = ::open(path.c_str(), flags, 0644);
+        if (fd < 0) {
+            return -errno;
+        }
+        rows = r;
+        cols = c;
+        writable = (flags & O_ACCMODE) == O_RDWR;
+        return 0;
+    }
+
+    void close_file() {
+        if (fd >= 0) {
+            ::close(fd);
+            fd = -1;
+        }
+    }
+
+public:
+    // Rows [first, last) mapped into memory; unmapped on destruction
+    class Window {
+    private:
+        void* base = MAP_FAILED;
+        size_t length = 0;
+        T* first_row = nullptr;
+        size_t first = 0, cols = 0;
+
+        friend class MappedMatrix;
+
+    public:
+        Window() = default;
+        Window(Window&& other) noexcept { *this = std::move(other); }
+        Window& operator=(Window&& other) noexcept {
+            std::swap(base, other.base);
+            std::swap(length, other.length);
+            std::swap(first_row, other.first_row);
+            std::swap(first, other.first);
+            std::swap(cols, other.cols);
+            return *this;
+        }
+        ~Window() {
+            if (base != MAP_FAILED) {
+                munmap(base, length);
+            }
+        }
+
+        bool ok() const { return base != MAP_FAILED; }
+        size_t bytes() const { return length; }
+
+        // Row i of the matrix (absolute index, must lie inside the window)
+        T* row(size_t i) const { return first_row + (i - first) * cols; }
+
+        // Faults every page in now, so later accesses do not stall
+        void touch() const {
+            const long page = sysconf(_SC_PAGESIZE);
+            const volatile char* p = static_cast<const volatile char*>(base);
+            for (size_t off = 0; off < length; off += page) {
+                (void)p[off];
+            }
+        }
+
+        Window(const Window&) = delete;
+        Window& operator=(const Window&) = delete;
+    };
+
+    MappedMatrix() = default;
+    ~MappedMatrix() { close_file(); }
+
+    // New file of zeros (sparse, so creating it costs no disk space); 0 or -errno
+    int create(const std::string& path, size_t r, size_t c) {
+        int err = open_file(path, O_RDWR | O_CREAT | O_TRUNC, r, c);
+        if (err == 0 && ftruncate(fd, static_cast<off_t>(r * c * sizeof(T))) != 0) {
+            err = -errno;
+            close_file();
+        }
+        return err;
+    }
+
+    // Existing file, which must hold exactly r x c elements; 0 or -errno
+    int open(const std::string& path, size_t r, size_t c, bool write = false) {
+        int err = open_file(path, write ? O_RDWR : O_RDONLY, r, c);
+        if (err == 0 && lseek(fd, 0, SEEK_END) != static_cast<off_t>(r * c * sizeof(T))) {
+            close_file();
+            err = -EINVAL;
+        }
+        return err;
+    }
+
+    size_t num_rows() const { return rows; }
+    size_t num_cols() const { return cols; }
+    int descriptor() const { return fd; }
+
+    // Maps rows [first, last); check Window::ok(). `advice` is an madvise hint
+    // for the range (MADV_SEQUENTIAL, MADV_WILLNEED, ...), 0 for none.
+    Window map_rows(size_t first, size_t last, bool write = false, int advice = 0) const {
+        Window w;
+        if (fd < 0 || first >= last || last > rows || (write && !writable)) {
+            errno = EINVAL;
+            return w;
+        }
+        const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        size_t offset = first * cols * sizeof(T);
+        size_t aligned = offset / page * page;
+        size_t length = (last - first) * cols * sizeof(T) + (offset - aligned);
+        void* base = mmap(nullptr, length, write ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED,
+                          fd, static_cast<off_t>(aligned));
+        if (base == MAP_FAILED) {
+            return w;
+        }
+        if (advice != 0) {
+            madvise(base, length, advice);
+        }
+        w.base = base;
+        w.length = length;
+        w.first_row = reinterpret_cast<T*>(static_cast<char*>(base) + (offset - aligned));
+        w.first = first;
+        w.cols = cols;
+        return w;
+    }
+
+    MappedMatrix(const MappedMatrix&) = delete;
+    MappedMatrix& operator=(const MappedMatrix&) = delete;
+};
+
+struct OutOfCoreOptions {
+    size_t panel = 256;         // rows of C (and A) resident at once
+    size_t depth = 256;         // rows of B per streamed window
+    bool prefetch = true;       // map and fault in the next window on a helper thread
+};
+
+struct OutOfCoreStats {
+    size_t windows = 0;             // B windows streamed
+    size_t bytes_mapped = 0;        // total bytes of every window mapped
+    size_t peak_mapped = 0;         // largest number of bytes mapped at the same time
+    double wait_seconds = 0;        // compute thread blocked on the next window
+};
+
+namespace ooc_detail {
+
+// Columns of C per cache block in the tile kernel: a depth x 512 float block of B is 512KB
+const size_t COL_BLOCK = 512;
+
+// c (m x n, leading dimension ldc) += a (m x k, packed) * b (k x n, leading dimension ldb)
+inline void tile_scalar(const float* a, const float* b, size_t ldb, float* c, size_t ldc,
+                        size_t m, size_t n, size_t k) {
+    for (size_t jb = 0; jb < n; jb += COL_BLOCK) {
+        size_t j_end = std::min(n, jb + COL_BLOCK);
+        for (size_t i = 0; i < m; ++i) {
+            float* c_row = c + i * ldc;
+            for (size_t p = 0; p < k; ++p) {
+                const float a_ip = a[i * k + p];
+                const float* b_row = b + p * ldb;
+                for (size_t j = jb; j < j_end; ++j) {
+                    c_row[j] += a_ip * b_row[j];
+                }
+            }
+        }
+    }
+}
+
+#if defined(__x86_64__)
+__attribute__((target("avx2,fma")))
+inline void tile_avx2(const float* a, const float* b, size_t ldb, float* c, size_t ldc,
+                      size_t m, size_t n, size_t k) {
+    for (size_t jb = 0; jb < n; jb += COL_BLOCK) {
+        size_t j_end = std::min(n, jb + COL_BLOCK);
+        for (size_t i = 0; i < m; ++i) {
+            float* c_row = c + i * ldc;
+            for (size_t p = 0; p < k; ++p) {
+                const float a_ip = a[i * k + p];
+                const __m256 a_vec = _mm256_set1_ps(a_ip);
+                const float* b_row = b + p * ldb;
+                size_t j = jb;
+                for (; j + 8 <= j_end; j += 8) {
+                    _mm256_storeu_ps(c_row + j, _mm256_fmadd_ps(a_vec, _mm256_loadu_ps(b_row + j),
+                                                                _mm256_loadu_ps(c_row + j)));
+                }
+                for (; j < j_end; ++j) {
+                    c_row[j] += a_ip * b_row[j];
+                }
+            }
+        }
+    }
+}
+#endif
+
+// One streamed step: B rows [k0, k1) against C rows [i0, i1)
+struct Step {
+    size_t i0, i1, k0, k1;
+};
+
+// Operands of a step; `a` is mapped only for the first step of a row panel.
+// err is 0, or -errno of the failed mapping, captured on the mapping thread.
+struct Operands {
+    MappedMatrix<float>::Window a, b;
+    int err = 0;
+};
+
+inline Operands map_step(const MappedMatrix<float>& a, const MappedMatrix<float>& b, const Step& s, bool touch) {
+    Operands ops;
+    if (s.k0 == 0) {
+        ops.a = a.map_rows(s.i0, s.i1, false, MADV_WILLNEED);
+        if (!ops.a.ok()) {
+            ops.err = -errno;
+            return ops;
+        }
+    }
+    ops.b = b.map_rows(s.k0, s.k1, false, MADV_WILLNEED);
+    if (!ops.b.ok()) {
+        ops.err = -errno;
+        return ops;
+    }
+    if (touch) {
+        if (ops.a.ok()) {
+            ops.a.touch();
+        }
+        if (ops.b.ok()) {
+            ops.b.touch();
+        }
+    }
+    return ops;
+}
+
+} // namespace ooc_detail
+
+// C = A * B for float matrices in files; c must be writable (e.g. fresh from
+// create(), whose zeros are accumulated into). Returns 0 or -errno.
+inline int multiply_out_of_core(const MappedMatrix<float>& a, const MappedMatrix<float>& b, MappedMatrix<float>& c,
+                                const OutOfCoreOptions& options = OutOfCoreOptions(), OutOfCoreStats* stats = nullptr) {
+    using namespace ooc_detail;
+    const size_t m = a.num_rows(), k = a.num_cols(), n = b.num_cols();
+    if (b.num_rows() != k || c.num_rows() != m || c.num_cols() != n || options.panel == 0 || options.depth == 0) {
+        return -EINVAL;
+    }
+    auto tile = tile_scalar;
+#if defined(__x86_64__)
+    if (isa_supported(IsaLevel::AVX2)) {
+        tile = tile_avx2;
+    }
+#endif
+
+    std::vector<Step> steps;
+    for (size_t i0 = 0; i0 < m; i0 += options.panel) {
+        for (size_t k0 = 0; k0 < k; k0 += options.depth) {
+            steps.push_back({i0, std::min(m, i0 + options.panel), k0, std::min(k, k0 + options.depth)});
+        }
+    }
+    OutOfCoreStats local;
+    OutOfCoreStats& st = stats ? *stats : local;
+    st = OutOfCoreStats();
+
+    std::vector<float> a_pack(options.panel * options.depth);
+    MappedMatrix<float>::Window a_panel, c_panel;
+    std::future<Operands> next;
+    if (options.prefetch && !steps.empty()) {
+        next = std::async(std::launch::async, map_step, std::cref(a), std::cref(b), steps[0], true);
+    }
+    for (size_t s = 0; s < steps.size(); ++s) {
+        const Step& step = steps[s];
+        Operands ops;
+        if (options.prefetch) {
+            auto start = std::chrono::steady_clock::now();
+            ops = next.get();
+            st.wait_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            if (s + 1 < steps.size()) {
+                next = std::async(std::launch::async, map_step, std::cref(a), std::cref(b), steps[s + 1], true);
+            }
+        } else {
+            ops = map_step(a, b, step, false);
+        }
+        if (ops.err != 0) {
+            return ops.err;
+        }
+        if (step.k0 == 0) {
+            c_panel = MappedMatrix<float>::Window();     // unmap the finished panel first
+            a_panel = std::move(ops.a);
+            c_panel = c.map_rows(step.i0, step.i1, true);
+            if (!c_panel.ok()) {
+                return -errno;
+            }
+        }
+
+        const size_t rows = step.i1 - step.i0, depth = step.k1 - step.k0;
+        for (size_t i = 0; i < rows; ++i) {
+            std::memcpy(a_pack.data() + i * depth, a_panel.row(step.i0 + i) + step.k0, depth * sizeof(float));
+        }
+        tile(a_pack.data(), ops.b.row(step.k0), n, c_panel.row(step.i0), n, rows, n, depth);
+
+        // Alive now: A and C panels, this B window and (prefetching) the next step's windows
+        size_t next_bytes = options.prefetch && s + 1 < steps.size()
+            ? (steps[s + 1].k1 - steps[s + 1].k0) * n * sizeof(float)
+              + (steps[s + 1].k0 == 0 ? (steps[s + 1].i1 - steps[s + 1].i0) * k * sizeof(float) : 0)
+            : 0;
+        st.peak_mapped = std::max(st.peak_mapped, a_panel.bytes() + c_panel.bytes() + ops.b.bytes() + next_bytes);
+        st.windows++;
+        st.bytes_mapped += ops.b.bytes() + (step.k0 == 0 ? a_panel.bytes() : 0);
+    }
+    return 0;
+}
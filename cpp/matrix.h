@@ -0,0 +1,50 @@
+/*
+ * Matrix
+ * Dense row-major matrix shared by the matrix examples and the kernel
+ * headers (sparse formats convert from it).
+ */
+
+#pragma once
+
+#include <cstdlib>
+#include <vector>
+
+template<typename T>
+class Matrix {
+private:
+    size_t rows, cols;
+    std::vector<T> data;
+
+public:
+    Matrix(size_t r, size_t c) : rows(r), cols(c), data(r * c) {}
+    
+    Matrix(size_t r, size_t c, T init_val) : rows(r), cols(c), data(r * c, init_val) {}
+    
+    T& operator()(size_t i, size_t j) {
+        return data[i * cols + j];
+    }
+    
+    const T& operator()(size_t i, size_t j) const {
+        return data[i * cols + j];
+    }
+    
+    T* row(size_t i) {
+        return &data[i * cols];
+    }
+    
+    const T* row(size_t i) const {
+        return &data[i * cols];
+    }
+    
+    size_t num_rows() const { return rows; }
+    size_t num_cols() const { return cols; }
+    
+    T* raw() { return data.data(); }
+    const T* raw() const { return data.data(); }
+    
+    void randomize() {
+        for (auto& val : data) {
+            val = static_cast<T>(rand()) / RAND_MAX;
+        }
+    }
+};
@@ -0,0 +1,337 @@
+/*
+ * Parallel Primitives
+ * Prefix sums (inclusive / exclusive scan), stable partition, compaction
+ * (copy_if) and histograms over contiguous arrays.
+ *
+ * A scan carries a dependency from every element to the next. The SIMD
+ * kernels scan eight 32-bit lanes in registers (log-step shifts inside each
+ * 128-bit half, then the low half's total added to the high half) so the
+ * loop-carried chain is one add per eight elements. The *_parallel versions
+ * are two-pass: every thread reduces (or counts) its contiguous chunk, the
+ * per-chunk totals are scanned sequentially, and a second pass writes each
+ * chunk from its offset. Partition and compaction pick the store slot with a
+ * select instead of branching on the predicate, and histograms spread
+ * consecutive keys over four 32-bit sub-histograms so repeated bins do not
+ * serialize on one counter.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#include "cpu_dispatch.h"
+
+namespace prim_detail {
+
+// Smallest chunk worth a thread of its own
+const size_t MIN_CHUNK = 1 << 16;
+
+// Sub-histograms interleaved by element index
+const size_t SUB_HISTOGRAMS = 4;
+
+inline int chunk_count(size_t n, int threads) {
+    return std::max(1, std::min<int>(threads, static_cast<int>(n / MIN_CHUNK) + 1));
+}
+
+// Runs fn(chunk, begin, end) for `chunks` contiguous chunks, one thread each
+template<typename Fn>
+void for_chunks(size_t n, int chunks, Fn fn) {
+    std::vector<std::thread> workers;
+    for (int c = 1; c < chunks; ++c) {
+        workers.emplace_back([&, c]() { fn(c, n * c / chunks, n * (c + 1) / chunks); });
+    }
+    fn(0, 0, n / chunks);
+    for (auto& w : workers) {
+        w.join();
+    }
+}
+
+// out[i] = carry + in[0] + ... + in[i] (inclusive) or + in[i - 1] (exclusive);
+// in and out may alias. Returns the carry after the last element.
+template<bool EXCLUSIVE, typename T>
+T scan_scalar(const T* in, T* out, size_t n, T carry) {
+    for (size_t i = 0; i < n; ++i) {
+        T x = in[i];
+        if (EXCLUSIVE) {
+            out[i] = carry;
+            carry += x;
+        } else {
+            carry += x;
+            out[i] = carry;
+        }
+    }
+    return carry;
+}
+
+// Element types with an AVX2 scan kernel
+template<typename T> struct SimdScan : std::false_type {};
+template<> struct SimdScan<int32_t> : std::true_type {};
+template<> struct SimdScan<uint32_t> : std::true_type {};
+template<> struct SimdScan<float> : std::true_type {};
+
+#if defined(__x86_64__)
+template<typename T> struct ScanLanes;
+
+template<typename T> struct IntScanLanes {
+    using V = __m256i;
+    __attribute__((target("avx2"))) static V broadcast(T x) { return _mm256_set1_epi32(static_cast<int>(x)); }
+    __attribute__((target("avx2"))) static V load(const T* p) { return _mm256_loadu_si256(reinterpret_cast<const V*>(p)); }
+    __attribute__((target("avx2"))) static void store(T* p, V v) { _mm256_storeu_si256(reinterpret_cast<V*>(p), v); }
+    __attribute__((target("avx2"))) static V add(V a, V b) { return _mm256_add_epi32(a, b); }
+    __attribute__((target("avx2"))) static T first(V v) { return static_cast<T>(_mm256_cvtsi256_si32(v)); }
+    __attribute__((target("avx2"))) static V permute(V v, __m256i idx) { return _mm256_permutevar8x32_epi32(v, idx); }
+    __attribute__((target("avx2"))) static V blend_first(V v, V first) { return _mm256_blend_epi32(v, first, 1); }
+    __attribute__((target("avx2"))) static V prefix(V x) {
+        x = _mm256_add_epi32(x, _mm256_slli_si256(x, 4));
+        x = _mm256_add_epi32(x, _mm256_slli_si256(x, 8));
+        V low_total = _mm256_shuffle_epi32(x, 0xFF);
+        return _mm256_add_epi32(x, _mm256_permute2x128_si256(low_total, low_total, 0x08));
+    }
+};
+
+template<> struct ScanLanes<int32_t> : IntScanLanes<int32_t> {};
+template<> struct ScanLanes<uint32_t> : IntScanLanes<uint32_t> {};
+
+template<> struct ScanLanes<float> {
+    using V = __m256;
+    __attribute__((target("avx2"))) static V broadcast(float x) { return _mm256_set1_ps(x); }
+    __attribute__((target("avx2"))) static V load(const float* p) { return _mm256_loadu_ps(p); }
+    __attribute__((target("avx2"))) static void store(float* p, V v) { _mm256_storeu_ps(p, v); }
+    __attribute__((target("avx2"))) static V add(V a, V b) { return _mm256_add_ps(a, b); }
+    __attribute__((target("avx2"))) static float first(V v) { return _mm256_cvtss_f32(v); }
+    __attribute__((target("avx2"))) static V permute(V v, __m256i idx) { return _mm256_permutevar8x32_ps(v, idx); }
+    __attribute__((target("avx2"))) static V blend_first(V v, V first) { return _mm256_blend_ps(v, first, 1); }
+    __attribute__((target("avx2"))) static V prefix(V x) {
+        x = _mm256_add_ps(x, _mm256_castsi256_ps(_mm256_slli_si256(_mm256_castps_si256(x), 4)));
+        x = _mm256_add_ps(x, _mm256_castsi256_ps(_mm256_slli_si256(_mm256_castps_si256(x), 8)));
+        V low_total = _mm256_permute_ps(x, 0xFF);
+        return _mm256_add_ps(x, _mm256_permute2f128_ps(low_total, low_total, 0x08));
+    }
+};
+
+// Same contract as scan_scalar
+template<bool EXCLUSIVE, typename T>
+__attribute__((target("avx2")))
+T scan_avx2(const T* in, T* out, size_t n, T carry) {
+    using L = ScanLanes<T>;
+    const __m256i last = _mm256_set1_epi32(7);
+    const __m256i rotate = _mm256_setr_epi32(7, 0, 1, 2, 3, 4, 5, 6);
+    typename L::V c = L::broadcast(carry);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        typename L::V s = L::add(L::prefix(L::load(in + i)), c);
+        if (EXCLUSIVE) {
+            // Shift the inclusive sums up one lane, the previous carry enters lane 0
+            L::store(out + i, L::blend_first(L::permute(s, rotate), c));
+        } else {
+            L::store(out + i, s);
+        }
+        c = L::permute(s, last);
+    }
+    return scan_scalar<EXCLUSIVE>(in + i, out + i, n - i, L::first(c));
+}
+#endif
+
+template<bool EXCLUSIVE, typename T>
+T scan(const T* in, T* out, size_t n, T carry) {
+#if defined(__x86_64__)
+    if constexpr (SimdScan<T>::value) {
+        if (isa_supported(IsaLevel::AVX2)) {
+            return scan_avx2<EXCLUSIVE>(in, out, n, carry);
+        }
+    }
+#endif
+    return scan_scalar<EXCLUSIVE>(in, out, n, carry);
+}
+
+template<bool EXCLUSIVE, typename T>
+void scan_parallel(const T* in, T* out, size_t n, T init, int threads) {
+    const int chunks = chunk_count(n, threads);
+    std::vector<T> offset(chunks, T());
+    if (chunks > 1) {
+        for_chunks(n, chunks, [&](int c, size_t begin, size_t end) {
+            T sum = T();
+            for (size_t i = begin; i < end; ++i) {
+                sum += in[i];
+            }
+            offset[c] = sum;
+        });
+    }
+    // Chunk c starts from init plus the totals of the chunks before it
+    scan_scalar<true>(offset.data(), offset.data(), offset.size(), init);
+    for_chunks(n, chunks, [&](int c, size_t begin, size_t end) {
+        scan<EXCLUSIVE>(in + begin, out + begin, end - begin, offset[c]);
+    });
+}
+
+template<typename T, typename Pred>
+size_t count_if(const T* in, size_t begin, size_t end, Pred pred) {
+    size_t count = 0;
+    for (size_t i = begin; i < end; ++i) {
+        count += pred(in[i]) ? 1 : 0;
+    }
+    return count;
+}
+
+// Stable split of [begin, end): selected elements to out[t], out[t + 1], ...,
+// the others to out[f], out[f + 1], ... The slot is picked with a mask (a
+// ternary here tends to compile into a branch on the predicate, which
+// mispredicts half the time on mixed data).
+template<typename T, typename Pred>
+void partition_range(const T* in, size_t begin, size_t end, T* out, size_t t, size_t f, Pred pred) {
+    size_t kept = 0;
+    for (size_t i = begin; i < end; ++i) {
+        const T x = in[i];
+        const size_t p = pred(x) ? 1 : 0;
+        const size_t mask = 0 - p;
+        out[((t + kept) & mask) | ((f + (i - begin - kept)) & ~mask)] = x;
+        kept += p;
+    }
+}
+
+// Selected elements from in[begin] on into out, given that `count` of them
+// pass: every element is stored at the next free slot and the slot advances
+// only if it passes; stopping at the last one that passes keeps the stores
+// inside out[0, count)
+template<typename T, typename Pred>
+void compact_range(const T* in, size_t begin, size_t count, T* out, Pred pred) {
+    size_t kept = 0;
+    for (size_t i = begin; kept < count; ++i) {
+        const T x = in[i];
+        out[kept] = x;
+        kept += pred(x);
+    }
+}
+
+// Two-pass stable partition (keep_false: the others follow the selected
+// elements) or compaction: count per chunk, then write every chunk from its
+// offsets
+template<typename T, typename Pred>
+size_t split_parallel(const T* in, size_t n, T* out, bool keep_false, Pred pred, int threads) {
+    const int chunks = chunk_count(n, threads);
+    std::vector<size_t> kept(chunks);
+    for_chunks(n, chunks, [&](int c, size_t begin, size_t end) { kept[c] = count_if(in, begin, end, pred); });
+    std::vector<size_t> first(chunks);
+    const size_t total = scan_scalar<true>(kept.data(), first.data(), kept.size(), size_t(0));
+    for_chunks(n, chunks, [&](int c, size_t begin, size_t end) {
+        if (keep_false) {
+            partition_range(in, begin, end, out, first[c], total + (begin - first[c]), pred);
+        } else {
+            compact_range(in, begin, kept[c], out + first[c], pred);
+        }
+    });
+    return total;
+}
+
+// Counts are kept in 32 bits, flushed into counts every FLUSH elements
+template<typename T, typename BinFn>
+void histogram_range(const T* keys, size_t begin, size_t end, size_t bins, BinFn bin, size_t* counts) {
+    const size_t S = SUB_HISTOGRAMS;
+    const size_t FLUSH = size_t(1) << 31;
+    std::vector<uint32_t> storage(S * bins);
+    uint32_t* sub = storage.data();
+    while (begin < end) {
+        const size_t stop = std::min(end, begin + FLUSH);
+        std::fill(sub, sub + S * bins, 0u);
+        size_t i = begin;
+        for (; i + S <= stop; i += S) {
+#pragma GCC unroll 4
+            for (size_t s = 0; s < S; ++s) {
+                sub[s * bins + bin(keys[i + s])]++;
+            }
+        }
+        for (; i < stop; ++i) {
+            sub[bin(keys[i])]++;
+        }
+        for (size_t s = 0; s < S; ++s) {
+            for (size_t b = 0; b < bins; ++b) {
+                counts[b] += sub[s * bins + b];
+            }
+        }
+        begin = stop;
+    }
+}
+
+} // namespace prim_detail
+
+// out[i] = in[0] + ... + in[i]; out may equal in
+template<typename T>
+void scan_inclusive(const T* in, T* out, size_t n) {
+    prim_detail::scan<false>(in, out, n, T());
+}
+
+// out[i] = init + in[0] + ... + in[i - 1]; out may equal in
+template<typename T>
+void scan_exclusive(const T* in, T* out, size_t n, T init = T()) {
+    prim_detail::scan<true>(in, out, n, init);
+}
+
+// Float sums are associated per chunk, so results may differ from the
+// sequential scan in the last bits
+template<typename T>
+void scan_inclusive_parallel(const T* in, T* out, size_t n, int threads) {
+    prim_detail::scan_parallel<false>(in, out, n, T(), threads);
+}
+
+template<typename T>
+void scan_exclusive_parallel(const T* in, T* out, size_t n, int threads, T init = T()) {
+    prim_detail::scan_parallel<true>(in, out, n, init, threads);
+}
+
+// Elements satisfying pred first, then the others, both in input order, into
+// out (n elements, must not overlap in). Returns the number satisfying pred.
+template<typename T, typename Pred>
+size_t partition_stable(const T* in, size_t n, T* out, Pred pred) {
+    return prim_detail::split_parallel(in, n, out, true, pred, 1);
+}
+
+template<typename T, typename Pred>
+size_t partition_stable_parallel(const T* in, size_t n, T* out, Pred pred, int threads) {
+    return prim_detail::split_parallel(in, n, out, true, pred, threads);
+}
+
+// copy_if: elements satisfying pred, in order, into out (room for all that
+// pass, must not overlap in). Returns how many were written.
+template<typename T, typename Pred>
+size_t compact(const T* in, size_t n, T* out, Pred pred) {
+    return prim_detail::split_parallel(in, n, out, false, pred, 1);
+}
+
+template<typename T, typename Pred>
+size_t compact_parallel(const T* in, size_t n, T* out, Pred pred, int threads) {
+    return prim_detail::split_parallel(in, n, out, false, pred, threads);
+}
+
+// counts[b] = number of keys with bin(key) == b, for bin(key) < bins
+template<typename T, typename BinFn>
+std::vector<size_t> histogram(const T* keys, size_t n, size_t bins, BinFn bin) {
+    std::vector<size_t> counts(bins, 0);
+    prim_detail::histogram_range(keys, 0, n, bins, bin, counts.data());
+    return counts;
+}
+
+// Private histogram per thread, summed at the end
+template<typename T, typename BinFn>
+std::vector<size_t> histogram_parallel(const T* keys, size_t n, size_t bins, BinFn bin, int threads) {
+    const int chunks = prim_detail::chunk_count(n, threads);
+    std::vector<std::vector<size_t>> partial(chunks, std::vector<size_t>(bins, 0));
+    prim_detail::for_chunks(n, chunks, [&](int c, size_t begin, size_t end) {
+        prim_detail::histogram_range(keys, begin, end, bins, bin, partial[c].data());
+    });
+    std::vector<size_t> counts(bins, 0);
+    for (const auto& p : partial) {
+        for (size_t b = 0; b < bins; ++b) {
+            counts[b] += p[b];
+        }
+    }
+    return counts;
+}
@@ -0,0 +1,190 @@
+/*
+ * Bounded Pipeline
+ * Three-stage loader -> transform -> consumer pipeline over bounded queues, so
+ * loading chunk k+1 overlaps processing of chunk k. The queue depth bounds the
+ * number of chunks in flight (backpressure) and every stage reports how long
+ * it was busy, starved for input and blocked on a full output queue.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+
+// Blocking FIFO with a fixed capacity; producers wait while it is full
+template<typename T>
+class BoundedQueue {
+private:
+    std::deque<T> items;
+    size_t capacity;
+    bool closed;
+    std::mutex mutex;
+    std::condition_variable not_full;
+    std::condition_variable not_empty;
+
+public:
+    explicit BoundedQueue(size_t queue_capacity) : capacity(queue_capacity), closed(false) {}
+
+    // Returns the seconds spent waiting for space
+    double push(T item) {
+        auto start = std::chrono::steady_clock::now();
+        std::unique_lock<std::mutex> lock(mutex);
+        not_full.wait(lock, [this] { return items.size() < capacity; });
+        double waited = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        items.push_back(std::move(item));
+        lock.unlock();
+        not_empty.notify_one();
+        return waited;
+    }
+
+    // Returns false once the queue is closed and drained; adds wait time to `waited`
+    bool pop(T& out, double& waited) {
+        auto start = std::chrono::steady_clock::now();
+        std::unique_lock<std::mutex> lock(mutex);
+        not_empty.wait(lock, [this] { return closed || !items.empty(); });
+        waited += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (items.empty()) {
+            return false;
+        }
+        out = std::move(items.front());
+        items.pop_front();
+        lock.unlock();
+        not_full.notify_one();
+        return true;
+    }
+
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            closed = true;
+        }
+        not_empty.notify_all();
+    }
+};
+
+struct StageStats {
+    std::string name;
+    double busy_s = 0;      // running the stage function
+    double starved_s = 0;   // waiting for input
+    double blocked_s = 0;   // waiting for space downstream (backpressure)
+    size_t items = 0;
+};
+
+struct PipelineStats {
+    double wall_s = 0;
+    size_t depth = 0;
+    StageStats stages[3] = {{"loader"}, {"transform"}, {"consumer"}};
+
+    void print() const {
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(3);
+        out << "     " << std::left << std::setw(11) << "stage" << std::right
+            << std::setw(8) << "items" << std::setw(10) << "busy(s)" << std::setw(12) << "starved(s)"
+            << std::setw(12) << "blocked(s)" << std::setw(8) << "util" << "\n";
+        for (const auto& s : stages) {
+            out << "     " << std::left << std::setw(11) << s.name << std::right
+                << std::setw(8) << s.items << std::setw(10) << s.busy_s
+                << std::setw(12) << s.starved_s << std::setw(12) << s.blocked_s
+                << std::setw(7) << std::setprecision(1)
+                << (wall_s > 0 ? 100.0 * s.busy_s / wall_s : 0.0) << "%"
+                << std::setprecision(3) << "\n";
+        }
+        std::cout << out.str();
+    }
+};
+
+// Runs load -> transform -> consume. `load` fills a chunk and returns false
+// when the input is exhausted. depth is the capacity of each inter-stage
+// queue; depth 0 runs the stages back to back on the calling thread (the
+// sequential baseline).
+template<typename Raw, typename Processed>
+PipelineStats run_pipeline(size_t depth,
+                           const std::function<bool(Raw&)>& load,
+                           const std::function<Processed(Raw&)>& transform,
+                           const std::function<void(Processed&)>& consume) {
+    using clock = std::chrono::steady_clock;
+    auto seconds_since = [](clock::time_point t) {
+        return std::chrono::duration<double>(clock::now() - t).count();
+    };
+
+    PipelineStats stats;
+    stats.depth = depth;
+    StageStats& loader = stats.stages[0];
+    StageStats& transformer = stats.stages[1];
+    StageStats& consumer = stats.stages[2];
+    auto start = clock::now();
+
+    if (depth == 0) {
+        while (true) {
+            Raw raw;
+            auto t = clock::now();
+            bool more = load(raw);
+            loader.busy_s += seconds_since(t);
+            if (!more) {
+                break;
+            }
+            loader.items++;
+            t = clock::now();
+            Processed processed = transform(raw);
+            transformer.busy_s += seconds_since(t);
+            transformer.items++;
+            t = clock::now();
+            consume(processed);
+            consumer.busy_s += seconds_since(t);
+            consumer.items++;
+        }
+        stats.wall_s = seconds_since(start);
+        return stats;
+    }
+
+    BoundedQueue<Raw> loaded(depth);
+    BoundedQueue<Processed> transformed(depth);
+
+    std::thread load_thread([&]() {
+        while (true) {
+            Raw raw;
+            auto t = clock::now();
+            bool more = load(raw);
+            loader.busy_s += seconds_since(t);
+            if (!more) {
+                break;
+            }
+            loader.items++;
+            loader.blocked_s += loaded.push(std::move(raw));
+        }
+        loaded.close();
+    });
+
+    std::thread transform_thread([&]() {
+        Raw raw;
+        while (loaded.pop(raw, transformer.starved_s)) {
+            auto t = clock::now();
+            Processed processed = transform(raw);
+            transformer.busy_s += seconds_since(t);
+            transformer.items++;
+            transformer.blocked_s += transformed.push(std::move(processed));
+        }
+        transformed.close();
+    });
+
+    Processed processed;
+    while (transformed.pop(processed, consumer.starved_s)) {
+        auto t = clock::now();
+        consume(processed);
+        consumer.busy_s += seconds_since(t);
+        consumer.items++;
+    }
+
+    load_thread.join();
+    transform_thread.join();
+    stats.wall_s = seconds_since(start);
+    return stats;
+}
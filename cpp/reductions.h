@@ -0,0 +1,491 @@
+/*
+ * Reductions
+ * Sum, dot product, Euclidean norm, min/max/argmax and strided/indexed sums
+ * over contiguous arrays. A single scalar accumulator serializes every add
+ * behind the previous one (and, for floating point, the compiler may not
+ * reorder it into SIMD lanes), so the kernels keep several independent
+ * accumulators: four AVX2 registers for float/double/int (runtime dispatched),
+ * four scalars otherwise. reduce_sum_pairwise trades a little speed for
+ * O(log n) rounding error growth, reduce_norm2 rescales when the plain sum of
+ * squares would overflow or underflow, and the *_parallel versions combine
+ * per-thread partial results.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#include "cpu_dispatch.h"
+
+namespace reduce_detail {
+
+// Accumulator type per element type: ints are summed in 64 bits
+template<typename T> struct Accumulator { using type = T; };
+template<> struct Accumulator<int> { using type = long long; };
+
+// Elements summed directly before pairwise summation splits further
+const size_t PAIRWISE_BLOCK = 256;
+
+template<typename T, typename Acc = typename Accumulator<T>::type>
+Acc sum_scalar(const T* x, size_t n) {
+    Acc s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        s0 += x[i];
+        s1 += x[i + 1];
+        s2 += x[i + 2];
+        s3 += x[i + 3];
+    }
+    for (; i < n; ++i) {
+        s0 += x[i];
+    }
+    return (s0 + s1) + (s2 + s3);
+}
+
+// Sum of (x[i] * scale) * (y[i] * scale); scale = 1 is the plain dot product
+template<typename T>
+T dot_scalar(const T* x, const T* y, size_t n, T scale) {
+    T s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        s0 += (x[i] * scale) * (y[i] * scale);
+        s1 += (x[i + 1] * scale) * (y[i + 1] * scale);
+        s2 += (x[i + 2] * scale) * (y[i + 2] * scale);
+        s3 += (x[i + 3] * scale) * (y[i + 3] * scale);
+    }
+    for (; i < n; ++i) {
+        s0 += (x[i] * scale) * (y[i] * scale);
+    }
+    return (s0 + s1) + (s2 + s3);
+}
+
+template<typename T>
+T max_abs_scalar(const T* x, size_t n) {
+    T m = 0;
+    for (size_t i = 0; i < n; ++i) {
+        m = std::max(m, std::abs(x[i]));
+    }
+    return m;
+}
+
+// Min (want_max = false) or max over n > 0 elements
+template<typename T>
+T extreme_scalar(const T* x, size_t n, bool want_max) {
+    T m0 = x[0], m1 = x[0], m2 = x[0], m3 = x[0];
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        if (want_max) {
+            m0 = std::max(m0, x[i]); m1 = std::max(m1, x[i + 1]);
+            m2 = std::max(m2, x[i + 2]); m3 = std::max(m3, x[i + 3]);
+        } else {
+            m0 = std::min(m0, x[i]); m1 = std::min(m1, x[i + 1]);
+            m2 = std::min(m2, x[i + 2]); m3 = std::min(m3, x[i + 3]);
+        }
+    }
+    for (; i < n; ++i) {
+        m0 = want_max ? std::max(m0, x[i]) : std::min(m0, x[i]);
+    }
+    return want_max ? std::max(std::max(m0, m1), std::max(m2, m3))
+                    : std::min(std::min(m0, m1), std::min(m2, m3));
+}
+
+#if defined(__x86_64__)
+__attribute__((target("avx2,fma")))
+inline float hsum(__m256 v) {
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_movehdup_ps(s));
+    return _mm_cvtss_f32(s);
+}
+
+__attribute__((target("avx2,fma")))
+inline double hsum(__m256d v) {
+    __m128d s = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+    s = _mm_add_sd(s, _mm_unpackhi_pd(s, s));
+    return _mm_cvtsd_f64(s);
+}
+
+__attribute__((target("avx2,fma")))
+inline float sum_avx2(const float* x, size_t n) {
+    __m256 a0 = _mm256_setzero_ps(), a1 = a0, a2 = a0, a3 = a0;
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        a0 = _mm256_add_ps(a0, _mm256_loadu_ps(x + i));
+        a1 = _mm256_add_ps(a1, _mm256_loadu_ps(x + i + 8));
+        a2 = _mm256_add_ps(a2, _mm256_loadu_ps(x + i + 16));
+        a3 = _mm256_add_ps(a3, _mm256_loadu_ps(x + i + 24));
+    }
+    float s = hsum(_mm256_add_ps(_mm256_add_ps(a0, a1), _mm256_add_ps(a2, a3)));
+    return s + sum_scalar(x + i, n - i);
+}
+
+__attribute__((target("avx2,fma")))
+inline double sum_avx2(const double* x, size_t n) {
+    __m256d a0 = _mm256_setzero_pd(), a1 = a0, a2 = a0, a3 = a0;
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        a0 = _mm256_add_pd(a0, _mm256_loadu_pd(x + i));
+        a1 = _mm256_add_pd(a1, _mm256_loadu_pd(x + i + 4));
+        a2 = _mm256_add_pd(a2, _mm256_loadu_pd(x + i + 8));
+        a3 = _mm256_add_pd(a3, _mm256_loadu_pd(x + i + 12));
+    }
+    double s = hsum(_mm256_add_pd(_mm256_add_pd(a0, a1), _mm256_add_pd(a2, a3)));
+    return s + sum_scalar(x + i, n - i);
+}
+
+// int32 elements widened to four int64 lanes per accumulator
+__attribute__((target("avx2,fma")))
+inline long long sum_avx2(const int* x, size_t n) {
+    __m256i a0 = _mm256_setzero_si256(), a1 = a0, a2 = a0, a3 = a0;
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i v0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + i));
+        __m256i v1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + i + 8));
+        a0 = _mm256_add_epi64(a0, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(v0)));
+        a1 = _mm256_add_epi64(a1, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(v0, 1)));
+        a2 = _mm256_add_epi64(a2, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(v1)));
+        a3 = _mm256_add_epi64(a3, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(v1, 1)));
+    }
+    alignas(32) long long lanes[4];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes),
+                       _mm256_add_epi64(_mm256_add_epi64(a0, a1), _mm256_add_epi64(a2, a3)));
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + sum_scalar(x + i, n - i);
+}
+
+__attribute__((target("avx2,fma")))
+inline float dot_avx2(const float* x, const float* y, size_t n, float scale) {
+    const __m256 s = _mm256_set1_ps(scale);
+    const bool scaled = scale != 1;
+    __m256 a[4] = {_mm256_setzero_ps(), _mm256_setzero_ps(), _mm256_setzero_ps(), _mm256_setzero_ps()};
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        for (int u = 0; u < 4; ++u) {
+            __m256 xv = _mm256_loadu_ps(x + i + 8 * u);
+            __m256 yv = _mm256_loadu_ps(y + i + 8 * u);
+            if (scaled) {
+                xv = _mm256_mul_ps(xv, s);
+                yv = _mm256_mul_ps(yv, s);
+            }
+            a[u] = _mm256_fmadd_ps(xv, yv, a[u]);
+        }
+    }
+    float r = hsum(_mm256_add_ps(_mm256_add_ps(a[0], a[1]), _mm256_add_ps(a[2], a[3])));
+    return r + dot_scalar(x + i, y + i, n - i, scale);
+}
+
+__attribute__((target("avx2,fma")))
+inline double dot_avx2(const double* x, const double* y, size_t n, double scale) {
+    const __m256d s = _mm256_set1_pd(scale);
+    const bool scaled = scale != 1;
+    __m256d a[4] = {_mm256_setzero_pd(), _mm256_setzero_pd(), _mm256_setzero_pd(), _mm256_setzero_pd()};
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        for (int u = 0; u < 4; ++u) {
+            __m256d xv = _mm256_loadu_pd(x + i + 4 * u);
+            __m256d yv = _mm256_loadu_pd(y + i + 4 * u);
+            if (scaled) {
+                xv = _mm256_mul_pd(xv, s);
+                yv = _mm256_mul_pd(yv, s);
+            }
+            a[u] = _mm256_fmadd_pd(xv, yv, a[u]);
+        }
+    }
+    double r = hsum(_mm256_add_pd(_mm256_add_pd(a[0], a[1]), _mm256_add_pd(a[2], a[3])));
+    return r + dot_scalar(x + i, y + i, n - i, scale);
+}
+
+__attribute__((target("avx2,fma")))
+inline float max_abs_avx2(const float* x, size_t n) {
+    const __m256 sign = _mm256_set1_ps(-0.0f);
+    __m256 m0 = _mm256_setzero_ps(), m1 = m0;
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        m0 = _mm256_max_ps(m0, _mm256_andnot_ps(sign, _mm256_loadu_ps(x + i)));
+        m1 = _mm256_max_ps(m1, _mm256_andnot_ps(sign, _mm256_loadu_ps(x + i + 8)));
+    }
+    alignas(32) float lanes[8];
+    _mm256_store_ps(lanes, _mm256_max_ps(m0, m1));
+    return std::max(*std::max_element(lanes, lanes + 8), max_abs_scalar(x + i, n - i));
+}
+
+__attribute__((target("avx2,fma")))
+inline double max_abs_avx2(const double* x, size_t n) {
+    const __m256d sign = _mm256_set1_pd(-0.0);
+    __m256d m0 = _mm256_setzero_pd(), m1 = m0;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        m0 = _mm256_max_pd(m0, _mm256_andnot_pd(sign, _mm256_loadu_pd(x + i)));
+        m1 = _mm256_max_pd(m1, _mm256_andnot_pd(sign, _mm256_loadu_pd(x + i + 4)));
+    }
+    alignas(32) double lanes[4];
+    _mm256_store_pd(lanes, _mm256_max_pd(m0, m1));
+    return std::max(*std::max_element(lanes, lanes + 4), max_abs_scalar(x + i, n - i));
+}
+
+__attribute__((target("avx2,fma")))
+inline float extreme_avx2(const float* x, size_t n, bool want_max) {
+    if (n < 16) {
+        return extreme_scalar(x, n, want_max);
+    }
+    __m256 m0 = _mm256_loadu_ps(x), m1 = _mm256_loadu_ps(x + 8);
+    size_t i = 16;
+    for (; i + 16 <= n; i += 16) {
+        __m256 v0 = _mm256_loadu_ps(x + i), v1 = _mm256_loadu_ps(x + i + 8);
+        m0 = want_max ? _mm256_max_ps(m0, v0) : _mm256_min_ps(m0, v0);
+        m1 = want_max ? _mm256_max_ps(m1, v1) : _mm256_min_ps(m1, v1);
+    }
+    alignas(32) float lanes[8];
+    _mm256_store_ps(lanes, want_max ? _mm256_max_ps(m0, m1) : _mm256_min_ps(m0, m1));
+    float m = want_max ? *std::max_element(lanes, lanes + 8) : *std::min_element(lanes, lanes + 8);
+    for (; i < n; ++i) {
+        m = want_max ? std::max(m, x[i]) : std::min(m, x[i]);
+    }
+    return m;
+}
+
+__attribute__((target("avx2,fma")))
+inline double extreme_avx2(const double* x, size_t n, bool want_max) {
+    if (n < 8) {
+        return extreme_scalar(x, n, want_max);
+    }
+    __m256d m0 = _mm256_loadu_pd(x), m1 = _mm256_loadu_pd(x + 4);
+    size_t i = 8;
+    for (; i + 8 <= n; i += 8) {
+        __m256d v0 = _mm256_loadu_pd(x + i), v1 = _mm256_loadu_pd(x + i + 4);
+        m0 = want_max ? _mm256_max_pd(m0, v0) : _mm256_min_pd(m0, v0);
+        m1 = want_max ? _mm256_max_pd(m1, v1) : _mm256_min_pd(m1, v1);
+    }
+    alignas(32) double lanes[4];
+    _mm256_store_pd(lanes, want_max ? _mm256_max_pd(m0, m1) : _mm256_min_pd(m0, m1));
+    double m = want_max ? *std::max_element(lanes, lanes + 4) : *std::min_element(lanes, lanes + 4);
+    for (; i < n; ++i) {
+        m = want_max ? std::max(m, x[i]) : std::min(m, x[i]);
+    }
+    return m;
+}
+#endif
+
+// Element types with AVX2 kernels
+template<typename T>
+constexpr bool has_simd() {
+    return std::is_same<T, float>::value || std::is_same<T, double>::value || std::is_same<T, int>::value;
+}
+
+template<typename T>
+constexpr bool has_simd_fp() {
+    return std::is_same<T, float>::value || std::is_same<T, double>::value;
+}
+
+inline bool use_avx2() {
+    return isa_supported(IsaLevel::AVX2);
+}
+
+template<typename T>
+typename Accumulator<T>::type sum(const T* x, size_t n) {
+#if defined(__x86_64__)
+    if constexpr (has_simd<T>()) {
+        if (use_avx2()) {
+            return sum_avx2(x, n);
+        }
+    }
+#endif
+    return sum_scalar(x, n);
+}
+
+template<typename T>
+T dot(const T* x, const T* y, size_t n, T scale) {
+#if defined(__x86_64__)
+    if constexpr (has_simd_fp<T>()) {
+        if (use_avx2()) {
+            return dot_avx2(x, y, n, scale);
+        }
+    }
+#endif
+    return dot_scalar(x, y, n, scale);
+}
+
+template<typename T>
+T max_abs(const T* x, size_t n) {
+#if defined(__x86_64__)
+    if constexpr (has_simd_fp<T>()) {
+        if (use_avx2()) {
+            return max_abs_avx2(x, n);
+        }
+    }
+#endif
+    return max_abs_scalar(x, n);
+}
+
+template<typename T>
+T extreme(const T* x, size_t n, bool want_max) {
+#if defined(__x86_64__)
+    if constexpr (has_simd_fp<T>()) {
+        if (use_avx2()) {
+            return extreme_avx2(x, n, want_max);
+        }
+    }
+#endif
+    return extreme_scalar(x, n, want_max);
+}
+
+// Norm from a sum of squares, rescaling by the largest magnitude when the sum
+// overflowed or fell into the range where squares lose precision
+template<typename T, typename SumSq, typename MaxAbs, typename ScaledSumSq>
+T safe_norm2(SumSq sum_sq, MaxAbs max_abs_fn, ScaledSumSq scaled_sum_sq) {
+    const T tiny = std::numeric_limits<T>::min() / std::numeric_limits<T>::epsilon();
+    T ss = sum_sq();
+    if (std::isfinite(ss) && ss >= tiny) {
+        return std::sqrt(ss);
+    }
+    T m = max_abs_fn();
+    if (m == 0 || !std::isfinite(m)) {
+        return m;
+    }
+    return m * std::sqrt(scaled_sum_sq(1 / m));
+}
+
+// Runs fn(begin, end) on `threads` contiguous chunks and returns the partials
+template<typename R, typename Fn>
+std::vector<R> parallel_partials(size_t n, int threads, Fn fn) {
+    threads = std::max(1, std::min<int>(threads, static_cast<int>(n / PAIRWISE_BLOCK) + 1));
+    std::vector<R> partials(threads);
+    std::vector<std::thread> workers;
+    for (int t = 1; t < threads; ++t) {
+        workers.emplace_back([&, t]() { partials[t] = fn(n * t / threads, n * (t + 1) / threads); });
+    }
+    partials[0] = fn(0, n / threads);
+    for (auto& w : workers) {
+        w.join();
+    }
+    return partials;
+}
+
+} // namespace reduce_detail
+
+template<typename T>
+typename reduce_detail::Accumulator<T>::type reduce_sum(const T* x, size_t n) {
+    return reduce_detail::sum(x, n);
+}
+
+// Pairwise (cascade) summation over PAIRWISE_BLOCK-sized leaves: rounding error
+// grows with log(n) instead of n, at close to the speed of reduce_sum
+template<typename T>
+typename reduce_detail::Accumulator<T>::type reduce_sum_pairwise(const T* x, size_t n) {
+    using namespace reduce_detail;
+    if (n <= PAIRWISE_BLOCK) {
+        return sum(x, n);
+    }
+    size_t half = (n / 2 + PAIRWISE_BLOCK - 1) / PAIRWISE_BLOCK * PAIRWISE_BLOCK;
+    return reduce_sum_pairwise(x, half) + reduce_sum_pairwise(x + half, n - half);
+}
+
+// Sum of x[0], x[stride], ..., n elements; independent accumulators keep
+// several cache misses in flight
+template<typename T>
+typename reduce_detail::Accumulator<T>::type reduce_sum_strided(const T* x, size_t n, size_t stride) {
+    typename reduce_detail::Accumulator<T>::type s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        s0 += x[i * stride];
+        s1 += x[(i + 1) * stride];
+        s2 += x[(i + 2) * stride];
+        s3 += x[(i + 3) * stride];
+    }
+    for (; i < n; ++i) {
+        s0 += x[i * stride];
+    }
+    return (s0 + s1) + (s2 + s3);
+}
+
+// Sum of x[index[0]], ..., x[index[n-1]]
+template<typename T, typename Index>
+typename reduce_detail::Accumulator<T>::type reduce_sum_indexed(const T* x, const Index* index, size_t n) {
+    typename reduce_detail::Accumulator<T>::type s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        s0 += x[index[i]];
+        s1 += x[index[i + 1]];
+        s2 += x[index[i + 2]];
+        s3 += x[index[i + 3]];
+    }
+    for (; i < n; ++i) {
+        s0 += x[index[i]];
+    }
+    return (s0 + s1) + (s2 + s3);
+}
+
+template<typename T>
+T reduce_dot(const T* x, const T* y, size_t n) {
+    return reduce_detail::dot(x, y, n, T(1));
+}
+
+// Euclidean norm; safe for magnitudes whose squares over- or underflow
+template<typename T>
+T reduce_norm2(const T* x, size_t n) {
+    using namespace reduce_detail;
+    return safe_norm2<T>([&]() { return dot(x, x, n, T(1)); },
+                         [&]() { return max_abs(x, n); },
+                         [&](T scale) { return dot(x, x, n, scale); });
+}
+
+// Min / max / index of the first maximum of n > 0 elements
+template<typename T>
+T reduce_min(const T* x, size_t n) {
+    return reduce_detail::extreme(x, n, false);
+}
+
+template<typename T>
+T reduce_max(const T* x, size_t n) {
+    return reduce_detail::extreme(x, n, true);
+}
+
+// Max pass, then a find pass: both stream at full SIMD width, unlike a
+// single loop carrying (value, index) through a compare-and-branch
+template<typename T>
+size_t reduce_argmax(const T* x, size_t n) {
+    T m = reduce_max(x, n);
+    return static_cast<size_t>(std::find(x, x + n, m) - x);
+}
+
+template<typename T>
+typename reduce_detail::Accumulator<T>::type reduce_sum_parallel(const T* x, size_t n, int threads) {
+    using Acc = typename reduce_detail::Accumulator<T>::type;
+    auto partials = reduce_detail::parallel_partials<Acc>(n, threads, [&](size_t begin, size_t end) {
+        return reduce_sum_pairwise(x + begin, end - begin);
+    });
+    return reduce_sum_pairwise(partials.data(), partials.size());
+}
+
+template<typename T>
+T reduce_dot_parallel(const T* x, const T* y, size_t n, int threads) {
+    auto partials = reduce_detail::parallel_partials<T>(n, threads, [&](size_t begin, size_t end) {
+        return reduce_dot(x + begin, y + begin, end - begin);
+    });
+    return reduce_sum_pairwise(partials.data(), partials.size());
+}
+
+template<typename T>
+T reduce_norm2_parallel(const T* x, size_t n, int threads) {
+    using namespace reduce_detail;
+    auto combined = [&](auto partial) {
+        auto partials = parallel_partials<T>(n, threads, partial);
+        return reduce_sum_pairwise(partials.data(), partials.size());
+    };
+    return safe_norm2<T>(
+        [&]() { return combined([&](size_t b, size_t e) { return dot(x + b, x + b, e - b, T(1)); }); },
+        [&]() {
+            auto partials = parallel_partials<T>(n, threads, [&](size_t b, size_t e) { return max_abs(x + b, e - b); });
+            return *std::max_element(partials.begin(), partials.end());
+        },
+        [&](T scale) { return combined([&](size_t b, size_t e) { return dot(x + b, x + b, e - b, scale); }); });
+}
@@ -0,0 +1,117 @@
+/*
+ * Running Statistics
+ * Mean/variance accumulators that can be built in one pass over memory and
+ * merged across threads or chunks (Welford / Chan et al. pairwise update).
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+struct RunningStats {
+    double count = 0;
+    double mean = 0;
+    double m2 = 0;   // sum of squared deviations from the mean
+
+    // Classic Welford update for a single value
+    void push(double x) {
+        count += 1;
+        double delta = x - mean;
+        mean += delta / count;
+        m2 += delta * (x - mean);
+    }
+
+    // Chan et al. merge of two partial results
+    void merge(const RunningStats& other) {
+        if (other.count == 0) {
+            return;
+        }
+        if (count == 0) {
+            *this = other;
+            return;
+        }
+        double total = count + other.count;
+        double delta = other.mean - mean;
+        mean += delta * other.count / total;
+        m2 += other.m2 + delta * delta * count * other.count / total;
+        count = total;
+    }
+
+    double variance() const { return count > 0 ? m2 / count : 0; }
+    double stddev() const { return std::sqrt(variance()); }
+};
+
+// Statistics of a contiguous range. Works in L1-sized blocks: each block's
+// mean and squared deviations are computed while the block is cache-resident,
+// using four independent accumulators so the loops are not latency-bound,
+// then blocks are merged with the Chan update. Memory is read once.
+inline RunningStats compute_stats(const double* data, size_t n) {
+    const size_t block = 1024;
+    RunningStats stats;
+    for (size_t start = 0; start < n; start += block) {
+        size_t len = std::min(block, n - start);
+        const double* p = data + start;
+
+        double s[4] = {0, 0, 0, 0};
+        size_t i = 0;
+        for (; i + 4 <= len; i += 4) {
+            s[0] += p[i];
+            s[1] += p[i + 1];
+            s[2] += p[i + 2];
+            s[3] += p[i + 3];
+        }
+        for (; i < len; ++i) {
+            s[0] += p[i];
+        }
+        double block_mean = ((s[0] + s[1]) + (s[2] + s[3])) / len;
+
+        double m[4] = {0, 0, 0, 0};
+        i = 0;
+        for (; i + 4 <= len; i += 4) {
+            double d0 = p[i] - block_mean, d1 = p[i + 1] - block_mean;
+            double d2 = p[i + 2] - block_mean, d3 = p[i + 3] - block_mean;
+            m[0] += d0 * d0;
+            m[1] += d1 * d1;
+            m[2] += d2 * d2;
+            m[3] += d3 * d3;
+        }
+        for (; i < len; ++i) {
+            double d = p[i] - block_mean;
+            m[0] += d * d;
+        }
+
+        RunningStats partial;
+        partial.count = static_cast<double>(len);
+        partial.mean = block_mean;
+        partial.m2 = (m[0] + m[1]) + (m[2] + m[3]);
+        stats.merge(partial);
+    }
+    return stats;
+}
+
+// Parallel version: one contiguous slice per thread, partial results merged
+inline RunningStats compute_stats_parallel(const double* data, size_t n, int num_threads) {
+    num_threads = std::max(1, std::min<int>(num_threads, static_cast<int>(n / 4096) + 1));
+    std::vector<RunningStats> partials(num_threads);
+    std::vector<std::thread> workers;
+    for (int t = 1; t < num_threads; ++t) {
+        workers.emplace_back([&partials, data, n, num_threads, t]() {
+            size_t begin = n * t / num_threads, end = n * (t + 1) / num_threads;
+            partials[t] = compute_stats(data + begin, end - begin);
+        });
+    }
+    partials[0] = compute_stats(data, n / num_threads);
+    for (auto& w : workers) {
+        w.join();
+    }
+
+    RunningStats stats;
+    for (const auto& p : partials) {
+        stats.merge(p);
+    }
+    return stats;
+}
@@ -0,0 +1,261 @@
+/*
+ * Scheduler Accounting Helpers
+ * Splits the wall time of a profiled section into on-CPU, runnable-waiting and
+ * blocked time per thread, using /proc/self/task/<tid>/schedstat and
+ * getrusage(RUSAGE_THREAD), and reports context switch counts alongside.
+ */
+
+#pragma once
+
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <dirent.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Raw scheduler counters for one thread at one point in time
+struct SchedSample {
+    std::chrono::steady_clock::time_point wall;
+    uint64_t on_cpu_ns = 0;      // schedstat field 1: time spent running
+    uint64_t run_wait_ns = 0;    // schedstat field 2: time spent on a run queue
+    long voluntary_switches = 0;
+    long involuntary_switches = 0;
+    bool has_schedstat = false;
+};
+
+// Per-thread breakdown of a section's wall time
+struct ThreadSchedStats {
+    std::string name;
+    double wall_s = 0;
+    double on_cpu_s = 0;
+    double run_wait_s = 0;
+    double blocked_s = 0;
+    long voluntary_switches = 0;
+    long involuntary_switches = 0;
+};
+
+inline pid_t current_tid() {
+    return static_cast<pid_t>(syscall(SYS_gettid));
+}
+
+// Reads the first two fields of /proc/self/task/<tid>/schedstat
+inline bool read_schedstat(pid_t tid, uint64_t& on_cpu_ns, uint64_t& run_wait_ns) {
+    std::ifstream in("/proc/self/task/" + std::to_string(tid) + "/schedstat");
+    return static_cast<bool>(in >> on_cpu_ns >> run_wait_ns);
+}
+
+// Reads context switch counts from /proc/self/task/<tid>/status (for threads
+// other than the caller, where RUSAGE_THREAD is not available)
+inline void read_ctxt_switches(pid_t tid, long& voluntary, long& involuntary) {
+    std::ifstream in("/proc/self/task/" + std::to_string(tid) + "/status");
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.rfind("voluntary_ctxt_switches:", 0) == 0) {
+            voluntary = std::atol(line.c_str() + line.find(':') + 1);
+        } else if (line.rfind("nonvoluntary_ctxt_switches:", 0) == 0) {
+            involuntary = std::atol(line.c_str() + line.find(':') + 1);
+        }
+    }
+}
+
+// Samples the calling thread
+inline SchedSample sample_current_thread() {
+    SchedSample s;
+    s.wall = std::chrono::steady_clock::now();
+    s.has_schedstat = read_schedstat(current_tid(), s.on_cpu_ns, s.run_wait_ns);
+
+    rusage usage{};
+    if (getrusage(RUSAGE_THREAD, &usage) == 0) {
+        s.voluntary_switches = usage.ru_nvcsw;
+        s.involuntary_switches = usage.ru_nivcsw;
+        if (!s.has_schedstat) {
+            // Without schedstat we can still recover on-CPU time, but not run-queue waits
+            s.on_cpu_ns = (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000000ULL +
+                          (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1000ULL;
+        }
+    }
+    return s;
+}
+
+// Samples every thread of the process via /proc/self/task/*
+inline std::map<pid_t, SchedSample> sample_all_threads() {
+    std::map<pid_t, SchedSample> samples;
+    DIR* dir = opendir("/proc/self/task");
+    if (!dir) {
+        return samples;
+    }
+    auto now = std::chrono::steady_clock::now();
+    while (dirent* entry = readdir(dir)) {
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+        pid_t tid = static_cast<pid_t>(std::atoi(entry->d_name));
+        SchedSample s;
+        s.wall = now;
+        s.has_schedstat = read_schedstat(tid, s.on_cpu_ns, s.run_wait_ns);
+        read_ctxt_switches(tid, s.voluntary_switches, s.involuntary_switches);
+        samples[tid] = s;
+    }
+    closedir(dir);
+    return samples;
+}
+
+// Adds b's times and switch counts into a
+inline void add_sched_stats(ThreadSchedStats& a, const ThreadSchedStats& b) {
+    a.wall_s += b.wall_s;
+    a.on_cpu_s += b.on_cpu_s;
+    a.run_wait_s += b.run_wait_s;
+    a.blocked_s += b.blocked_s;
+    a.voluntary_switches += b.voluntary_switches;
+    a.involuntary_switches += b.involuntary_switches;
+}
+
+// Difference between two samples of the same thread
+inline ThreadSchedStats sched_delta(const std::string& name,
+                                    const SchedSample& begin, const SchedSample& end) {
+    ThreadSchedStats stats;
+    stats.name = name;
+    stats.wall_s = std::chrono::duration<double>(end.wall - begin.wall).count();
+    stats.on_cpu_s = (end.on_cpu_ns - begin.on_cpu_ns) / 1e9;
+    stats.run_wait_s = (end.run_wait_ns - begin.run_wait_ns) / 1e9;
+    stats.blocked_s = std::max(0.0, stats.wall_s - stats.on_cpu_s - stats.run_wait_s);
+    stats.voluntary_switches = end.voluntary_switches - begin.voluntary_switches;
+    stats.involuntary_switches = end.involuntary_switches - begin.involuntary_switches;
+    return stats;
+}
+
+// RAII section: samples the owning thread and all live threads on entry and
+// exit, collects the samples of worker threads that register a
+// ThreadSchedScope, and prints a per-thread breakdown when it goes out of scope.
+class SchedSection {
+private:
+    std::string name;
+    pid_t owner_tid;
+    SchedSample owner_start;
+    std::map<pid_t, SchedSample> tasks_start;
+    std::mutex threads_mutex;
+    std::vector<std::pair<pid_t, ThreadSchedStats>> scoped_threads;  // tids can repeat
+
+public:
+    SchedSection(const std::string& section_name)
+        : name(section_name), owner_tid(current_tid()) {
+        tasks_start = sample_all_threads();
+        owner_start = sample_current_thread();
+    }
+
+    void record(pid_t tid, const ThreadSchedStats& stats) {
+        std::lock_guard<std::mutex> lock(threads_mutex);
+        scoped_threads.emplace_back(tid, stats);
+    }
+
+    std::vector<ThreadSchedStats> collect() {
+        SchedSample owner_end = sample_current_thread();
+        std::vector<ThreadSchedStats> rows;
+        rows.push_back(sched_delta("main", owner_start, owner_end));
+
+        // Threads that were alive for the whole section but never registered
+        auto tasks_end = sample_all_threads();
+        std::lock_guard<std::mutex> lock(threads_mutex);
+        std::sort(scoped_threads.begin(), scoped_threads.end(),
+                  [](const auto& a, const auto& b) { return a.first < b.first; });
+        for (const auto& [tid, end] : tasks_end) {
+            auto begin = tasks_start.find(tid);
+            bool registered = std::any_of(scoped_threads.begin(), scoped_threads.end(),
+                                      [&](const auto& t) { return t.first == tid; });
+            if (tid == owner_tid || begin == tasks_start.end() || registered) {
+                continue;
+            }
+            rows.push_back(sched_delta("tid " + std::to_string(tid), begin->second, end));
+        }
+
+        // Short-lived threads that share a name (e.g. one per task) become one
+        // row, with the count appended
+        std::vector<ThreadSchedStats> scoped;
+        std::vector<int> counts;
+        for (const auto& [tid, stats] : scoped_threads) {
+            auto same = std::find_if(scoped.begin(), scoped.end(),
+                                     [&](const ThreadSchedStats& r) { return r.name == stats.name; });
+            if (same == scoped.end()) {
+                scoped.push_back(stats);
+                counts.push_back(1);
+            } else {
+                add_sched_stats(*same, stats);
+                ++counts[same - scoped.begin()];
+            }
+        }
+        for (size_t i = 0; i < scoped.size(); ++i) {
+            if (counts[i] > 1) {
+                scoped[i].name += " x" + std::to_string(counts[i]);
+            }
+            rows.push_back(scoped[i]);
+        }
+        return rows;
+    }
+
+    ~SchedSection() {
+        auto rows = collect();
+
+        // Thread-seconds and switches are summed; wall is the section's own
+        // (the main thread spans it), not the sum over threads
+        ThreadSchedStats total;
+        total.name = "total";
+        for (const auto& r : rows) {
+            add_sched_stats(total, r);
+        }
+        total.wall_s = rows.front().wall_s;
+
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(3);
+        out << "     Scheduler accounting (" << name << "):\n";
+        out << "       " << std::left << std::setw(14) << "thread" << std::right
+            << std::setw(10) << "wall(s)" << std::setw(11) << "on-cpu(s)"
+            << std::setw(13) << "runnable(s)" << std::setw(12) << "blocked(s)"
+            << std::setw(9) << "vol-cs" << std::setw(10) << "invol-cs" << "\n";
+        rows.push_back(total);
+        for (const auto& r : rows) {
+            out << "       " << std::left << std::setw(14) << r.name << std::right
+                << std::setw(10) << r.wall_s << std::setw(11) << r.on_cpu_s
+                << std::setw(13) << r.run_wait_s << std::setw(12) << r.blocked_s
+                << std::setw(9) << r.voluntary_switches
+                << std::setw(10) << r.involuntary_switches << "\n";
+        }
+        std::cout << out.str() << std::flush;
+    }
+
+    SchedSection(const SchedSection&) = delete;
+    SchedSection& operator=(const SchedSection&) = delete;
+};
+
+// RAII scope placed at the top of a worker thread body; reports the thread's
+// own deltas to the enclosing SchedSection when the body returns.
+class ThreadSchedScope {
+private:
+    SchedSection& section;
+    std::string name;
+    SchedSample start;
+
+public:
+    ThreadSchedScope(SchedSection& owner, const std::string& thread_name)
+        : section(owner), name(thread_name), start(sample_current_thread()) {}
+
+    ~ThreadSchedScope() {
+        section.record(current_tid(), sched_delta(name, start, sample_current_thread()));
+    }
+
+    ThreadSchedScope(const ThreadSchedScope&) = delete;
+    ThreadSchedScope& operator=(const ThreadSchedScope&) = delete;
+};
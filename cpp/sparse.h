@@ -0,0 +1,538 @@
+/*
+ * Sparse Matrices
+ * COO (triplets, for assembly), CSR, CSC and BSR (CSR over dense b x b
+ * blocks) storage with conversions from dense Matrix<T> and COO, SpMV
+ * (y = A x) and SpMM (Y = A X with X dense). Inner loops are AVX2 when the
+ * CPU allows it (gathered dot products for CSR rows, axpy over X rows for
+ * SpMM, one register per block column for BSR with 4x4 double / 8x8 float
+ * blocks). The parallel versions split rows so every thread gets about the
+ * same number of nonzeros, not the same number of rows.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#include "cpu_dispatch.h"
+#include "matrix.h"
+
+// Triplet list; duplicates are summed when converting
+template<typename T>
+struct CooMatrix {
+    size_t rows = 0, cols = 0;
+    std::vector<uint32_t> row, col;
+    std::vector<T> values;
+
+    CooMatrix(size_t r, size_t c) : rows(r), cols(c) {}
+
+    void add(size_t i, size_t j, T value) {
+        row.push_back(static_cast<uint32_t>(i));
+        col.push_back(static_cast<uint32_t>(j));
+        values.push_back(value);
+    }
+};
+
+// Column indices are 32-bit (half the index traffic of size_t) and are used
+// as signed gather offsets, so cols must stay below 2^31
+template<typename T>
+struct CsrMatrix {
+    size_t rows = 0, cols = 0;
+    std::vector<size_t> row_ptr;        // rows + 1 offsets into col_idx / values
+    std::vector<uint32_t> col_idx;      // sorted within each row
+    std::vector<T> values;
+
+    size_t nnz() const { return values.size(); }
+};
+
+template<typename T>
+struct CscMatrix {
+    size_t rows = 0, cols = 0;
+    std::vector<size_t> col_ptr;        // cols + 1 offsets into row_idx / values
+    std::vector<uint32_t> row_idx;      // sorted within each column
+    std::vector<T> values;
+
+    size_t nnz() const { return values.size(); }
+};
+
+// Rows and columns are padded up to whole blocks; each stored block is
+// block x block values, column-major, so one block column is contiguous
+template<typename T>
+struct BsrMatrix {
+    size_t rows = 0, cols = 0, block = 0;
+    size_t block_rows = 0, block_cols = 0;
+    std::vector<size_t> block_ptr;      // block_rows + 1 offsets into block_col
+    std::vector<uint32_t> block_col;
+    std::vector<T> values;              // block * block per stored block
+
+    size_t num_blocks() const { return block_col.size(); }
+    // Stored entries divided by true nonzeros: 1.0 means no explicit zeros
+    double fill_ratio(size_t nnz) const { return nnz ? double(values.size()) / nnz : 0; }
+};
+
+template<typename T>
+CsrMatrix<T> csr_from_dense(const Matrix<T>& a) {
+    CsrMatrix<T> csr;
+    csr.rows = a.num_rows();
+    csr.cols = a.num_cols();
+    csr.row_ptr.assign(1, 0);
+    for (size_t i = 0; i < csr.rows; ++i) {
+        const T* row = a.row(i);
+        for (size_t j = 0; j < csr.cols; ++j) {
+            if (row[j] != T(0)) {
+                csr.col_idx.push_back(static_cast<uint32_t>(j));
+                csr.values.push_back(row[j]);
+            }
+        }
+        csr.row_ptr.push_back(csr.values.size());
+    }
+    return csr;
+}
+
+template<typename T>
+CsrMatrix<T> csr_from_coo(const CooMatrix<T>& coo) {
+    std::vector<size_t> order(coo.values.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return coo.row[a] != coo.row[b] ? coo.row[a] < coo.row[b] : coo.col[a] < coo.col[b];
+    });
+
+    CsrMatrix<T> csr;
+    csr.rows = coo.rows;
+    csr.cols = coo.cols;
+    csr.row_ptr.assign(coo.rows + 1, 0);
+    for (size_t k = 0; k < order.size(); ++k) {
+        size_t e = order[k];
+        bool duplicate = k > 0 && coo.row[order[k - 1]] == coo.row[e] && coo.col[order[k - 1]] == coo.col[e];
+        if (duplicate) {
+            csr.values.back() += coo.values[e];
+            continue;
+        }
+        csr.col_idx.push_back(coo.col[e]);
+        csr.values.push_back(coo.values[e]);
+        ++csr.row_ptr[coo.row[e] + 1];
+    }
+    std::partial_sum(csr.row_ptr.begin(), csr.row_ptr.end(), csr.row_ptr.begin());
+    return csr;
+}
+
+// Counting transpose of the CSR structure
+template<typename T>
+CscMatrix<T> csc_from_csr(const CsrMatrix<T>& csr) {
+    CscMatrix<T> csc;
+    csc.rows = csr.rows;
+    csc.cols = csr.cols;
+    csc.col_ptr.assign(csr.cols + 1, 0);
+    for (uint32_t j : csr.col_idx) {
+        ++csc.col_ptr[j + 1];
+    }
+    std::partial_sum(csc.col_ptr.begin(), csc.col_ptr.end(), csc.col_ptr.begin());
+    csc.row_idx.resize(csr.nnz());
+    csc.values.resize(csr.nnz());
+    std::vector<size_t> next(csc.col_ptr.begin(), csc.col_ptr.end() - 1);
+    for (size_t i = 0; i < csr.rows; ++i) {
+        for (size_t k = csr.row_ptr[i]; k < csr.row_ptr[i + 1]; ++k) {
+            size_t dst = next[csr.col_idx[k]]++;
+            csc.row_idx[dst] = static_cast<uint32_t>(i);
+            csc.values[dst] = csr.values[k];
+        }
+    }
+    return csc;
+}
+
+template<typename T>
+CscMatrix<T> csc_from_dense(const Matrix<T>& a) {
+    return csc_from_csr(csr_from_dense(a));
+}
+
+template<typename T>
+BsrMatrix<T> bsr_from_csr(const CsrMatrix<T>& csr, size_t block) {
+    BsrMatrix<T> bsr;
+    bsr.rows = csr.rows;
+    bsr.cols = csr.cols;
+    bsr.block = block;
+    bsr.block_rows = (csr.rows + block - 1) / block;
+    bsr.block_cols = (csr.cols + block - 1) / block;
+    bsr.block_ptr.assign(1, 0);
+
+    // slot[bc]: index of block column bc in the current block row, or -1
+    std::vector<long> slot(bsr.block_cols, -1);
+    for (size_t br = 0; br < bsr.block_rows; ++br) {
+        size_t first = bsr.block_col.size();
+        size_t row_end = std::min(csr.rows, (br + 1) * block);
+        for (size_t i = br * block; i < row_end; ++i) {
+            for (size_t k = csr.row_ptr[i]; k < csr.row_ptr[i + 1]; ++k) {
+                size_t bc = csr.col_idx[k] / block;
+                if (slot[bc] < 0) {
+                    slot[bc] = static_cast<long>(bsr.block_col.size());
+                    bsr.block_col.push_back(static_cast<uint32_t>(bc));
+                }
+            }
+        }
+        std::sort(bsr.block_col.begin() + first, bsr.block_col.end());
+        for (size_t b = first; b < bsr.block_col.size(); ++b) {
+            slot[bsr.block_col[b]] = static_cast<long>(b);
+        }
+        bsr.values.resize(bsr.block_col.size() * block * block, T(0));
+        for (size_t i = br * block; i < row_end; ++i) {
+            for (size_t k = csr.row_ptr[i]; k < csr.row_ptr[i + 1]; ++k) {
+                size_t j = csr.col_idx[k];
+                T* values = &bsr.values[slot[j / block] * block * block];
+                values[(j % block) * block + (i % block)] = csr.values[k];
+            }
+        }
+        for (size_t b = first; b < bsr.block_col.size(); ++b) {
+            slot[bsr.block_col[b]] = -1;
+        }
+        bsr.block_ptr.push_back(bsr.block_col.size());
+    }
+    return bsr;
+}
+
+template<typename T>
+Matrix<T> csr_to_dense(const CsrMatrix<T>& csr) {
+    Matrix<T> a(csr.rows, csr.cols, T(0));
+    for (size_t i = 0; i < csr.rows; ++i) {
+        for (size_t k = csr.row_ptr[i]; k < csr.row_ptr[i + 1]; ++k) {
+            a(i, csr.col_idx[k]) = csr.values[k];
+        }
+    }
+    return a;
+}
+
+namespace sparse_detail {
+
+// X columns handled per SpMM pass: keeps the rows of X touched by one pass
+// (cols x PANEL values) closer to L2 than the whole of X
+const size_t SPMM_PANEL = 64;
+
+template<typename T>
+T row_dot_scalar(const T* values, const uint32_t* idx, size_t n, const T* x) {
+    T s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    size_t k = 0;
+    for (; k + 4 <= n; k += 4) {
+        s0 += values[k] * x[idx[k]];
+        s1 += values[k + 1] * x[idx[k + 1]];
+        s2 += values[k + 2] * x[idx[k + 2]];
+        s3 += values[k + 3] * x[idx[k + 3]];
+    }
+    for (; k < n; ++k) {
+        s0 += values[k] * x[idx[k]];
+    }
+    return (s0 + s1) + (s2 + s3);
+}
+
+template<typename T>
+void axpy_scalar(T* y, T a, const T* x, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        y[i] += a * x[i];
+    }
+}
+
+// y[0..b) += block (b x b, column-major) * x[0..b)
+template<typename T>
+void block_mv_scalar(const T* block, size_t b, const T* x, T* y) {
+    for (size_t j = 0; j < b; ++j) {
+        for (size_t i = 0; i < b; ++i) {
+            y[i] += block[j * b + i] * x[j];
+        }
+    }
+}
+
+#if defined(__x86_64__)
+__attribute__((target("avx2,fma")))
+inline double row_dot_avx2(const double* values, const uint32_t* idx, size_t n, const double* x) {
+    // Masked form with a zero source: the unmasked intrinsic trips -Wmaybe-uninitialized
+    const __m256d zero = _mm256_setzero_pd(), all = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+    __m256d a0 = zero, a1 = zero;
+    size_t k = 0;
+    for (; k + 8 <= n; k += 8) {
+        __m128i i0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(idx + k));
+        __m128i i1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(idx + k + 4));
+        a0 = _mm256_fmadd_pd(_mm256_loadu_pd(values + k), _mm256_mask_i32gather_pd(zero, x, i0, all, 8), a0);
+        a1 = _mm256_fmadd_pd(_mm256_loadu_pd(values + k + 4), _mm256_mask_i32gather_pd(zero, x, i1, all, 8), a1);
+    }
+    alignas(32) double lanes[4];
+    _mm256_store_pd(lanes, _mm256_add_pd(a0, a1));
+    return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]) + row_dot_scalar(values + k, idx + k, n - k, x);
+}
+
+__attribute__((target("avx2,fma")))
+inline float row_dot_avx2(const float* values, const uint32_t* idx, size_t n, const float* x) {
+    const __m256 zero = _mm256_setzero_ps(), all = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+    __m256 a0 = zero, a1 = zero;
+    size_t k = 0;
+    for (; k + 16 <= n; k += 16) {
+        __m256i i0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(idx + k));
+        __m256i i1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(idx + k + 8));
+        a0 = _mm256_fmadd_ps(_mm256_loadu_ps(values + k), _mm256_mask_i32gather_ps(zero, x, i0, all, 4), a0);
+        a1 = _mm256_fmadd_ps(_mm256_loadu_ps(values + k + 8), _mm256_mask_i32gather_ps(zero, x, i1, all, 4), a1);
+    }
+    alignas(32) float lanes[8];
+    _mm256_store_ps(lanes, _mm256_add_ps(a0, a1));
+    float s = 0;
+    for (float v : lanes) {
+        s += v;
+    }
+    return s + row_dot_scalar(values + k, idx + k, n - k, x);
+}
+
+__attribute__((target("avx2,fma")))
+inline void axpy_avx2(double* y, double a, const double* x, size_t n) {
+    const __m256d av = _mm256_set1_pd(a);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_pd(y + i, _mm256_fmadd_pd(av, _mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i)));
+        _mm256_storeu_pd(y + i + 4, _mm256_fmadd_pd(av, _mm256_loadu_pd(x + i + 4), _mm256_loadu_pd(y + i + 4)));
+    }
+    axpy_scalar(y + i, a, x + i, n - i);
+}
+
+__attribute__((target("avx2,fma")))
+inline void axpy_avx2(float* y, float a, const float* x, size_t n) {
+    const __m256 av = _mm256_set1_ps(a);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        _mm256_storeu_ps(y + i, _mm256_fmadd_ps(av, _mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i)));
+        _mm256_storeu_ps(y + i + 8, _mm256_fmadd_ps(av, _mm256_loadu_ps(x + i + 8), _mm256_loadu_ps(y + i + 8)));
+    }
+    axpy_scalar(y + i, a, x + i, n - i);
+}
+
+// One 4x4 double block: each block column is one register
+__attribute__((target("avx2,fma")))
+inline void block_mv_avx2(const double* block, const double* x, __m256d& acc) {
+    for (int j = 0; j < 4; ++j) {
+        acc = _mm256_fmadd_pd(_mm256_loadu_pd(block + 4 * j), _mm256_set1_pd(x[j]), acc);
+    }
+}
+
+// One 8x8 float block
+__attribute__((target("avx2,fma")))
+inline void block_mv_avx2(const float* block, const float* x, __m256& acc) {
+    for (int j = 0; j < 8; ++j) {
+        acc = _mm256_fmadd_ps(_mm256_loadu_ps(block + 8 * j), _mm256_set1_ps(x[j]), acc);
+    }
+}
+
+// Block size whose block column fills one AVX2 register
+template<typename T> constexpr size_t simd_block() { return 32 / sizeof(T); }
+
+__attribute__((target("avx2,fma")))
+inline void bsr_rows_avx2(const BsrMatrix<double>& a, const double* x, double* y, size_t br_begin, size_t br_end) {
+    for (size_t br = br_begin; br < br_end; ++br) {
+        __m256d acc = _mm256_setzero_pd();
+        for (size_t b = a.block_ptr[br]; b < a.block_ptr[br + 1]; ++b) {
+            block_mv_avx2(&a.values[b * 16], x + a.block_col[b] * 4, acc);
+        }
+        _mm256_storeu_pd(y + br * 4, acc);
+    }
+}
+
+__attribute__((target("avx2,fma")))
+inline void bsr_rows_avx2(const BsrMatrix<float>& a, const float* x, float* y, size_t br_begin, size_t br_end) {
+    for (size_t br = br_begin; br < br_end; ++br) {
+        __m256 acc = _mm256_setzero_ps();
+        for (size_t b = a.block_ptr[br]; b < a.block_ptr[br + 1]; ++b) {
+            block_mv_avx2(&a.values[b * 64], x + a.block_col[b] * 8, acc);
+        }
+        _mm256_storeu_ps(y + br * 8, acc);
+    }
+}
+#endif
+
+template<typename T>
+constexpr bool has_simd() {
+    return std::is_same<T, float>::value || std::is_same<T, double>::value;
+}
+
+template<typename T>
+T row_dot(const T* values, const uint32_t* idx, size_t n, const T* x) {
+#if defined(__x86_64__)
+    if constexpr (has_simd<T>()) {
+        if (isa_supported(IsaLevel::AVX2)) {
+            return row_dot_avx2(values, idx, n, x);
+        }
+    }
+#endif
+    return row_dot_scalar(values, idx, n, x);
+}
+
+template<typename T>
+void axpy(T* y, T a, const T* x, size_t n) {
+#if defined(__x86_64__)
+    if constexpr (has_simd<T>()) {
+        if (isa_supported(IsaLevel::AVX2)) {
+            axpy_avx2(y, a, x, n);
+            return;
+        }
+    }
+#endif
+    axpy_scalar(y, a, x, n);
+}
+
+template<typename T>
+void csr_spmv_rows(const CsrMatrix<T>& a, const T* x, T* y, size_t row_begin, size_t row_end) {
+    for (size_t i = row_begin; i < row_end; ++i) {
+        size_t start = a.row_ptr[i];
+        y[i] = row_dot(a.values.data() + start, a.col_idx.data() + start, a.row_ptr[i + 1] - start, x);
+    }
+}
+
+// y has a.block_rows * block entries and x a.block_cols * block (padded)
+template<typename T>
+void bsr_spmv_rows(const BsrMatrix<T>& a, const T* x, T* y, size_t br_begin, size_t br_end) {
+#if defined(__x86_64__)
+    if constexpr (has_simd<T>()) {
+        if (a.block == simd_block<T>() && isa_supported(IsaLevel::AVX2)) {
+            bsr_rows_avx2(a, x, y, br_begin, br_end);
+            return;
+        }
+    }
+#endif
+    const size_t bs = a.block;
+    for (size_t br = br_begin; br < br_end; ++br) {
+        T* yb = y + br * bs;
+        std::fill(yb, yb + bs, T(0));
+        for (size_t b = a.block_ptr[br]; b < a.block_ptr[br + 1]; ++b) {
+            block_mv_scalar(&a.values[b * bs * bs], bs, x + a.block_col[b] * bs, yb);
+        }
+    }
+}
+
+// Y rows [row_begin, row_end) = A rows * X, one SPMM_PANEL-wide column panel at a time
+template<typename T>
+void csr_spmm_rows(const CsrMatrix<T>& a, const Matrix<T>& x, Matrix<T>& y, size_t row_begin, size_t row_end) {
+    const size_t k = x.num_cols();
+    for (size_t p0 = 0; p0 < k; p0 += SPMM_PANEL) {
+        size_t width = std::min(SPMM_PANEL, k - p0);
+        for (size_t i = row_begin; i < row_end; ++i) {
+            T* yrow = y.row(i) + p0;
+            std::fill(yrow, yrow + width, T(0));
+            for (size_t e = a.row_ptr[i]; e < a.row_ptr[i + 1]; ++e) {
+                axpy(yrow, a.values[e], x.row(a.col_idx[e]) + p0, width);
+            }
+        }
+    }
+}
+
+// Row boundaries splitting ptr (a row_ptr / block_ptr array) into `parts`
+// ranges holding about the same number of nonzeros
+inline std::vector<size_t> balanced_splits(const std::vector<size_t>& ptr, int parts) {
+    size_t rows = ptr.size() - 1;
+    size_t nnz = ptr.back();
+    std::vector<size_t> splits(parts + 1, rows);
+    splits[0] = 0;
+    for (int t = 1; t < parts; ++t) {
+        size_t target = nnz * t / parts;
+        size_t row = std::lower_bound(ptr.begin(), ptr.end(), target) - ptr.begin();
+        splits[t] = std::max(splits[t - 1], std::min(row, rows));
+    }
+    return splits;
+}
+
+// Runs fn(row_begin, row_end) on nonzero-balanced row ranges
+template<typename Fn>
+void run_balanced(const std::vector<size_t>& ptr, int threads, Fn fn) {
+    threads = std::max(1, std::min<int>(threads, static_cast<int>(ptr.size() - 1)));
+    std::vector<size_t> splits = balanced_splits(ptr, threads);
+    std::vector<std::thread> workers;
+    for (int t = 1; t < threads; ++t) {
+        workers.emplace_back([&, t]() { fn(splits[t], splits[t + 1]); });
+    }
+    fn(splits[0], splits[1]);
+    for (auto& w : workers) {
+        w.join();
+    }
+}
+
+// Copies v into a zero-padded buffer when the block grid is wider than v
+template<typename T>
+const T* padded(const T* v, size_t n, size_t padded_n, std::vector<T>& buffer) {
+    if (n == padded_n) {
+        return v;
+    }
+    buffer.assign(padded_n, T(0));
+    std::copy(v, v + n, buffer.begin());
+    return buffer.data();
+}
+
+template<typename T>
+void bsr_spmv(const BsrMatrix<T>& a, const T* x, T* y, int threads) {
+    std::vector<T> x_buffer, y_buffer;
+    const T* xp = padded(x, a.cols, a.block_cols * a.block, x_buffer);
+    T* yp = y;
+    if (a.rows != a.block_rows * a.block) {
+        y_buffer.assign(a.block_rows * a.block, T(0));
+        yp = y_buffer.data();
+    }
+    run_balanced(a.block_ptr, threads, [&](size_t begin, size_t end) {
+        bsr_spmv_rows(a, xp, yp, begin, end);
+    });
+    if (yp != y) {
+        std::copy(yp, yp + a.rows, y);
+    }
+}
+
+} // namespace sparse_detail
+
+// y = A x; y has a.rows entries
+template<typename T>
+void spmv(const CsrMatrix<T>& a, const T* x, T* y) {
+    sparse_detail::csr_spmv_rows(a, x, y, 0, a.rows);
+}
+
+template<typename T>
+void spmv_parallel(const CsrMatrix<T>& a, const T* x, T* y, int threads) {
+    sparse_detail::run_balanced(a.row_ptr, threads, [&](size_t begin, size_t end) {
+        sparse_detail::csr_spmv_rows(a, x, y, begin, end);
+    });
+}
+
+// Column-oriented: scatters x[j] * column j into y. Serial, since columns
+// write overlapping rows of y; CSC is the layout for A^T x and column access.
+template<typename T>
+void spmv(const CscMatrix<T>& a, const T* x, T* y) {
+    std::fill(y, y + a.rows, T(0));
+    for (size_t j = 0; j < a.cols; ++j) {
+        T xj = x[j];
+        for (size_t k = a.col_ptr[j]; k < a.col_ptr[j + 1]; ++k) {
+            y[a.row_idx[k]] += a.values[k] * xj;
+        }
+    }
+}
+
+template<typename T>
+void spmv(const BsrMatrix<T>& a, const T* x, T* y) {
+    sparse_detail::bsr_spmv(a, x, y, 1);
+}
+
+template<typename T>
+void spmv_parallel(const BsrMatrix<T>& a, const T* x, T* y, int threads) {
+    sparse_detail::bsr_spmv(a, x, y, threads);
+}
+
+// Y = A X with X dense (a.cols x k)
+template<typename T>
+Matrix<T> spmm(const CsrMatrix<T>& a, const Matrix<T>& x) {
+    Matrix<T> y(a.rows, x.num_cols());
+    sparse_detail::csr_spmm_rows(a, x, y, 0, a.rows);
+    return y;
+}
+
+template<typename T>
+Matrix<T> spmm_parallel(const CsrMatrix<T>& a, const Matrix<T>& x, int threads) {
+    Matrix<T> y(a.rows, x.num_cols());
+    sparse_detail::run_balanced(a.row_ptr, threads, [&](size_t begin, size_t end) {
+        sparse_detail::csr_spmm_rows(a, x, y, begin, end);
+    });
+    return y;
+}
@@ -0,0 +1,479 @@
+/*
+ * 4D Tensors
+ * Tensor<T> holds batch x channels x height x width activations in one of
+ * three layouts:
+ *   NCHW   planes per channel; convolution vectorizes along image rows
+ *   NHWC   channels innermost; vectorizes across output channels
+ *   NCHWc  channels in blocks of c (one SIMD vector by default), each block
+ *          stored NHWc, so a pixel's block is one vector load; the channel
+ *          count is padded with zeros to a multiple of c
+ * convert_layout moves between them (per-image blocked transposes where the
+ * conversion is one). conv2d computes the multi-channel valid correlation
+ * out(n, k) = sum over c of in(n, c) correlated with filter (k, c) with a
+ * register-blocked AVX2 kernel for each layout, so the layouts can be
+ * compared on the same problem.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+#include "batched_gemm.h"
+#include "cpu_dispatch.h"
+#include "transpose.h"
+
+enum class TensorLayout { NCHW, NHWC, NCHWc };
+
+inline const char* layout_name(TensorLayout layout) {
+    switch (layout) {
+        case TensorLayout::NCHW: return "NCHW";
+        case TensorLayout::NHWC: return "NHWC";
+        case TensorLayout::NCHWc: return "NCHWc";
+    }
+    return "?";
+}
+
+template<typename T>
+class Tensor {
+private:
+    size_t n, c, h, w;
+    TensorLayout fmt;
+    size_t blk, c_blocks;
+    std::vector<T> data;
+
+public:
+    // One AVX2 vector of channels per NCHWc block
+    static constexpr size_t default_block() { return 32 / sizeof(T); }
+
+    Tensor(size_t batch, size_t channels, size_t height, size_t width,
+           TensorLayout layout = TensorLayout::NCHW, size_t block = default_block())
+        : n(batch), c(channels), h(height), w(width), fmt(layout),
+          blk(layout == TensorLayout::NCHWc ? block : 1), c_blocks((channels + blk - 1) / blk),
+          data(batch * c_blocks * blk * height * width) {}
+
+    size_t offset(size_t ni, size_t ci, size_t yi, size_t xi) const {
+        switch (fmt) {
+            case TensorLayout::NCHW: return ((ni * c + ci) * h + yi) * w + xi;
+            case TensorLayout::NHWC: return ((ni * h + yi) * w + xi) * c + ci;
+            case TensorLayout::NCHWc: break;
+        }
+        return (((ni * c_blocks + ci / blk) * h + yi) * w + xi) * blk + ci % blk;
+    }
+
+    T& operator()(size_t ni, size_t ci, size_t yi, size_t xi) { return data[offset(ni, ci, yi, xi)]; }
+    const T& operator()(size_t ni, size_t ci, size_t yi, size_t xi) const { return data[offset(ni, ci, yi, xi)]; }
+
+    size_t batch() const { return n; }
+    size_t channels() const { return c; }
+    size_t height() const { return h; }
+    size_t width() const { return w; }
+    TensorLayout layout() const { return fmt; }
+    size_t block() const { return blk; }
+    size_t channel_blocks() const { return c_blocks; }
+    // Stored elements, including NCHWc channel padding
+    size_t size() const { return data.size(); }
+
+    T* raw() { return data.data(); }
+    const T* raw() const { return data.data(); }
+
+    // Logical elements only; NCHWc padding stays zero
+    void randomize() {
+        for (size_t ni = 0; ni < n; ++ni) {
+            for (size_t ci = 0; ci < c; ++ci) {
+                for (size_t yi = 0; yi < h; ++yi) {
+                    for (size_t xi = 0; xi < w; ++xi) {
+                        (*this)(ni, ci, yi, xi) = static_cast<T>(rand()) / RAND_MAX;
+                    }
+                }
+            }
+        }
+    }
+};
+
+// Copy of src in another layout (block only matters for NCHWc)
+template<typename T>
+Tensor<T> convert_layout(const Tensor<T>& src, TensorLayout layout, size_t block = Tensor<T>::default_block()) {
+    const size_t N = src.batch(), C = src.channels(), HW = src.height() * src.width();
+    Tensor<T> dst(N, C, src.height(), src.width(), layout, block);
+    const TensorLayout from = src.layout();
+    if (from == layout && (layout != TensorLayout::NCHWc || src.block() == dst.block())) {
+        std::copy(src.raw(), src.raw() + src.size(), dst.raw());
+        return dst;
+    }
+    const T* s = src.raw();
+    T* d = dst.raw();
+    for (size_t n = 0; n < N; ++n) {
+        if (from == TensorLayout::NCHW && layout == TensorLayout::NHWC) {
+            transpose(s + n * C * HW, d + n * HW * C, C, HW);
+        } else if (from == TensorLayout::NHWC && layout == TensorLayout::NCHW) {
+            transpose(s + n * HW * C, d + n * C * HW, HW, C);
+        } else if (from == TensorLayout::NCHW && layout == TensorLayout::NCHWc) {
+            // Each block of b planes (b x HW) transposes to HW x b
+            const size_t b = dst.block();
+            for (size_t cb = 0; cb < dst.channel_blocks(); ++cb) {
+                const size_t planes = std::min(b, C - cb * b);
+                const T* sb = s + (n * C + cb * b) * HW;
+                T* db = d + (n * dst.channel_blocks() + cb) * HW * b;
+                if (planes == b) {
+                    transpose(sb, db, b, HW);
+                } else {
+                    for (size_t p = 0; p < HW; ++p) {
+                        for (size_t ci = 0; ci < planes; ++ci) {
+                            db[p * b + ci] = sb[ci * HW + p];
+                        }
+                    }
+                }
+            }
+        } else if (from == TensorLayout::NCHWc && layout == TensorLayout::NCHW) {
+            const size_t b = src.block();
+            for (size_t cb = 0; cb < src.channel_blocks(); ++cb) {
+                const size_t planes = std::min(b, C - cb * b);
+                const T* sb = s + (n * src.channel_blocks() + cb) * HW * b;
+                T* db = d + (n * C + cb * b) * HW;
+                if (planes == b) {
+                    transpose(sb, db, HW, b);
+                } else {
+                    for (size_t ci = 0; ci < planes; ++ci) {
+                        for (size_t p = 0; p < HW; ++p) {
+                            db[ci * HW + p] = sb[p * b + ci];
+                        }
+                    }
+                }
+            }
+        } else {
+            // NHWC <-> NCHWc, or NCHWc between block sizes: channel runs per pixel
+            const size_t run = from == TensorLayout::NCHWc && layout == TensorLayout::NCHWc
+                ? std::min(src.block(), dst.block()) : from == TensorLayout::NCHWc ? src.block() : dst.block();
+            for (size_t y = 0; y < src.height(); ++y) {
+                for (size_t x = 0; x < src.width(); ++x) {
+                    for (size_t c0 = 0; c0 < C; c0 += run) {
+                        std::memcpy(&dst(n, c0, y, x), &src(n, c0, y, x), std::min(run, C - c0) * sizeof(T));
+                    }
+                }
+            }
+        }
+    }
+    return dst;
+}
+
+namespace tensor_detail {
+
+// One output element through the layout-independent accessors; the scalar
+// path and the edges the vector kernels leave
+template<typename T>
+inline T conv_point(const Tensor<T>& in, const Tensor<T>& filters, size_t n, size_t k, size_t y, size_t x) {
+    T sum = 0;
+    for (size_t c = 0; c < in.channels(); ++c) {
+        for (size_t r = 0; r < filters.height(); ++r) {
+            for (size_t s = 0; s < filters.width(); ++s) {
+                sum += in(n, c, y + r, x + s) * filters(k, c, r, s);
+            }
+        }
+    }
+    return sum;
+}
+
+template<typename T>
+void conv_scalar(const Tensor<T>& in, const Tensor<T>& filters, Tensor<T>& out) {
+    for (size_t n = 0; n < out.batch(); ++n) {
+        for (size_t k = 0; k < out.channels(); ++k) {
+            for (size_t y = 0; y < out.height(); ++y) {
+                for (size_t x = 0; x < out.width(); ++x) {
+                    out(n, k, y, x) = conv_point(in, filters, n, k, y, x);
+                }
+            }
+        }
+    }
+}
+
+#if defined(__x86_64__)
+// NCHW: 2 output channels x NV vectors of an output row in registers; per
+// filter tap NV row loads and 2 weight broadcasts feed 2 NV FMAs
+template<size_t NV, typename T>
+__attribute__((target("avx2,fma"), always_inline))
+inline void nchw_chunk(const Tensor<T>& in, const T* w0, const T* w1, size_t n, size_t y, size_t x,
+                       size_t R, size_t S, T* o0, T* o1) {
+    using L = batched_detail::Lanes<T>;
+    const size_t W = L::W;
+    typename L::V a[NV], b[NV];
+#pragma GCC unroll 4
+    for (size_t v = 0; v < NV; ++v) {
+        a[v] = L::zero();
+        b[v] = L::zero();
+    }
+    for (size_t c = 0; c < in.channels(); ++c) {
+        for (size_t r = 0; r < R; ++r) {
+            const T* row = in.raw() + in.offset(n, c, y + r, x);
+            for (size_t s = 0; s < S; ++s) {
+                auto f0 = L::broadcast(w0[(c * R + r) * S + s]), f1 = L::broadcast(w1[(c * R + r) * S + s]);
+#pragma GCC unroll 4
+                for (size_t v = 0; v < NV; ++v) {
+                    auto in_v = L::load(row + s + v * W);
+                    a[v] = L::fmadd(f0, in_v, a[v]);
+                    b[v] = L::fmadd(f1, in_v, b[v]);
+                }
+            }
+        }
+    }
+#pragma GCC unroll 4
+    for (size_t v = 0; v < NV; ++v) {
+        L::store(o0 + x + v * W, a[v]);
+        if (o1) {
+            L::store(o1 + x + v * W, b[v]);
+        }
+    }
+}
+
+template<typename T>
+__attribute__((target("avx2,fma")))
+void conv_nchw_avx2(const Tensor<T>& in, const Tensor<T>& filters, Tensor<T>& out) {
+    const size_t W = batched_detail::Lanes<T>::W, C = in.channels(), R = filters.height(), S = filters.width();
+    const size_t K = out.channels(), OH = out.height(), OW = out.width();
+    for (size_t n = 0; n < out.batch(); ++n) {
+        for (size_t k = 0; k < K; k += 2) {
+            const size_t k1 = std::min(k + 1, K - 1);
+            const T* w0 = filters.raw() + k * C * R * S;        // K x C x R x S
+            const T* w1 = filters.raw() + k1 * C * R * S;
+            for (size_t y = 0; y < OH; ++y) {
+                T* o0 = out.raw() + out.offset(n, k, y, 0);
+                T* o1 = k1 != k ? out.raw() + out.offset(n, k1, y, 0) : nullptr;
+                size_t x = 0;
+                for (; x + 3 * W <= OW; x += 3 * W) {
+                    nchw_chunk<3>(in, w0, w1, n, y, x, R, S, o0, o1);
+                }
+                for (; x + W <= OW; x += W) {
+                    nchw_chunk<1>(in, w0, w1, n, y, x, R, S, o0, o1);
+                }
+                if (x < OW && OW >= W) {
+                    // Last vector overlaps outputs already written, with the same values
+                    nchw_chunk<1>(in, w0, w1, n, y, OW - W, R, S, o0, o1);
+                } else {
+                    for (; x < OW; ++x) {
+                        o0[x] = conv_point(in, filters, n, k, y, x);
+                        if (o1) {
+                            o1[x] = conv_point(in, filters, n, k1, y, x);
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+// NHWC: 4 pixels x 2 vectors of output channels in registers; weights
+// repacked R x S x C x K so a tap's channel row is two vector loads
+template<typename T>
+__attribute__((target("avx2,fma")))
+void conv_nhwc_avx2(const Tensor<T>& in, const Tensor<T>& filters, Tensor<T>& out) {
+    using L = batched_detail::Lanes<T>;
+    const size_t W = L::W, C = in.channels(), R = filters.height(), S = filters.width();
+    const size_t K = out.channels(), OH = out.height(), OW = out.width();
+    const size_t P = 4;
+    std::vector<T> packed(R * S * C * K);
+    for (size_t k = 0; k < K; ++k) {
+        for (size_t c = 0; c < C; ++c) {
+            for (size_t r = 0; r < R; ++r) {
+                for (size_t s = 0; s < S; ++s) {
+                    packed[((r * S + s) * C + c) * K + k] = filters(k, c, r, s);
+                }
+            }
+        }
+    }
+    const size_t k_vec = K / (2 * W) * (2 * W);
+    for (size_t n = 0; n < out.batch(); ++n) {
+        for (size_t y = 0; y < OH; ++y) {
+            for (size_t x0 = 0; x0 < OW; x0 += P) {
+                if (OW < P) {
+                    for (size_t x = 0; x < OW; ++x) {
+                        for (size_t k = 0; k < K; ++k) {
+                            out(n, k, y, x) = conv_point(in, filters, n, k, y, x);
+                        }
+                    }
+                    break;
+                }
+                const size_t x = std::min(x0, OW - P);      // the last block may overlap the one before
+                T* o = out.raw() + out.offset(n, 0, y, x);
+                for (size_t k = 0; k < k_vec; k += 2 * W) {
+                    auto a00 = L::zero(), a01 = L::zero(), a10 = L::zero(), a11 = L::zero();
+                    auto a20 = L::zero(), a21 = L::zero(), a30 = L::zero(), a31 = L::zero();
+                    for (size_t r = 0; r < R; ++r) {
+                        for (size_t s = 0; s < S; ++s) {
+                            const T* ip = in.raw() + in.offset(n, 0, y + r, x + s);
+                            const T* wp = packed.data() + (r * S + s) * C * K + k;
+                            for (size_t c = 0; c < C; ++c) {
+                                auto w0 = L::load(wp + c * K), w1 = L::load(wp + c * K + W);
+                                auto i0 = L::broadcast(ip[c]), i1 = L::broadcast(ip[C + c]);
+                                auto i2 = L::broadcast(ip[2 * C + c]), i3 = L::broadcast(ip[3 * C + c]);
+                                a00 = L::fmadd(i0, w0, a00);
+                                a01 = L::fmadd(i0, w1, a01);
+                                a10 = L::fmadd(i1, w0, a10);
+                                a11 = L::fmadd(i1, w1, a11);
+                                a20 = L::fmadd(i2, w0, a20);
+                                a21 = L::fmadd(i2, w1, a21);
+                                a30 = L::fmadd(i3, w0, a30);
+                                a31 = L::fmadd(i3, w1, a31);
+                            }
+                        }
+                    }
+                    L::store(o + k, a00);
+                    L::store(o + k + W, a01);
+                    L::store(o + K + k, a10);
+                    L::store(o + K + k + W, a11);
+                    L::store(o + 2 * K + k, a20);
+                    L::store(o + 2 * K + k + W, a21);
+                    L::store(o + 3 * K + k, a30);
+                    L::store(o + 3 * K + k + W, a31);
+                }
+                for (size_t p = 0; p < P; ++p) {
+                    for (size_t k = k_vec; k < K; ++k) {
+                        o[p * K + k] = conv_point(in, filters, n, k, y, x + p);
+                    }
+                }
+            }
+        }
+    }
+}
+
+// NCHWc, block == vector width: P pixels x NK output channel blocks in
+// registers; per input channel NK weight vector loads and P broadcasts
+template<size_t P, size_t NK, typename T>
+__attribute__((target("avx2,fma"), always_inline))
+inline void nchwc_pixels(const T* ip, size_t in_row, const T* wp, size_t R, size_t S, size_t CB,
+                         size_t in_block, size_t w_block, size_t w_kb, T* op, size_t out_block) {
+    using L = batched_detail::Lanes<T>;
+    const size_t W = L::W;
+    typename L::V acc[NK][P];
+#pragma GCC unroll 8
+    for (size_t p = 0; p < P; ++p) {
+#pragma GCC unroll 2
+        for (size_t j = 0; j < NK; ++j) {
+            acc[j][p] = L::zero();
+        }
+    }
+    for (size_t cb = 0; cb < CB; ++cb) {
+        for (size_t r = 0; r < R; ++r) {
+            for (size_t s = 0; s < S; ++s) {
+                const T* ipx = ip + cb * in_block + r * in_row + s * W;
+                const T* wv = wp + cb * w_block + (r * S + s) * W * W;
+                for (size_t ci = 0; ci < W; ++ci) {
+                    typename L::V w[NK];
+#pragma GCC unroll 2
+                    for (size_t j = 0; j < NK; ++j) {
+                        w[j] = L::load(wv + j * w_kb + ci * W);
+                    }
+#pragma GCC unroll 8
+                    for (size_t p = 0; p < P; ++p) {
+                        auto in_v = L::broadcast(ipx[p * W + ci]);
+#pragma GCC unroll 2
+                        for (size_t j = 0; j < NK; ++j) {
+                            acc[j][p] = L::fmadd(in_v, w[j], acc[j][p]);
+                        }
+                    }
+                }
+            }
+        }
+    }
+#pragma GCC unroll 8
+    for (size_t p = 0; p < P; ++p) {
+#pragma GCC unroll 2
+        for (size_t j = 0; j < NK; ++j) {
+            L::store(op + j * out_block + p * W, acc[j][p]);
+        }
+    }
+}
+
+template<typename T>
+__attribute__((target("avx2,fma")))
+void conv_nchwc_avx2(const Tensor<T>& in, const Tensor<T>& filters, Tensor<T>& out) {
+    const size_t W = batched_detail::Lanes<T>::W, R = filters.height(), S = filters.width();
+    const size_t CB = in.channel_blocks(), KB = out.channel_blocks(), OH = out.height(), OW = out.width();
+    const size_t P = 6;
+    // Weights as [kb][cb][r][s][ci][ko]; padded channels get zero weights
+    const size_t w_block = R * S * W * W, w_kb = CB * w_block;
+    std::vector<T> packed(KB * w_kb, T(0));
+    for (size_t k = 0; k < out.channels(); ++k) {
+        for (size_t c = 0; c < in.channels(); ++c) {
+            for (size_t r = 0; r < R; ++r) {
+                for (size_t s = 0; s < S; ++s) {
+                    packed[k / W * w_kb + c / W * w_block + ((r * S + s) * W + c % W) * W + k % W] = filters(k, c, r, s);
+                }
+            }
+        }
+    }
+    const size_t in_row = in.width() * W, in_block = in.height() * in_row;
+    const size_t out_block = OH * OW * W;
+    for (size_t n = 0; n < out.batch(); ++n) {
+        // Pairs of output channel blocks share every input broadcast
+        for (size_t kb = 0; kb < KB; kb += 2) {
+            const T* wp = packed.data() + kb * w_kb;
+            const bool pair = kb + 1 < KB;
+            for (size_t y = 0; y < OH; ++y) {
+                const T* ip = in.raw() + in.offset(n, 0, y, 0);
+                T* op = out.raw() + out.offset(n, kb * W, y, 0);
+                size_t x = 0;
+                for (; x + P <= OW; x += P) {
+                    if (pair) {
+                        nchwc_pixels<P, 2>(ip + x * W, in_row, wp, R, S, CB, in_block, w_block, w_kb, op + x * W, out_block);
+                    } else {
+                        nchwc_pixels<P, 1>(ip + x * W, in_row, wp, R, S, CB, in_block, w_block, w_kb, op + x * W, out_block);
+                    }
+                }
+                for (; x < OW; ++x) {
+                    if (pair) {
+                        nchwc_pixels<1, 2>(ip + x * W, in_row, wp, R, S, CB, in_block, w_block, w_kb, op + x * W, out_block);
+                    } else {
+                        nchwc_pixels<1, 1>(ip + x * W, in_row, wp, R, S, CB, in_block, w_block, w_kb, op + x * W, out_block);
+                    }
+                }
+            }
+        }
+    }
+}
+#endif
+
+} // namespace tensor_detail
+
+// Valid correlation of every output channel k over all input channels;
+// filters are K x C x R x S (OIHW); filters in another layout are converted
+// to NCHW first. The output uses the input's layout (and NCHWc block).
+// Returns an empty tensor when the filter channels differ from the input's or
+// the filter is larger than the input.
+template<typename T>
+Tensor<T> conv2d(const Tensor<T>& input, const Tensor<T>& filters) {
+    if (filters.channels() != input.channels() || filters.height() > input.height() ||
+        filters.width() > input.width()) {
+        return Tensor<T>(0, 0, 0, 0, input.layout(), input.block());
+    }
+    if (filters.layout() != TensorLayout::NCHW) {
+        return conv2d(input, convert_layout(filters, TensorLayout::NCHW));
+    }
+    Tensor<T> out(input.batch(), filters.batch(), input.height() - filters.height() + 1,
+                  input.width() - filters.width() + 1, input.layout(), input.block());
+#if defined(__x86_64__)
+    if constexpr (std::is_same<T, float>::value || std::is_same<T, double>::value) {
+        if (isa_supported(IsaLevel::AVX2)) {
+            switch (input.layout()) {
+                case TensorLayout::NCHW:
+                    tensor_detail::conv_nchw_avx2(input, filters, out);
+                    return out;
+                case TensorLayout::NHWC:
+                    tensor_detail::conv_nhwc_avx2(input, filters, out);
+                    return out;
+                case TensorLayout::NCHWc:
+                    if (input.block() == batched_detail::Lanes<T>::W) {
+                        tensor_detail::conv_nchwc_avx2(input, filters, out);
+                        return out;
+                    }
+                    break;
+            }
+        }
+    }
+#endif
+    tensor_detail::conv_scalar(input, filters, out);
+    return out;
+}
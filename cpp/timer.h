@@ -0,0 +1,63 @@
+/*
+ * Timer Utility
+ * Scoped wall-clock timer shared by the C++ examples. A timer may carry Work
+ * metadata, in which case derived rates and the roofline position are printed
+ * under the elapsed time.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "work_metrics.h"
+
+class Timer {
+private:
+    std::chrono::high_resolution_clock::time_point start_time;
+    std::string name;
+    Work work;
+
+public:
+    Timer(const std::string& timer_name, const Work& timer_work = Work())
+        : name(timer_name), work(timer_work) {
+        start_time = std::chrono::high_resolution_clock::now();
+    }
+
+    double elapsed() const {
+        auto end_time = std::chrono::high_resolution_clock::now();
+        auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time);
+        return duration.count() / 1000000.0;
+    }
+
+    // Work can be attached once it is known (e.g. number of items found)
+    void set_work(const Work& timer_work) { work = timer_work; }
+
+    ~Timer() {
+        double seconds = elapsed();
+        std::ostringstream out;
+        out << "   " << name << ": " << std::fixed << std::setprecision(3) << seconds << "s\n";
+        std::string rates = format_throughput(work, seconds);
+        if (!rates.empty()) {
+            out << rates << "\n";
+        }
+        std::cout << out.str() << std::flush;
+    }
+};
+
+// Best wall time of `runs` calls to fn, in milliseconds; for table rows that
+// compare several kernels where a scoped Timer per call would be too noisy
+template<typename Fn>
+double best_of(int runs, Fn&& fn) {
+    double best = 1e300;
+    for (int rep = 0; rep < runs; ++rep) {
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+    return best;
+}
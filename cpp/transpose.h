@@ -0,0 +1,271 @@
+/*
+ * Matrix Transpose
+ * Cache-blocked transposes of row-major matrices. Inside each block, 8x8
+ * float / 4x4 double tiles are transposed in AVX2 registers (runtime
+ * dispatched, scalar tiles otherwise), so both loads and stores are full
+ * contiguous rows. Also provides an in-place square transpose (tile pairs are
+ * swapped), an in-place rectangular transpose by cycle-following, and
+ * multithreaded versions.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#include "cpu_dispatch.h"
+
+namespace transpose_detail {
+
+// Elements per side of a cache block; a float source and destination block
+// (2 x 16KB) fit in L1 together
+const size_t BLOCK = 64;
+
+// dst(j, i) = src(i, j) for a rows x cols tile with leading dimensions lds / ldd
+template<typename T>
+inline void tile_scalar(const T* src, size_t lds, T* dst, size_t ldd, size_t rows, size_t cols) {
+    for (size_t i = 0; i < rows; ++i) {
+        for (size_t j = 0; j < cols; ++j) {
+            dst[j * ldd + i] = src[i * lds + j];
+        }
+    }
+}
+
+#if defined(__x86_64__)
+__attribute__((target("avx2")))
+inline void tile_avx2(const float* src, size_t lds, float* dst, size_t ldd) {
+    __m256 r0 = _mm256_loadu_ps(src + 0 * lds), r1 = _mm256_loadu_ps(src + 1 * lds);
+    __m256 r2 = _mm256_loadu_ps(src + 2 * lds), r3 = _mm256_loadu_ps(src + 3 * lds);
+    __m256 r4 = _mm256_loadu_ps(src + 4 * lds), r5 = _mm256_loadu_ps(src + 5 * lds);
+    __m256 r6 = _mm256_loadu_ps(src + 6 * lds), r7 = _mm256_loadu_ps(src + 7 * lds);
+
+    // Interleave pairs of rows, then pairs of pairs, then swap 128-bit halves
+    __m256 t0 = _mm256_unpacklo_ps(r0, r1), t1 = _mm256_unpackhi_ps(r0, r1);
+    __m256 t2 = _mm256_unpacklo_ps(r2, r3), t3 = _mm256_unpackhi_ps(r2, r3);
+    __m256 t4 = _mm256_unpacklo_ps(r4, r5), t5 = _mm256_unpackhi_ps(r4, r5);
+    __m256 t6 = _mm256_unpacklo_ps(r6, r7), t7 = _mm256_unpackhi_ps(r6, r7);
+
+    __m256 s0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+    __m256 s1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+    __m256 s2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+    __m256 s3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+    __m256 s4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1, 0, 1, 0));
+    __m256 s5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3, 2, 3, 2));
+    __m256 s6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1, 0, 1, 0));
+    __m256 s7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3, 2, 3, 2));
+
+    _mm256_storeu_ps(dst + 0 * ldd, _mm256_permute2f128_ps(s0, s4, 0x20));
+    _mm256_storeu_ps(dst + 1 * ldd, _mm256_permute2f128_ps(s1, s5, 0x20));
+    _mm256_storeu_ps(dst + 2 * ldd, _mm256_permute2f128_ps(s2, s6, 0x20));
+    _mm256_storeu_ps(dst + 3 * ldd, _mm256_permute2f128_ps(s3, s7, 0x20));
+    _mm256_storeu_ps(dst + 4 * ldd, _mm256_permute2f128_ps(s0, s4, 0x31));
+    _mm256_storeu_ps(dst + 5 * ldd, _mm256_permute2f128_ps(s1, s5, 0x31));
+    _mm256_storeu_ps(dst + 6 * ldd, _mm256_permute2f128_ps(s2, s6, 0x31));
+    _mm256_storeu_ps(dst + 7 * ldd, _mm256_permute2f128_ps(s3, s7, 0x31));
+}
+
+__attribute__((target("avx2")))
+inline void tile_avx2(const double* src, size_t lds, double* dst, size_t ldd) {
+    __m256d r0 = _mm256_loadu_pd(src + 0 * lds), r1 = _mm256_loadu_pd(src + 1 * lds);
+    __m256d r2 = _mm256_loadu_pd(src + 2 * lds), r3 = _mm256_loadu_pd(src + 3 * lds);
+
+    __m256d t0 = _mm256_unpacklo_pd(r0, r1), t1 = _mm256_unpackhi_pd(r0, r1);
+    __m256d t2 = _mm256_unpacklo_pd(r2, r3), t3 = _mm256_unpackhi_pd(r2, r3);
+
+    _mm256_storeu_pd(dst + 0 * ldd, _mm256_permute2f128_pd(t0, t2, 0x20));
+    _mm256_storeu_pd(dst + 1 * ldd, _mm256_permute2f128_pd(t1, t3, 0x20));
+    _mm256_storeu_pd(dst + 2 * ldd, _mm256_permute2f128_pd(t0, t2, 0x31));
+    _mm256_storeu_pd(dst + 3 * ldd, _mm256_permute2f128_pd(t1, t3, 0x31));
+}
+#endif
+
+// Register tile side for T: 8 floats, 4 doubles, 0 (no SIMD tile) otherwise
+template<typename T> constexpr size_t tile_size() { return 0; }
+template<> constexpr size_t tile_size<float>() { return 8; }
+template<> constexpr size_t tile_size<double>() { return 4; }
+
+// Full TILE x TILE tile: SIMD when available, scalar otherwise
+template<typename T>
+inline void tile(const T* src, size_t lds, T* dst, size_t ldd, bool simd) {
+    constexpr size_t TILE = tile_size<T>();
+#if defined(__x86_64__)
+    if constexpr (TILE > 0) {
+        if (simd) {
+            tile_avx2(src, lds, dst, ldd);
+            return;
+        }
+    }
+#endif
+    (void)simd;
+    tile_scalar(src, lds, dst, ldd, TILE, TILE);
+}
+
+// Transposes src rows [row_begin, row_end) of a rows x cols matrix into dst
+template<typename T>
+void transpose_rows(const T* src, T* dst, size_t rows, size_t cols, size_t row_begin, size_t row_end,
+                    size_t block = BLOCK) {
+    constexpr size_t TILE = tile_size<T>();
+    const bool simd = isa_supported(IsaLevel::AVX2);
+    for (size_t ib = row_begin; ib < row_end; ib += block) {
+        size_t i_end = std::min(ib + block, row_end);
+        for (size_t jb = 0; jb < cols; jb += block) {
+            size_t j_end = std::min(jb + block, cols);
+            if (TILE == 0) {
+                tile_scalar(src + ib * cols + jb, cols, dst + jb * rows + ib, rows, i_end - ib, j_end - jb);
+                continue;
+            }
+            size_t i = ib;
+            for (; i + TILE <= i_end; i += TILE) {
+                size_t j = jb;
+                for (; j + TILE <= j_end; j += TILE) {
+                    tile(src + i * cols + j, cols, dst + j * rows + i, rows, simd);
+                }
+                tile_scalar(src + i * cols + j, cols, dst + j * rows + i, rows, TILE, j_end - j);
+            }
+            tile_scalar(src + i * cols + jb, cols, dst + jb * rows + i, rows, i_end - i, j_end - jb);
+        }
+    }
+}
+
+// Swaps tile (i, j) with tile (j, i) of an n x n matrix, transposing both;
+// a diagonal tile (i == j) is transposed in place
+template<typename T>
+void swap_tiles(T* a, size_t n, size_t i, size_t j, size_t tile_rows, size_t tile_cols, bool simd) {
+    constexpr size_t TILE = tile_size<T>() > 0 ? tile_size<T>() : 8;
+    T tmp[TILE * TILE];
+    T* upper = a + i * n + j;
+    T* lower = a + j * n + i;
+    bool full = tile_size<T>() > 0 && tile_rows == TILE && tile_cols == TILE;
+    // tmp = upper^T; upper = lower^T; lower = tmp
+    if (full) {
+        tile(upper, n, tmp, TILE, simd);
+    } else {
+        tile_scalar(upper, n, tmp, TILE, tile_rows, tile_cols);
+    }
+    if (i != j) {
+        if (full) {
+            tile(lower, n, upper, n, simd);
+        } else {
+            tile_scalar(lower, n, upper, n, tile_cols, tile_rows);
+        }
+    }
+    for (size_t r = 0; r < tile_cols; ++r) {
+        std::memcpy(lower + r * n, tmp + r * TILE, tile_rows * sizeof(T));
+    }
+}
+
+// In-place square transpose of the block rows [block_begin, block_end) (upper triangle)
+template<typename T>
+void transpose_square_blocks(T* a, size_t n, size_t block_begin, size_t block_end, size_t block_step) {
+    constexpr size_t TILE = tile_size<T>() > 0 ? tile_size<T>() : 8;
+    const bool simd = isa_supported(IsaLevel::AVX2);
+    for (size_t ib = block_begin; ib < block_end; ib += block_step) {
+        size_t i0 = ib * BLOCK, i_end = std::min(i0 + BLOCK, n);
+        for (size_t j0 = i0; j0 < n; j0 += BLOCK) {
+            size_t j_end = std::min(j0 + BLOCK, n);
+            for (size_t i = i0; i < i_end; i += TILE) {
+                size_t rows = std::min(TILE, i_end - i);
+                // On the diagonal block only tiles at or right of the diagonal
+                for (size_t j = (j0 == i0 ? i : j0); j < j_end; j += TILE) {
+                    swap_tiles(a, n, i, j, rows, std::min(TILE, j_end - j), simd);
+                }
+            }
+        }
+    }
+}
+
+inline int clamp_threads(int threads, size_t work_units) {
+    return std::max(1, std::min<int>(threads, static_cast<int>(work_units)));
+}
+
+} // namespace transpose_detail
+
+// Reference loop: row-major reads, column-strided writes
+template<typename T>
+void transpose_naive(const T* src, T* dst, size_t rows, size_t cols) {
+    for (size_t i = 0; i < rows; ++i) {
+        for (size_t j = 0; j < cols; ++j) {
+            dst[j * rows + i] = src[i * cols + j];
+        }
+    }
+}
+
+// Blocked out-of-place transpose: dst (cols x rows) = src (rows x cols)^T;
+// `block` is the cache block side (a multiple of the register tile)
+template<typename T>
+void transpose(const T* src, T* dst, size_t rows, size_t cols, size_t block = transpose_detail::BLOCK) {
+    transpose_detail::transpose_rows(src, dst, rows, cols, 0, rows, block);
+}
+
+// Multithreaded out-of-place transpose; threads take disjoint bands of source rows
+template<typename T>
+void transpose_parallel(const T* src, T* dst, size_t rows, size_t cols, int threads) {
+    using namespace transpose_detail;
+    size_t blocks = (rows + BLOCK - 1) / BLOCK;
+    threads = clamp_threads(threads, blocks);
+    std::vector<std::thread> workers;
+    for (int t = 1; t < threads; ++t) {
+        size_t begin = blocks * t / threads * BLOCK;
+        size_t end = std::min(rows, blocks * (t + 1) / threads * BLOCK);
+        workers.emplace_back([=]() { transpose_rows(src, dst, rows, cols, begin, end); });
+    }
+    transpose_rows(src, dst, rows, cols, 0, std::min(rows, blocks / threads * BLOCK));
+    for (auto& w : workers) {
+        w.join();
+    }
+}
+
+// In-place transpose of an n x n matrix: tile pairs across the diagonal are swapped
+template<typename T>
+void transpose_inplace_square(T* a, size_t n, int threads = 1) {
+    using namespace transpose_detail;
+    size_t blocks = (n + BLOCK - 1) / BLOCK;
+    threads = clamp_threads(threads, blocks);
+    // Block rows are dealt round-robin: the upper triangle shrinks with the row index
+    std::vector<std::thread> workers;
+    for (int t = 1; t < threads; ++t) {
+        workers.emplace_back([=]() { transpose_square_blocks(a, n, t, blocks, threads); });
+    }
+    transpose_square_blocks(a, n, 0, blocks, threads);
+    for (auto& w : workers) {
+        w.join();
+    }
+}
+
+// In-place transpose of a rows x cols matrix into cols x rows. Square matrices
+// use the tiled swap; otherwise every permutation cycle (element k moves to
+// (k mod cols) * rows + k / cols) is followed once, tracked with a bitmap.
+// Cycle-following is latency-bound (one random access per element) and runs
+// on the calling thread; `threads` only applies to the square path.
+template<typename T>
+void transpose_inplace(T* a, size_t rows, size_t cols, int threads = 1) {
+    if (rows == cols) {
+        transpose_inplace_square(a, rows, threads);
+        return;
+    }
+    const size_t total = rows * cols;
+    if (total < 3) {
+        return;
+    }
+    std::vector<bool> visited(total, false);
+    for (size_t start = 1; start < total - 1; ++start) {
+        if (visited[start]) {
+            continue;
+        }
+        size_t k = start;
+        T carried = a[start];
+        do {
+            size_t next = (k % cols) * rows + k / cols;
+            std::swap(carried, a[next]);
+            visited[next] = true;
+            k = next;
+        } while (k != start);
+    }
+}
@@ -0,0 +1,410 @@
+/*
+ * Winograd Convolution
+ * Minimal-filtering F(m x m, 3 x 3) correlation (Lavin & Gray): each m x m
+ * output tile is A^T [(G g G^T) . (B^T d B)] A for the (m + 2)^2 input patch
+ * d, so a 3x3 filter costs (m + 2)^2 / m^2 multiplies per output instead of
+ * 9: 4 for F(2x2, 3x3), 2.25 for F(4x4, 3x3). The larger tile does fewer
+ * multiplies but its transforms have bigger constants, so it loses more
+ * precision, especially in float.
+ *
+ * Filters are transformed once (WinogradFilters). Inputs are transformed a
+ * block of tiles at a time, one tile per SIMD lane. With C input and K output
+ * channels the elementwise stage becomes (m + 2)^2 independent K x C by
+ * C x tiles GEMMs, run on gemm_accumulate (gemm_update.h); a single
+ * channel skips the GEMM and keeps transform, product and inverse transform
+ * in registers.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+#include "cpu_dispatch.h"
+#include "gemm_update.h"
+#include "matrix.h"
+
+enum class WinogradTile { F2x2, F4x4 };
+
+namespace winograd_detail {
+
+// Output tiles transformed and multiplied together per block
+const size_t TILE_BLOCK = 64;
+
+// 1D transforms, x and y strided: filter y = G g, input y = B^T x, output y = A^T x.
+// T is the scalar type S, or a vector of S to transform one tile per lane.
+template<size_t M> struct Transforms;
+
+template<> struct Transforms<2> {
+    static const size_t ALPHA = 4;
+
+    template<typename S, typename T = S>
+    __attribute__((always_inline)) static inline void filter(const T* g, size_t gs, T* y, size_t ys) {
+        T g0 = g[0], g1 = g[gs], g2 = g[2 * gs];
+        y[0] = g0;
+        y[ys] = S(0.5) * (g0 + g1 + g2);
+        y[2 * ys] = S(0.5) * (g0 - g1 + g2);
+        y[3 * ys] = g2;
+    }
+
+    template<typename S, typename T = S>
+    __attribute__((always_inline)) static inline void input(const T* x, size_t xs, T* y, size_t ys) {
+        T x0 = x[0], x1 = x[xs], x2 = x[2 * xs], x3 = x[3 * xs];
+        y[0] = x0 - x2;
+        y[ys] = x1 + x2;
+        y[2 * ys] = x2 - x1;
+        y[3 * ys] = x1 - x3;
+    }
+
+    template<typename S, typename T = S>
+    __attribute__((always_inline)) static inline void output(const T* x, size_t xs, T* y, size_t ys) {
+        T x0 = x[0], x1 = x[xs], x2 = x[2 * xs], x3 = x[3 * xs];
+        y[0] = x0 + x1 + x2;
+        y[ys] = x1 - x2 - x3;
+    }
+};
+
+// Interpolation points 0, +-1, +-2 and infinity
+template<> struct Transforms<4> {
+    static const size_t ALPHA = 6;
+
+    template<typename S, typename T = S>
+    __attribute__((always_inline)) static inline void filter(const T* g, size_t gs, T* y, size_t ys) {
+        T g0 = g[0], g1 = g[gs], g2 = g[2 * gs];
+        y[0] = g0 / S(4);
+        y[ys] = -(g0 + g1 + g2) / S(6);
+        y[2 * ys] = -(g0 - g1 + g2) / S(6);
+        y[3 * ys] = g0 / S(24) + g1 / S(12) + g2 / S(6);
+        y[4 * ys] = g0 / S(24) - g1 / S(12) + g2 / S(6);
+        y[5 * ys] = g2;
+    }
+
+    template<typename S, typename T = S>
+    __attribute__((always_inline)) static inline void input(const T* x, size_t xs, T* y, size_t ys) {
+        T x0 = x[0], x1 = x[xs], x2 = x[2 * xs], x3 = x[3 * xs], x4 = x[4 * xs], x5 = x[5 * xs];
+        y[0] = S(4) * x0 - S(5) * x2 + x4;
+        y[ys] = -S(4) * (x1 + x2) + x3 + x4;
+        y[2 * ys] = S(4) * (x1 - x2) - x3 + x4;
+        y[3 * ys] = S(2) * (x3 - x1) - x2 + x4;
+        y[4 * ys] = S(2) * (x1 - x3) - x2 + x4;
+        y[5 * ys] = S(4) * x1 - S(5) * x3 + x5;
+    }
+
+    template<typename S, typename T = S>
+    __attribute__((always_inline)) static inline void output(const T* x, size_t xs, T* y, size_t ys) {
+        T x1 = x[xs], x2 = x[2 * xs], x3 = x[3 * xs], x4 = x[4 * xs];
+        T sum12 = x1 + x2, diff12 = x1 - x2, sum34 = x3 + x4, diff34 = x3 - x4;
+        y[0] = x[0] + sum12 + sum34;
+        y[ys] = diff12 + S(2) * diff34;
+        y[2 * ys] = sum12 + S(4) * sum34;
+        y[3 * ys] = diff12 + S(8) * diff34 + x[5 * xs];
+    }
+};
+
+} // namespace winograd_detail
+
+// A K x C bank of 3x3 filters in the transform domain, ready for any input size
+template<typename T>
+struct WinogradFilters {
+    WinogradTile tile = WinogradTile::F4x4;
+    size_t out_channels = 0, in_channels = 0;
+    // G g G^T at [(xi * out_channels + k) * in_channels + c] for transform
+    // element xi
+    std::vector<T> u;
+};
+
+namespace winograd_detail {
+
+template<size_t M, typename T>
+WinogradFilters<T> transform_filters(const std::vector<Matrix<T>>& filters, size_t in_channels) {
+    using X = Transforms<M>;
+    const size_t A = X::ALPHA, K = filters.size() / in_channels, C = in_channels;
+    WinogradFilters<T> f;
+    f.tile = M == 2 ? WinogradTile::F2x2 : WinogradTile::F4x4;
+    f.out_channels = K;
+    f.in_channels = C;
+    f.u.resize(A * A * K * C);
+    T g[9], t[3 * A], u[A * A];
+    for (size_t k = 0; k < K; ++k) {
+        for (size_t c = 0; c < C; ++c) {
+            const Matrix<T>& filter = filters[k * C + c];
+            for (size_t i = 0; i < 3; ++i) {
+                for (size_t j = 0; j < 3; ++j) {
+                    g[i * 3 + j] = filter(i, j);
+                }
+            }
+            for (size_t j = 0; j < 3; ++j) {
+                X::template filter<T>(g + j, 3, t + j, 3);          // columns: A x 3
+            }
+            for (size_t i = 0; i < A; ++i) {
+                X::template filter<T>(t + i * 3, 1, u + i * A, 1);  // rows: A x A
+            }
+            for (size_t xi = 0; xi < A * A; ++xi) {
+                f.u[(xi * K + k) * C + c] = u[xi];
+            }
+        }
+    }
+    return f;
+}
+
+// Patches of tiles first .. first + lanes - 1 into buf[(i * ALPHA + j) * W + lane];
+// patches past the edge and unused lanes read zeros
+template<size_t M, size_t W, typename T>
+__attribute__((always_inline)) inline void gather_patches(const Matrix<T>& plane, size_t first, size_t lanes,
+                                                          size_t tiles_c, T* buf) {
+    const size_t A = Transforms<M>::ALPHA, rows = plane.num_rows(), cols = plane.num_cols();
+    for (size_t l = 0; l < W; ++l) {
+        const size_t r0 = (first + l) / tiles_c * M, c0 = (first + l) % tiles_c * M;
+        if (l < lanes && r0 + A <= rows && c0 + A <= cols) {
+            for (size_t i = 0; i < A; ++i) {
+                const T* row = plane.row(r0 + i) + c0;
+                for (size_t j = 0; j < A; ++j) {
+                    buf[(i * A + j) * W + l] = row[j];
+                }
+            }
+        } else {
+            for (size_t i = 0; i < A; ++i) {
+                for (size_t j = 0; j < A; ++j) {
+                    bool inside = l < lanes && r0 + i < rows && c0 + j < cols;
+                    buf[(i * A + j) * W + l] = inside ? plane(r0 + i, c0 + j) : T(0);
+                }
+            }
+        }
+    }
+}
+
+// Output tiles buf[(i * M + j) * W + lane] into the plane, clipped at the bottom and right edges
+template<size_t M, size_t W, typename T>
+__attribute__((always_inline)) inline void scatter_tiles(const T* buf, size_t first, size_t lanes, size_t tiles_c,
+                                                         Matrix<T>& plane) {
+    const size_t out_r = plane.num_rows(), out_c = plane.num_cols();
+    for (size_t l = 0; l < lanes; ++l) {
+        const size_t r0 = (first + l) / tiles_c * M, c0 = (first + l) % tiles_c * M;
+        const size_t tile_r = std::min(M, out_r - r0), tile_c = std::min(M, out_c - c0);
+        for (size_t i = 0; i < tile_r; ++i) {
+            T* row = plane.row(r0 + i) + c0;
+            for (size_t j = 0; j < tile_c; ++j) {
+                row[j] = buf[(i * M + j) * W + l];
+            }
+        }
+    }
+}
+
+// B^T d B on A x A vectors in place (t is scratch)
+template<size_t M, typename T, typename V>
+__attribute__((always_inline)) inline void input_2d(V* d, V* t) {
+    using X = Transforms<M>;
+    const size_t A = X::ALPHA;
+    for (size_t j = 0; j < A; ++j) {
+        X::template input<T>(d + j, A, t + j, A);
+    }
+    for (size_t i = 0; i < A; ++i) {
+        X::template input<T>(t + i * A, 1, d + i * A, 1);
+    }
+}
+
+// A^T m A from A x A vectors to M x M (y is scratch)
+template<size_t M, typename T, typename V>
+__attribute__((always_inline)) inline void output_2d(const V* m, V* y, V* out) {
+    using X = Transforms<M>;
+    const size_t A = X::ALPHA;
+    for (size_t j = 0; j < A; ++j) {
+        X::template output<T>(m + j, A, y + j, A);      // M x A
+    }
+    for (size_t i = 0; i < M; ++i) {
+        X::template output<T>(y + i * A, 1, out + i * M, 1);
+    }
+}
+
+// Input transforms of tiles [p0, p0 + nb) into v ([xi][c][tile]), one tile
+// per vector lane. Lowered to the SIMD of the calling variant.
+template<size_t M, typename T>
+__attribute__((always_inline)) inline void input_block(const Matrix<T>* input, size_t C, size_t p0, size_t nb,
+                                                       size_t tiles_c, T* v) {
+    typedef T vec __attribute__((vector_size(32)));
+    const size_t A = Transforms<M>::ALPHA, W = sizeof(vec) / sizeof(T);
+    vec d[A * A], t[A * A];
+    for (size_t c = 0; c < C; ++c) {
+        for (size_t p = 0; p < nb; p += W) {
+            const size_t lanes = std::min(W, nb - p);
+            gather_patches<M, W>(input[c], p0 + p, lanes, tiles_c, reinterpret_cast<T*>(t));
+            std::memcpy(d, t, sizeof(d));
+            input_2d<M, T>(d, t);
+            for (size_t xi = 0; xi < A * A; ++xi) {
+                std::memcpy(v + (xi * C + c) * nb + p, &d[xi], lanes * sizeof(T));
+            }
+        }
+    }
+}
+
+// Output transforms of m ([xi][k][tile]) into the output planes
+template<size_t M, typename T>
+__attribute__((always_inline)) inline void output_block(const T* m, size_t p0, size_t nb, size_t tiles_c,
+                                                        std::vector<Matrix<T>>& output) {
+    typedef T vec __attribute__((vector_size(32)));
+    const size_t A = Transforms<M>::ALPHA, W = sizeof(vec) / sizeof(T), K = output.size();
+    vec d[A * A], y[M * A], out[M * M];
+    for (size_t k = 0; k < K; ++k) {
+        for (size_t p = 0; p < nb; p += W) {
+            const size_t lanes = std::min(W, nb - p);
+            for (size_t xi = 0; xi < A * A; ++xi) {
+                d[xi] = vec{};
+                std::memcpy(&d[xi], m + (xi * K + k) * nb + p, lanes * sizeof(T));
+            }
+            output_2d<M, T>(d, y, out);
+            scatter_tiles<M, W>(reinterpret_cast<const T*>(out), p0 + p, lanes, tiles_c, output[k]);
+        }
+    }
+}
+
+// Single channel: input transform, product with the filter and output
+// transform of each group of tiles in registers, with no GEMM in between
+template<size_t M, typename T>
+__attribute__((always_inline)) inline void fused_block(const Matrix<T>& plane, const T* u, size_t p0, size_t nb,
+                                                       size_t tiles_c, Matrix<T>& output) {
+    typedef T vec __attribute__((vector_size(32)));
+    const size_t A = Transforms<M>::ALPHA, W = sizeof(vec) / sizeof(T);
+    vec d[A * A], t[A * A], y[M * A], out[M * M];
+    for (size_t p = 0; p < nb; p += W) {
+        const size_t lanes = std::min(W, nb - p);
+        gather_patches<M, W>(plane, p0 + p, lanes, tiles_c, reinterpret_cast<T*>(t));
+        std::memcpy(d, t, sizeof(d));
+        input_2d<M, T>(d, t);
+        for (size_t xi = 0; xi < A * A; ++xi) {
+            d[xi] *= u[xi];
+        }
+        output_2d<M, T>(d, y, out);
+        scatter_tiles<M, W>(reinterpret_cast<const T*>(out), p0 + p, lanes, tiles_c, output);
+    }
+}
+
+template<size_t M, typename T>
+void fused_block_generic(const Matrix<T>& plane, const T* u, size_t p0, size_t nb, size_t tiles_c, Matrix<T>& output) {
+    fused_block<M>(plane, u, p0, nb, tiles_c, output);
+}
+
+template<size_t M, typename T>
+void input_block_generic(const Matrix<T>* input, size_t C, size_t p0, size_t nb, size_t tiles_c, T* v) {
+    input_block<M>(input, C, p0, nb, tiles_c, v);
+}
+
+template<size_t M, typename T>
+void output_block_generic(const T* m, size_t p0, size_t nb, size_t tiles_c, std::vector<Matrix<T>>& output) {
+    output_block<M>(m, p0, nb, tiles_c, output);
+}
+
+#if defined(__x86_64__)
+template<size_t M, typename T>
+__attribute__((target("avx2,fma")))
+void input_block_avx2(const Matrix<T>* input, size_t C, size_t p0, size_t nb, size_t tiles_c, T* v) {
+    input_block<M>(input, C, p0, nb, tiles_c, v);
+}
+
+template<size_t M, typename T>
+__attribute__((target("avx2,fma")))
+void output_block_avx2(const T* m, size_t p0, size_t nb, size_t tiles_c, std::vector<Matrix<T>>& output) {
+    output_block<M>(m, p0, nb, tiles_c, output);
+}
+
+template<size_t M, typename T>
+__attribute__((target("avx2,fma")))
+void fused_block_avx2(const Matrix<T>& plane, const T* u, size_t p0, size_t nb, size_t tiles_c, Matrix<T>& output) {
+    fused_block<M>(plane, u, p0, nb, tiles_c, output);
+}
+#endif
+
+template<size_t M, typename T>
+std::vector<Matrix<T>> correlate(const Matrix<T>* input, const WinogradFilters<T>& f) {
+    const size_t A = Transforms<M>::ALPHA, K = f.out_channels, C = f.in_channels;
+    const size_t out_r = input[0].num_rows() - 2, out_c = input[0].num_cols() - 2;
+    const size_t tiles_c = (out_c + M - 1) / M, tiles = (out_r + M - 1) / M * tiles_c;
+    auto in_block = input_block_generic<M, T>;
+    auto out_block = output_block_generic<M, T>;
+    auto single_block = fused_block_generic<M, T>;
+#if defined(__x86_64__)
+    if (isa_supported(IsaLevel::AVX2)) {
+        in_block = input_block_avx2<M, T>;
+        out_block = output_block_avx2<M, T>;
+        single_block = fused_block_avx2<M, T>;
+    }
+#endif
+
+    std::vector<Matrix<T>> output;
+    for (size_t k = 0; k < K; ++k) {
+        output.emplace_back(out_r, out_c);
+    }
+    if (K == 1 && C == 1) {
+        for (size_t p0 = 0; p0 < tiles; p0 += TILE_BLOCK) {
+            single_block(input[0], f.u.data(), p0, std::min(TILE_BLOCK, tiles - p0), tiles_c, output[0]);
+        }
+        return output;
+    }
+    std::vector<T> v(A * A * C * TILE_BLOCK), m(A * A * K * TILE_BLOCK);
+    for (size_t p0 = 0; p0 < tiles; p0 += TILE_BLOCK) {
+        const size_t nb = std::min(TILE_BLOCK, tiles - p0);
+        in_block(input, C, p0, nb, tiles_c, v.data());
+
+        // Elementwise products summed over channels: one GEMM per transform element
+        std::fill(m.begin(), m.begin() + A * A * K * nb, T(0));
+        for (size_t xi = 0; xi < A * A; ++xi) {
+            gemm_accumulate(f.u.data() + xi * K * C, C, v.data() + xi * C * nb, nb,
+                            m.data() + xi * K * nb, nb, K, nb, C);
+        }
+        out_block(m.data(), p0, nb, tiles_c, output);
+    }
+    return output;
+}
+
+} // namespace winograd_detail
+
+// Transforms K x C 3x3 filters, filters[k * in_channels + c] for output
+// channel k and input channel c. A filter that is not 3x3, or a count that is
+// not a multiple of in_channels, gives empty filters (no input channels).
+template<typename T>
+WinogradFilters<T> winograd_transform_filters(const std::vector<Matrix<T>>& filters, size_t in_channels,
+                                              WinogradTile tile = WinogradTile::F4x4) {
+    if (in_channels == 0 || filters.empty() || filters.size() % in_channels != 0) {
+        return {};
+    }
+    for (const Matrix<T>& filter : filters) {
+        if (filter.num_rows() != 3 || filter.num_cols() != 3) {
+            return {};
+        }
+    }
+    return tile == WinogradTile::F2x2 ? winograd_detail::transform_filters<2>(filters, in_channels)
+                                      : winograd_detail::transform_filters<4>(filters, in_channels);
+}
+
+// Multi-channel valid correlation: output[k] = sum over c of input[c]
+// correlated with filter (k, c). All input planes share one size of at least
+// 3x3; otherwise, or without one plane per input channel, the result is empty.
+template<typename T>
+std::vector<Matrix<T>> winograd_correlate_3x3(const std::vector<Matrix<T>>& input, const WinogradFilters<T>& f) {
+    if (input.size() != f.in_channels || input.empty() || input[0].num_rows() < 3 || input[0].num_cols() < 3) {
+        return {};
+    }
+    for (const Matrix<T>& plane : input) {
+        if (plane.num_rows() != input[0].num_rows() || plane.num_cols() != input[0].num_cols()) {
+            return {};
+        }
+    }
+    return f.tile == WinogradTile::F2x2 ? winograd_detail::correlate<2>(input.data(), f)
+                                        : winograd_detail::correlate<4>(input.data(), f);
+}
+
+// Single channel, same result as a direct 3x3 sliding-window correlation.
+// The input must be at least 3x3 and the kernel exactly 3x3; otherwise the
+// result is empty (0 x 0).
+template<typename T>
+Matrix<T> winograd_correlate_3x3(const Matrix<T>& input, const Matrix<T>& kernel,
+                                 WinogradTile tile = WinogradTile::F4x4) {
+    if (input.num_rows() < 3 || input.num_cols() < 3 || kernel.num_rows() != 3 || kernel.num_cols() != 3) {
+        return Matrix<T>(0, 0);
+    }
+    WinogradFilters<T> f = winograd_transform_filters(std::vector<Matrix<T>>{kernel}, 1, tile);
+    std::vector<Matrix<T>> output = tile == WinogradTile::F2x2 ? winograd_detail::correlate<2>(&input, f)
+                                                               : winograd_detail::correlate<4>(&input, f);
+    return std::move(output[0]);
+}
@@ -0,0 +1,189 @@
+/*
+ * Work Metrics
+ * Work metadata (items, bytes read/written, FLOPs) that timers and annotation
+ * ranges can carry, plus derived rates and a roofline position relative to the
+ * measured peak memory bandwidth and floating-point throughput of this machine.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "cpu_dispatch.h"
+
+// Amount of work done by a section; all fields are optional
+struct Work {
+    double items = 0;
+    double bytes_read = 0;
+    double bytes_written = 0;
+    double flops = 0;
+    bool fp32 = false;      // FLOPs are single precision (roofline uses the fp32 peak)
+
+    Work& with_items(double n) { items = n; return *this; }
+    Work& with_bytes(double read, double written = 0) {
+        bytes_read = read;
+        bytes_written = written;
+        return *this;
+    }
+    Work& with_flops(double f, bool single_precision = false) {
+        flops = f;
+        fp32 = single_precision;
+        return *this;
+    }
+
+    double bytes() const { return bytes_read + bytes_written; }
+    bool empty() const { return items == 0 && bytes() == 0 && flops == 0; }
+};
+
+// Peak memory bandwidth and FLOP rate, measured once per process.
+// NSYS_PEAK_GBS / NSYS_PEAK_GFLOPS override the measurement.
+class MachinePeaks {
+private:
+    double gbs = 0;
+    double gflops = 0;
+    double gflops_fp32 = 0;
+
+    static double measure_bandwidth_gbs() {
+        // STREAM-style triad over arrays well beyond the last-level cache
+        const size_t n = 4 * 1024 * 1024;
+        std::vector<double> a(n, 0.0), b(n, 1.0), c(n, 2.0);
+        double best = 1e30;
+        for (int rep = 0; rep < 5; ++rep) {
+            auto start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < n; ++i) {
+                a[i] = b[i] + 3.0 * c[i];
+            }
+            best = std::min(best, std::chrono::duration<double>(
+                std::chrono::steady_clock::now() - start).count());
+        }
+        volatile double sink = a[n / 2];
+        (void)sink;
+        return 3.0 * sizeof(double) * n / best / 1e9;
+    }
+
+    template<typename T>
+    __attribute__((always_inline)) static inline double chain_gflops() {
+        // Independent multiply-add chains held in vector registers, so neither
+        // latency nor loads limit throughput; lowered to the SIMD of the calling variant
+        typedef T vec __attribute__((vector_size(32)));
+        const int chains = 12;
+        const long reps = 4'000'000;
+        vec acc[chains];
+        for (int j = 0; j < chains; ++j) {
+            acc[j] = vec{} + static_cast<T>(1 + j * 1e-3);
+        }
+        const vec mul = vec{} + static_cast<T>(0.999999);
+        const vec add = vec{} + static_cast<T>(1e-7);
+        double seconds = 1e30;
+        for (int trial = 0; trial < 3; ++trial) {
+            auto start = std::chrono::steady_clock::now();
+            for (long r = 0; r < reps; ++r) {
+#pragma GCC unroll 16
+                for (int j = 0; j < chains; ++j) {
+                    acc[j] = acc[j] * mul + add;
+                }
+            }
+            seconds = std::min(seconds, std::chrono::duration<double>(
+                std::chrono::steady_clock::now() - start).count());
+        }
+        volatile T sink = acc[0][0] + acc[chains - 1][0];
+        (void)sink;
+        const int lanes = sizeof(vec) / sizeof(T);
+        return 2.0 * chains * lanes * reps / seconds / 1e9;
+    }
+
+#if defined(__x86_64__)
+    template<typename T>
+    __attribute__((target("avx2,fma"))) static double chain_gflops_avx2() { return chain_gflops<T>(); }
+#endif
+
+    // Uses the widest variant the kernels themselves can dispatch to, so the
+    // peak is comparable to what the dispatched SIMD code can reach
+    template<typename T>
+    static double measure_gflops() {
+#if defined(__x86_64__)
+        if (isa_supported(IsaLevel::AVX2)) {
+            return chain_gflops_avx2<T>();
+        }
+#endif
+        return chain_gflops<T>();
+    }
+
+    MachinePeaks() {
+        const char* env_gbs = std::getenv("NSYS_PEAK_GBS");
+        const char* env_gflops = std::getenv("NSYS_PEAK_GFLOPS");
+        gbs = env_gbs ? std::atof(env_gbs) : measure_bandwidth_gbs();
+        gflops = env_gflops ? std::atof(env_gflops) : measure_gflops<double>();
+        gflops_fp32 = env_gflops ? 2 * gflops : measure_gflops<float>();
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(1)
+            << "     [Measured peaks: " << gbs << " GB/s, " << gflops << " GFLOP/s fp64, "
+            << gflops_fp32 << " GFLOP/s fp32]\n";
+        std::cout << out.str();
+    }
+
+public:
+    static const MachinePeaks& get() {
+        static const MachinePeaks peaks;
+        return peaks;
+    }
+
+    double bandwidth_gbs() const { return gbs; }
+    double peak_gflops(bool fp32 = false) const { return fp32 ? gflops_fp32 : gflops; }
+    // Arithmetic intensity (FLOP/byte) where the roofline turns from memory- to compute-bound
+    double ridge_point(bool fp32 = false) const { return peak_gflops(fp32) / gbs; }
+};
+
+// Formats derived rates (GB/s, GFLOP/s, items/s, ns/item) and the roofline
+// position for `work` completed in `seconds`; empty if there is nothing to report.
+inline std::string format_throughput(const Work& work, double seconds) {
+    if (work.empty() || seconds <= 0) {
+        return "";
+    }
+
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(2) << "     Throughput:";
+    const char* sep = " ";
+    if (work.bytes() > 0) {
+        out << sep << work.bytes() / seconds / 1e9 << " GB/s";
+        sep = ", ";
+    }
+    if (work.flops > 0) {
+        out << sep << work.flops / seconds / 1e9 << " GFLOP/s";
+        sep = ", ";
+    }
+    if (work.items > 0) {
+        out << sep << work.items / seconds / 1e6 << " Mitems/s, "
+            << seconds * 1e9 / work.items << " ns/item";
+    }
+
+    if (work.bytes() > 0) {
+        const MachinePeaks& peaks = MachinePeaks::get();
+        double achieved_gbs = work.bytes() / seconds / 1e9;
+        out << "\n     Roofline:";
+        if (work.flops > 0) {
+            double intensity = work.flops / work.bytes();
+            double attainable = std::min(peaks.peak_gflops(work.fp32), intensity * peaks.bandwidth_gbs());
+            double achieved = work.flops / seconds / 1e9;
+            out << " AI " << std::setprecision(3) << intensity << " FLOP/B, "
+                << (intensity < peaks.ridge_point(work.fp32) ? "memory-bound" : "compute-bound")
+                << std::setprecision(1) << ", " << 100.0 * achieved / attainable
+                << "% of attainable " << attainable << " GFLOP/s";
+        } else {
+            out << " memory-bound, " << std::setprecision(1)
+                << 100.0 * achieved_gbs / peaks.bandwidth_gbs() << "% of peak bandwidth";
+        }
+    } else if (work.flops > 0) {
+        const MachinePeaks& peaks = MachinePeaks::get();
+        out << "\n     Roofline: " << std::setprecision(1)
+            << 100.0 * work.flops / seconds / 1e9 / peaks.peak_gflops(work.fp32) << "% of peak FLOP rate";
+    }
+    return out.str();
+}
@@ -0,0 +1,167 @@
+#!/usr/bin/env python3
+"""
+Compare baseline, LTO, PGO and PGO+LTO builds of the C++ examples
+Builds each configuration in its own directory (PGO: instrument, train, rebuild),
+runs the examples and reports every timed section side by side
+"""
+
+import argparse
+import re
+import statistics
+import subprocess
+import sys
+from pathlib import Path
+from typing import Dict, List
+
+ROOT = Path(__file__).resolve().parent.parent
+
+# mode name -> (ENABLE_LTO, uses PGO)
+MODES = {
+    'baseline': (False, False),
+    'lto': (True, False),
+    'pgo': (False, True),
+    'pgo+lto': (True, True),
+}
+
+# Timer lines look like "   name: 0.123s"; NVTX ranges like "   [name] 0.123s"
+TIMER_RE = re.compile(r'^\s+(\S.*?): (\d+\.\d+)s$')
+RANGE_RE = re.compile(r'^\s+\[(.+?)\] (\d+\.\d+)s$')
+
+
+def run(cmd: List[str], cwd: Path = ROOT, quiet: bool = True) -> str:
+    """Run a command, raising on failure; returns stdout"""
+    result = subprocess.run(cmd, cwd=cwd, text=True,
+                            stdout=subprocess.PIPE,
+                            stderr=subprocess.STDOUT if quiet else None)
+    if result.returncode != 0:
+        print(result.stdout[-2000:])
+        raise RuntimeError(f"Command failed: {' '.join(cmd)}")
+    return result.stdout
+
+
+def configure_and_build(build_dir: Path, lto: bool, pgo_mode: str, jobs: int) -> None:
+    run(['cmake', '-S', str(ROOT), '-B', str(build_dir), '-DCMAKE_BUILD_TYPE=Release',
+         f"-DENABLE_LTO={'ON' if lto else 'OFF'}", f'-DPGO_MODE={pgo_mode}'])
+    run(['cmake', '--build', str(build_dir), '-j', str(jobs)])
+
+
+def build_mode(mode: str, build_root: Path, jobs: int) -> Path:
+    """Builds one configuration; PGO modes go through the full train cycle"""
+    lto, pgo = MODES[mode]
+    build_dir = build_root / mode.replace('+', '_')
+    print(f"Building {mode} in {build_dir}...")
+    if pgo:
+        configure_and_build(build_dir, lto, 'GENERATE', jobs)
+        print(f"  Training {mode} (running every example once)...")
+        run(['cmake', '--build', str(build_dir), '--target', 'pgo-train'])
+        configure_and_build(build_dir, lto, 'USE', jobs)
+    else:
+        configure_and_build(build_dir, lto, 'OFF', jobs)
+    return build_dir
+
+
+def parse_sections(output: str) -> Dict[str, float]:
+    """Maps 'header / section' to seconds; the header is the last unindented line"""
+    sections: Dict[str, float] = {}
+    header = ''
+    for line in output.splitlines():
+        if line and not line[0].isspace() and not set(line) <= set('=-'):
+            header = line.rstrip(':')
+            continue
+        match = TIMER_RE.match(line) or RANGE_RE.match(line)
+        if not match:
+            continue
+        key = f"{header} / {match.group(1).strip()}" if header else match.group(1).strip()
+        unique, n = key, 2
+        while unique in sections:
+            unique, n = f"{key} #{n}", n + 1
+        sections[unique] = float(match.group(2))
+    return sections
+
+
+def measure(binary: Path, repeat: int) -> Dict[str, float]:
+    """Median seconds per section over `repeat` runs"""
+    runs = [parse_sections(run([str(binary)], cwd=binary.parent)) for _ in range(repeat)]
+    keys = [k for k in runs[0] if all(k in r for r in runs)]
+    return {k: statistics.median(r[k] for r in runs) for k in keys}
+
+
+def format_report(results: Dict[str, Dict[str, Dict[str, float]]], modes: List[str]) -> str:
+    lines = ['# Build mode comparison', '',
+             'Seconds per timed section (median); speedup relative to baseline in parentheses.', '']
+    for example, per_mode in results.items():
+        lines.append(f'## {example}')
+        lines.append('')
+        lines.append('| Section | ' + ' | '.join(modes) + ' |')
+        lines.append('|---|' + '---:|' * len(modes))
+        base = per_mode.get('baseline', {})
+        totals = {m: 0.0 for m in modes}
+        for section in per_mode[modes[0]]:
+            cells = []
+            for m in modes:
+                t = per_mode[m].get(section)
+                if t is None:
+                    cells.append('-')
+                    continue
+                totals[m] += t
+                if m != 'baseline' and base.get(section):
+                    cells.append(f"{t:.3f} ({base[section] / t:.2f}x)" if t > 0 else f"{t:.3f}")
+                else:
+                    cells.append(f"{t:.3f}")
+            lines.append(f'| {section} | ' + ' | '.join(cells) + ' |')
+        total_cells = []
+        for m in modes:
+            if m != 'baseline' and totals.get('baseline') and totals[m] > 0:
+                total_cells.append(f"**{totals[m]:.3f}** ({totals['baseline'] / totals[m]:.2f}x)")
+            else:
+                total_cells.append(f"**{totals[m]:.3f}**")
+        lines.append('| **Total** | ' + ' | '.join(total_cells) + ' |')
+        lines.append('')
+    return '\n'.join(lines)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Compare baseline, LTO, PGO and PGO+LTO builds')
+    parser.add_argument('--examples', nargs='*',
+                        default=sorted(p.stem for p in (ROOT / 'cpp').glob('[0-9]_*.cpp')),
+                        help='Examples to benchmark (default: all)')
+    parser.add_argument('--modes', nargs='*', default=list(MODES), choices=list(MODES),
+                        help='Build modes to compare (default: all)')
+    parser.add_argument('--repeat', type=int, default=3, help='Runs per example and mode')
+    parser.add_argument('--build-root', type=Path, default=ROOT / 'build-modes',
+                        help='Parent directory of the per-mode build directories')
+    parser.add_argument('--skip-build', action='store_true', help='Reuse existing builds')
+    parser.add_argument('--jobs', type=int, default=4, help='Parallel build jobs')
+    parser.add_argument('--output', type=Path, default=ROOT / 'results' / 'reports' / 'build_modes.md',
+                        help='Markdown report path')
+    args = parser.parse_args()
+
+    modes = ['baseline'] + [m for m in args.modes if m != 'baseline']
+    build_dirs = {}
+    for mode in modes:
+        if args.skip_build:
+            build_dirs[mode] = args.build_root / mode.replace('+', '_')
+        else:
+            build_dirs[mode] = build_mode(mode, args.build_root, args.jobs)
+
+    results: Dict[str, Dict[str, Dict[str, float]]] = {}
+    for example in args.examples:
+        results[example] = {}
+        for mode in modes:
+            binary = build_dirs[mode] / 'bin' / example
+            if not binary.exists():
+                print(f"Missing {binary}; build first or drop --skip-build", file=sys.stderr)
+                sys.exit(1)
+            print(f"Running {example} [{mode}] x{args.repeat}...")
+            results[example][mode] = measure(binary, args.repeat)
+
+    report = format_report(results, modes)
+    args.output.parent.mkdir(parents=True, exist_ok=True)
+    args.output.write_text(report + '\n')
+    print()
+    print(report)
+    print(f"Report written to {args.output}")
+
+
+if __name__ == '__main__':
+    main()